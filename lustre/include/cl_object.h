@@ -281,6 +281,14 @@ struct cl_layout {
 	bool		cl_is_released;
 	/** Whether layout is a readonly one */
 	bool		cl_is_rdonly;
+	/** File offset to return the stripe layout of, set by the caller */
+	u64		cl_stripe_pos;
+	/** End of the instantiated component covering cl_stripe_pos */
+	u64		cl_stripe_end;
+	/** Stripe size of that component, 0 for a DoM component */
+	u32		cl_stripe_size;
+	/** Stripe count of that component */
+	u16		cl_stripe_count;
 };
 
 enum coo_inode_opc {
@@ -1606,10 +1614,16 @@ enum cl_enq_flags {
 	 * tell the DLM layer to lock only the requested range
 	 */
 	CEF_LOCK_NO_EXPAND    = 0x00000100,
+	/**
+	 * tell the server to fail the enqueue with -EUSERS rather than grant
+	 * a lock on a contended extent, so that the IO can be redone as
+	 * direct IO with server-side locking.
+	 */
+	CEF_DENY_ON_CONTENTION = 0x00000200,
 	/**
 	 * mask of enq_flags.
 	 */
-	CEF_MASK         = 0x000001ff,
+	CEF_MASK         = 0x000003ff,
 };
 
 /**
@@ -2516,6 +2530,8 @@ struct cl_dio_pages {
 	 */
 	int			cdp_from;
 	int			cdp_to;
+	/* pages are borrowed from a bvec iterator, no reference is held */
+	unsigned int		cdp_bvec:1;
 };
 
 /* Top level struct used for AIO and DIO */
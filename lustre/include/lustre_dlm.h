@@ -53,6 +53,7 @@ extern struct kset *ldlm_svc_kset;
 #define LDLM_DIRTY_AGE_LIMIT (10)
 #define LDLM_DEFAULT_PARALLEL_AST_LIMIT 1024
 #define LDLM_DEFAULT_LRU_SHRINK_BATCH (16)
+#define LDLM_DEFAULT_LRU_COST_KEEP (90)
 #define LDLM_DEFAULT_SLV_RECALC_PCT (10)
 
 /**
@@ -201,12 +202,16 @@ enum ldlm_lru_flags {
 					* time saving pages that will be
 					* discarded momentarily
 					*/
+	LDLM_LRU_FLAG_SHRINK	= 0x4, /* Cancel locks to free memory, do
+					* not pass over costly locks
+					*/
 };
 
 struct ldlm_pool;
 struct ldlm_lock;
 struct ldlm_resource;
 struct ldlm_namespace;
+struct ldlm_flock_owner;
 
 /**
  * Operations on LDLM pools.
@@ -286,6 +291,8 @@ typedef int (*ldlm_res_policy)(const struct lu_env *env,
 			       enum ldlm_mode mode, __u64 flags, void *data);
 
 typedef int (*ldlm_cancel_cbt)(struct ldlm_lock *lock);
+typedef unsigned int (*ldlm_lock_cost_cbt)(struct ldlm_lock *lock);
+typedef bool (*ldlm_lock_has_pages_cbt)(struct ldlm_lock *lock);
 
 /**
  * LVB operations.
@@ -321,12 +328,28 @@ enum ldlm_appetite {
 };
 
 /**
- * Default values for the "max_nolock_size", "contention_time" and
- * "contended_locks" namespace tunables.
+ * Default values for the "max_nolock_size", "contention_time",
+ * "contended_locks" and "stride_hits" namespace tunables.
  */
 #define NS_DEFAULT_MAX_NOLOCK_BYTES 0
 #define NS_DEFAULT_CONTENTION_SECONDS 2
 #define NS_DEFAULT_CONTENDED_LOCKS 32
+#define NS_DEFAULT_STRIDE_HITS 2
+#define NS_MAX_STRIDE_HITS 1024
+
+/**
+ * One CPU partition of the namespace LRU, so that threads releasing and
+ * matching locks on different sockets do not bounce a single lock.
+ */
+struct ldlm_ns_lru {
+	/** protects the fields below and l_lru of the locks on the list */
+	spinlock_t		nl_lock;
+	struct list_head	nl_unused_list;
+	/** Number of locks in the list above */
+	int			nl_nr_unused;
+	/** where a no-wait LRU scan resumes */
+	struct list_head	*nl_last_pos;
+};
 
 struct ldlm_ns_bucket {
 	/** back pointer to namespace */
@@ -430,19 +453,16 @@ struct ldlm_namespace {
 	struct list_head	ns_list_chain;
 
 	/**
-	 * List of unused locks for this namespace. This list is also called
-	 * LRU lock list.
+	 * Lists of unused locks for this namespace, one per CPU partition.
+	 * These lists are also called LRU lock lists.
 	 * Unused locks are locks with zero reader/writer reference counts.
-	 * This list is only used on clients for lock caching purposes.
+	 * They are only used on clients for lock caching purposes.
 	 * When we want to release some locks voluntarily or if server wants
 	 * us to release some locks due to e.g. memory pressure, we take locks
-	 * to release from the head of this list.
+	 * to release from the heads of these lists, oldest first.
 	 * Locks are linked via l_lru field in \see struct ldlm_lock.
 	 */
-	struct list_head	ns_unused_list;
-	/** Number of locks in the LRU list above */
-	int			ns_nr_unused;
-	struct list_head	*ns_last_pos;
+	struct ldlm_ns_lru	**ns_lru;
 
 	/**
 	 * Maximum number of locks permitted in the LRU. If 0, means locks
@@ -460,6 +480,12 @@ struct ldlm_namespace {
 	/* How much SLV should decrease in %% to trigger LRU cancel urgently. */
 	unsigned int            ns_recalc_pct;
 
+	/**
+	 * Unused locks scored by ns_lock_cost at or above this percentage
+	 * are passed over by the LRU for cheaper ones, 0 disables it.
+	 */
+	unsigned int		ns_lru_cost_keep;
+
 	/** Maximum allowed age (last used time) for locks in the LRU.  Set in
 	 * seconds from userspace, but stored in ns to avoid repeat conversions.
 	 */
@@ -538,6 +564,13 @@ struct ldlm_namespace {
 	 */
 	unsigned int		ns_max_nolock_size;
 
+	/**
+	 * Number of times a client has to repeat the same write stride on
+	 * a resource before its extent locks stop being expanded, 0 to never
+	 * detect strided writers.
+	 */
+	unsigned int		ns_stride_hits;
+
 	/** Limit of parallel AST RPC count. */
 	unsigned int		ns_max_parallel_ast;
 
@@ -547,9 +580,29 @@ struct ldlm_namespace {
 	 */
 	ldlm_cancel_cbt		ns_cancel;
 
+	/**
+	 * Callback to score how much an unused lock is worth keeping in the
+	 * LRU, see ldlm_lock_cost_score().
+	 */
+	ldlm_lock_cost_cbt	ns_lock_cost;
+
+	/**
+	 * Callback to check if an unused lock still has pages cached under
+	 * it, which its cancel has to flush or drop.
+	 */
+	ldlm_lock_has_pages_cbt	ns_lock_has_pages;
+
 	/** LDLM lock stats */
 	struct lprocfs_stats	*ns_stats;
 
+	/**
+	 * Server only: flock owners in the wait-for graph used for POSIX
+	 * lock deadlock detection, hashed by owner.
+	 */
+	spinlock_t		ns_flock_lock;
+	struct hlist_head	*ns_flock_owners;
+	unsigned int		ns_flock_nr_owners;
+
 	/**
 	 * Flag to indicate namespace is being freed. Used to determine if
 	 * recalculation of LDLM pool statistics should be skipped.
@@ -632,6 +685,44 @@ static inline void ns_register_cancel(struct ldlm_namespace *ns,
 	ns->ns_cancel = arg;
 }
 
+static inline void ns_register_lock_cost(struct ldlm_namespace *ns,
+					 ldlm_lock_cost_cbt arg)
+{
+	LASSERT(ns != NULL);
+	ns->ns_lock_cost = arg;
+}
+
+static inline void ns_register_lock_has_pages(struct ldlm_namespace *ns,
+					      ldlm_lock_has_pages_cbt arg)
+{
+	LASSERT(ns != NULL);
+	ns->ns_lock_has_pages = arg;
+}
+
+/**
+ * Score an unused lock for the client LRU.
+ *
+ * \a rpcs is the number of RPCs needed to rebuild what the lock protects
+ * once it is cancelled, \a mem is the memory it pins, counted in the same
+ * RPC sized units, and \a pressure is how short, in percent, the memory
+ * budget those pages are charged to is. Pinned memory costs nothing while
+ * the budget has room, and weighs as much as reading it back once the
+ * budget runs out.
+ *
+ * \retval percentage of the lock cost that is re-acquisition rather than
+ *	   memory held, i.e. how much the lock is worth keeping
+ */
+static inline unsigned int ldlm_lock_cost_score(__u64 rpcs, __u64 mem,
+						unsigned int pressure)
+{
+	mem = div_u64(mem * pressure, 100);
+
+	if (rpcs == 0)
+		return 0;
+
+	return div64_u64(rpcs * 100, rpcs + mem);
+}
+
 struct ldlm_lock;
 
 /** Type for blocking callback function of a lock. */
@@ -697,12 +788,30 @@ struct ldlm_interval_tree {
 	struct interval_tree_root	lit_root; /* actual interval tree */
 };
 
+/**
+ * Server extent resources also index their waiting locks by range, in two
+ * extra trees after the per-mode granted ones: one for GROUP locks, which
+ * conflict regardless of their extent, and one for all other modes.
+ */
+enum {
+	LDLM_ITREE_WAITING = LCK_MODE_NUM,
+	LDLM_ITREE_WAITING_GROUP,
+	LDLM_ITREE_NUM,
+};
+
 /**
  * Lists of waiting locks for each inodebit type.
  * A lock can be in several liq_waiting lists and it remains in lr_waiting.
+ *
+ * Granted locks are only counted per inodebit and mode, so that a request
+ * can tell whether any granted lock may conflict with it without walking
+ * lr_granted. Only server locks are accounted.
  */
 struct ldlm_ibits_queues {
 	struct list_head	liq_waiting[MDS_INODELOCK_NUMBITS];
+	__u32			liq_granted[MDS_INODELOCK_NUMBITS][LCK_MODE_NUM];
+	/** modes with a non-zero liq_granted count for each inodebit */
+	__u32			liq_granted_modes[MDS_INODELOCK_NUMBITS];
 };
 
 struct ldlm_ibits_node {
@@ -730,9 +839,6 @@ struct ldlm_flock {
 	__u64 start;
 	__u64 end;
 	__u64 owner;
-	__u64 blocking_owner;
-	struct obd_export *blocking_export;
-	atomic_t blocking_refs;
 	__u32 pid;
 };
 
@@ -793,7 +899,7 @@ struct ldlm_lock {
 	struct ldlm_resource	*l_resource;
 	/**
 	 * List item for client side LRU list.
-	 * Protected by ns_lock in struct ldlm_namespace.
+	 * Protected by nl_lock of the LRU partition \a l_lru_cpt.
 	 */
 	struct list_head	l_lru;
 	/**
@@ -830,10 +936,14 @@ struct ldlm_lock {
 		};
 		struct { /* LDLM_FLOCK locks */
 			/**
-			 * Per export hash of flock locks.
-			 * Protected by per-bucket exp->exp_flock_hash locks.
+			 * Server only: a blocked request is linked on the
+			 * waiting list of its owner in the deadlock detection
+			 * graph and refers to the owner it waits for.
+			 * Protected by ns_flock_lock.
 			 */
-			struct hlist_node	l_exp_flock_hash;
+			struct list_head	l_flock_waiting;
+			struct ldlm_flock_owner	*l_flock_owner;
+			struct ldlm_flock_owner	*l_flock_blocker;
 			struct ldlm_lock	*l_same_owner;
 			/* interval tree */
 			struct rb_node		l_fl_rb;
@@ -858,12 +968,21 @@ struct ldlm_lock {
 	 * hit. \see ldlm_work_bl_ast_lock
 	 */
 	unsigned int		l_bl_ast_run:1;
+	/**
+	 * Whether the lock was passed over by the LRU as too costly since it
+	 * was last used, protected by lr_lock. \see ldlm_lru_spare_lock
+	 */
+	unsigned int		l_lru_spared:1;
 
 	/* content type for lock value block */
 	enum lvb_type		l_lvb_type:3;
-	/* unsigned int		l_unused_bits:10; */
+	/* unsigned int		l_unused_bits:9; */
 	u16			l_lvb_len;
-	/* u16			l_unused; */
+	/**
+	 * CPU partition of the namespace LRU the lock was last added to,
+	 * only changes under the resource lock.
+	 */
+	u16			l_lru_cpt;
 
 	/*
 	 * Temporary storage for a LVB received during an enqueue operation.
@@ -1128,8 +1247,17 @@ struct ldlm_resource {
 	};
 
 	union {
-		 /* resource considered as contended, used only on server side*/
-		time64_t	lr_contention_time;
+		/* used only on server side */
+		struct {
+			/* resource considered as contended */
+			time64_t	lr_contention_time;
+			/* last export found writing with a stride, only
+			 * compared, never dereferenced
+			 */
+			struct obd_export *lr_stride_exp;
+			/* last time another export wrote with a stride */
+			time64_t	lr_stride_shared;
+		};
 		/**
 		 * Associated inode, used only on client side.
 		 */
@@ -1461,6 +1589,44 @@ struct ldlm_prolong_args {
 	int			lpa_locks_cnt;
 	int			lpa_blocks_cnt;
 };
+
+/*
+ * Prolong walks of one export over one resource are merged within a short
+ * time slice: BRW RPCs in flight under the same lock find the locks already
+ * refreshed and reuse the result of the previous walk.
+ */
+#define LDLM_PROLONG_SLOTS	4
+#define LDLM_PROLONG_SLICE_MS	1000
+
+struct ldlm_prolong_slot {
+	struct ldlm_res_id	lps_resid;
+	/* extent covered by the last walk, all within one lock */
+	struct ldlm_extent	lps_extent;
+	ktime_t			lps_stamp;
+	/* until when the walk refreshed the locks being called back */
+	time64_t		lps_refreshed;
+	/* exp_prolong_gen sampled before the walk */
+	int			lps_gen;
+	enum ldlm_mode		lps_mode;
+	int			lps_locks_cnt;
+	int			lps_blocks_cnt;
+};
+/*
+ * Per-export detector of strided extent enqueues, one slot per recently
+ * used resource, see ldlm_extent_strided().
+ */
+#define LDLM_STRIDE_SLOTS	4
+#define LDLM_STRIDE_MAX_AGE	10	/* seconds */
+
+struct ldlm_stride_slot {
+	struct ldlm_res_id	lss_resid;
+	__u64			lss_start;
+	__u64			lss_len;
+	__u64			lss_stride;
+	time64_t		lss_time;
+	unsigned int		lss_hits;
+};
+
 void ldlm_lock_prolong_one(struct ldlm_lock *lock,
 			   struct ldlm_prolong_args *arg);
 void ldlm_resource_prolong(struct ldlm_prolong_args *arg);
@@ -211,11 +211,6 @@ struct obd_export {
 	__u32			  exp_conn_cnt;
 	/** Hash list of all ldlm locks granted on this export */
 	struct cfs_hash		 *exp_lock_hash;
-	/**
-	 * Hash list for Posix lock deadlock detection, added with
-	 * ldlm_lock::l_exp_flock_hash.
-	 */
-	struct cfs_hash		*exp_flock_hash;
 	struct list_head	exp_outstanding_replies;
 	struct list_head	exp_uncommitted_replies;
 	spinlock_t		exp_uncommitted_replies_lock;
@@ -275,6 +270,16 @@ struct obd_export {
 	struct list_head	exp_bl_list;
 	spinlock_t		exp_bl_list_lock;
 
+	/** recent resource prolong walks, protected by exp_prolong_lock */
+	spinlock_t		exp_prolong_lock;
+	/** bumped whenever a lock of this export is called back or destroyed */
+	atomic_t		exp_prolong_gen;
+	struct ldlm_prolong_slot exp_prolong[LDLM_PROLONG_SLOTS];
+
+	/** strided write detection, protected by exp_stride_lock */
+	spinlock_t		exp_stride_lock;
+	struct ldlm_stride_slot	exp_stride[LDLM_STRIDE_SLOTS];
+
 	/** Target specific data */
 	union {
 		struct tg_export_data     eu_target_data;
@@ -384,6 +389,11 @@ static inline bool exp_connect_mirror_id_fix(struct obd_export *exp)
 	return exp_connect_flags2(exp) & OBD_CONNECT2_MIRROR_ID_FIX;
 }
 
+static inline bool exp_connect_readdir_plus(struct obd_export *exp)
+{
+	return exp_connect_flags2(exp) & OBD_CONNECT2_READDIR_PLUS;
+}
+
 static inline bool imp_connect_lvb_type(struct obd_import *imp)
 {
 	struct obd_connect_data *ocd;
@@ -61,6 +61,17 @@ struct ptlrpc_at_array {
         __u32            *paa_reqs_count; /** the count of reqs in each entry */
 };
 
+/**
+ * Number of service time bins kept per opcode on the server, bin N counts
+ * requests handled in [2^(N-1), 2^N) milliseconds, bin 0 those under 1ms.
+ */
+#define AT_OPC_BINS	20
+
+struct ptlrpc_at_opc_hist {
+	__u32		aoh_bins[AT_OPC_BINS];
+	__u32		aoh_count;	/** total of aoh_bins */
+};
+
 #define IMP_AT_MAX_PORTALS 8
 struct imp_at {
 	int			iat_portal[IMP_AT_MAX_PORTALS];
@@ -913,6 +913,10 @@ struct ptlrpc_srv_req {
 	/** @} nrs */
 	/** request arrival time */
 	struct timespec64		 sr_arrival_time;
+	/** time the handling of the request started */
+	time64_t			 sr_work_start;
+	/** no early reply needed before this time, see ptlrpc_at_check_timed */
+	time64_t			 sr_at_recheck;
 	/** server's half ctx */
 	struct ptlrpc_svc_ctx		*sr_svc_ctx;
 	/** (server side), pointed directly into req buffer */
@@ -1705,6 +1709,19 @@ struct ptlrpc_service_part {
 	struct list_head		scp_rqbd_idle;
 	/** req buffers receiving */
 	struct list_head		scp_rqbd_posted;
+	/**
+	 * request buffers drained from service but kept for re-use, they are
+	 * not accounted in scp_nrqbds_total but count against srv_nrqbds_max
+	 */
+	struct list_head		scp_rqbd_spare;
+	/** # request buffers on scp_rqbd_spare */
+	int				scp_nrqbds_spare;
+	/** # request buffers newly allocated */
+	__u64				scp_rqbd_nalloc;
+	/** # request buffers taken from scp_rqbd_spare */
+	__u64				scp_rqbd_nreuse;
+	/** # request buffers freed */
+	__u64				scp_rqbd_nfree;
 	/** incoming reqs */
 	struct list_head		scp_req_incoming;
 	/** timeout before re-posting reqs, in jiffies */
@@ -1757,6 +1774,10 @@ struct ptlrpc_service_part {
 	struct adaptive_timeout		scp_at_estimate;
 	/** reqs waiting for replies */
 	struct ptlrpc_at_array		scp_at_array;
+	/** service time history per opcode, LUSTRE_MAX_OPCODES entries */
+	struct ptlrpc_at_opc_hist	*scp_at_opc_hist;
+	/** # early replies not sent as the request was expected in time */
+	__u64				scp_at_early_skipped;
 	/** early reply timer */
 	struct timer_list		scp_at_timer;
 	/** debug */
@@ -1838,6 +1859,15 @@ struct ptlrpcd_ctl {
 	 * Error code if the thread failed to fully start.
 	 */
 	int				pc_error;
+	/**
+	 * Statistics: # requests queued to this thread, # requests taken
+	 * from partners by this thread and # queued requests taken away by
+	 * partners. pc_nadded and pc_nlost are protected by
+	 * pc_set->set_new_req_lock, pc_nstolen is only updated by the thread.
+	 */
+	__u64				pc_nadded;
+	__u64				pc_nstolen;
+	__u64				pc_nlost;
 };
 
 /* Bits for pc_flags */
@@ -178,6 +178,8 @@ static inline __u64 osc_enq2ldlm_flags(__u32 enqflags)
 		result |= LDLM_FL_NO_EXPANSION;
 	if (enqflags & CEF_SPECULATIVE)
 		result |= LDLM_FL_SPECULATIVE;
+	if (enqflags & CEF_DENY_ON_CONTENTION)
+		result |= LDLM_FL_DENY_ON_CONTENTION;
 	return result;
 }
 
@@ -713,6 +715,8 @@ void osc_lock_cancel(const struct lu_env *env,
 void osc_lock_fini(const struct lu_env *env, struct cl_lock_slice *slice);
 int osc_ldlm_glimpse_ast(struct ldlm_lock *dlmlock, void *data);
 unsigned long osc_ldlm_weigh_ast(struct ldlm_lock *dlmlock);
+unsigned int osc_ldlm_lock_cost(struct ldlm_lock *dlmlock);
+bool osc_ldlm_lock_has_pages(struct ldlm_lock *dlmlock);
 
 /* Accessors and type conversions. */
 static inline struct osc_thread_info *osc_env_info(const struct lu_env *env)
@@ -52,6 +52,20 @@ struct req_capsule {
 	const struct req_format *rc_fmt;
 	enum req_location        rc_loc;
 	__u32                    rc_area[RCL_NR][REQ_MAX_FIELD_NR];
+	/**
+	 * Server side only: request, its message, XID and message length, and
+	 * format for which the fixed-size fields below were validated in one
+	 * pass, see req_capsule_validate_req()
+	 */
+	const struct ptlrpc_request *rc_valid_req;
+	const struct lustre_msg	*rc_valid_msg;
+	__u64			 rc_valid_xid;
+	__u32			 rc_valid_len;
+	const struct req_format *rc_valid_fmt;
+	/** bit N set if request buffer N was found large enough */
+	__u32			 rc_valid_mask;
+	/** offsets of the request buffers from the start of the message */
+	__u32			 rc_valid_off[REQ_MAX_FIELD_NR];
 };
 
 void req_capsule_init(struct req_capsule *pill, struct ptlrpc_request *req,
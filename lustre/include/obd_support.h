@@ -632,6 +632,7 @@ extern bool obd_enable_health_write;
 #define OBD_FAIL_LLITE_STATAHEAD_PAUSE		    0x1433
 #define OBD_FAIL_LLITE_STAT_RACE1		    0x1434
 #define OBD_FAIL_LLITE_STAT_RACE2		    0x1435
+#define OBD_FAIL_LLITE_STRICT_SOM_PAUSE		    0x1436
 
 #define OBD_FAIL_FID_INDIR	0x1501
 #define OBD_FAIL_FID_INLMA	0x1502
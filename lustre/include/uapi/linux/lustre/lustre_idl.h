@@ -392,6 +392,7 @@ enum lu_dirent_attrs {
 	LUDA_FID		= 0x0001,
 	LUDA_TYPE		= 0x0002,
 	LUDA_64BITHASH		= 0x0004,
+	LUDA_ATTRS		= 0x0008,
 
 	/* for MDT internal use only, not visible to client */
 
@@ -462,6 +463,28 @@ struct luda_type {
 	__u16 lt_type;
 };
 
+/**
+ * Attributes of the object referenced by the entry, as known to the MDT
+ * when the page was built (readdir-plus). They are not protected by any
+ * lock, sizes and blocks are the lazy (LSOM) values.
+ *
+ * Aligned to 8 bytes.
+ */
+struct luda_attrs {
+	__u64 lat_valid;	/* OBD_MD_FL* of the valid fields */
+	__u64 lat_size;
+	__u64 lat_blocks;
+	__s64 lat_mtime;
+	__s64 lat_atime;
+	__s64 lat_ctime;
+	__u32 lat_mode;
+	__u32 lat_uid;
+	__u32 lat_gid;
+	__u32 lat_nlink;
+	__u32 lat_flags;
+	__u32 lat_padding;
+};
+
 struct lu_dirpage {
 	__u64            ldp_hash_start;
 	__u64            ldp_hash_end;
@@ -508,8 +531,12 @@ static inline __kernel_size_t lu_dirent_calc_size(size_t namelen, __u16 attr)
 	} else {
 		size = sizeof(struct lu_dirent) + namelen + 1;
 	}
+	size = (size + 7) & ~7;
+
+	if (attr & LUDA_ATTRS)
+		size += sizeof(struct luda_attrs);
 
-	return (size + 7) & ~7;
+	return size;
 }
 
 static inline __u16 lu_dirent_type_get(struct lu_dirent *ent)
@@ -530,6 +557,18 @@ static inline __u16 lu_dirent_type_get(struct lu_dirent *ent)
 	return type;
 }
 
+static inline struct luda_attrs *lu_dirent_attrs_get(struct lu_dirent *ent)
+{
+	__u32 attrs = __le32_to_cpu(ent->lde_attrs);
+
+	if (!(attrs & LUDA_ATTRS))
+		return NULL;
+
+	return (void *)ent +
+	       lu_dirent_calc_size(__le16_to_cpu(ent->lde_namelen),
+				   attrs & ~LUDA_ATTRS);
+}
+
 #define MDS_DIR_END_OFF 0xfffffffffffffffeULL
 
 /**
@@ -847,6 +886,7 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT2_CONN_POLICY	0x800000000ULL /* server-side connection policy */
 #define OBD_CONNECT2_MIRROR_ID_FIX     0x2000000000ULL /* rr_mirror_id move */
 #define OBD_CONNECT2_UPDATE_LAYOUT     0x4000000000ULL /* update compressibility */
+#define OBD_CONNECT2_READDIR_PLUS      0x8000000000ULL /* attrs in readdir pages */
 /* XXX README XXX README XXX README XXX README XXX README XXX README XXX
  * Please DO NOT add OBD_CONNECT flags before first ensuring that this value
  * is not in use by some other branch/patch.  Email adilger@whamcloud.com
@@ -918,7 +958,8 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT2_DMV_IMP_INHERIT |\
 				OBD_CONNECT2_UNALIGNED_DIO | \
 				OBD_CONNECT2_PCCRO | \
-				OBD_CONNECT2_MIRROR_ID_FIX)
+				OBD_CONNECT2_MIRROR_ID_FIX | \
+				OBD_CONNECT2_READDIR_PLUS)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
 				OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -2046,6 +2087,9 @@ enum mds_op_bias {
 	/* Compat flag with clients that do not send old and new data version
 	 * after swap layout */
 	MDS_CLOSE_LAYOUT_SWAP_HSM	= 1 << 25,
+	/* size and blocks of the close were got after the dirty data of
+	 * all clients was flushed, keep them as strict SOM */
+	MDS_CLOSE_STRICT_SOM	= 1 << 26,
 };
 
 #define MDS_CLOSE_INTENT (MDS_HSM_RELEASE | MDS_CLOSE_LAYOUT_SWAP |         \
@@ -80,10 +80,53 @@ static void test_one(struct ldlm_resource *res,
 	}
 }
 
+/* queue PW locks on the waiting list, far beyond the tested offsets */
+#define WAITING_LOCKS	4096
+#define WAITING_START	(1ULL << 40)
+
+static void fill_waiting(struct ldlm_resource *res, struct list_head *list)
+{
+	struct ldlm_lock *lock;
+	int i;
+
+	for (i = 0; i < WAITING_LOCKS; i++) {
+		lock = ldlm_lock_new_testing(res);
+		if (!lock)
+			break;
+
+		refcount_inc(&res->lr_refcount);
+		lock->l_req_mode = LCK_PW;
+		lock->l_policy_data.l_extent.start = WAITING_START +
+						     i * PAGE_SIZE;
+		lock->l_policy_data.l_extent.end =
+			lock->l_policy_data.l_extent.start + PAGE_SIZE - 1;
+		lock->l_policy_data.l_extent.gid = 0;
+		lock->l_req_extent = lock->l_policy_data.l_extent;
+
+		lock_res(res);
+		ldlm_resource_add_lock(res, &res->lr_waiting, lock);
+		unlock_res(res);
+		list_add_tail(&lock->l_lru, list);
+	}
+}
+
+static void drain_waiting(struct list_head *list)
+{
+	struct ldlm_lock *lock;
+
+	while ((lock = list_first_entry_or_null(list, struct ldlm_lock,
+						l_lru)) != NULL) {
+		list_del_init(&lock->l_lru);
+		ldlm_lock_cancel(lock);
+		ldlm_lock_put(lock);
+	}
+}
+
 enum tests {
 	TEST_NO_OVERLAP,
 	TEST_WHOLE_FILE,
 	TEST_SAME_RANGE,
+	TEST_WAITING_NO_OVERLAP,
 
 	NUM_TESTS,
 };
@@ -93,9 +136,10 @@ static int ldlm_extent_init(void)
 	struct lustre_cfg *cfg;
 	struct lustre_cfg_bufs bufs;
 	char *name, *uuid;
-	struct ldlm_resource *res;
+	struct ldlm_resource *res, *srv_res;
 	struct obd_device *obd;
-	struct ldlm_namespace *ns;
+	struct ldlm_namespace *ns, *srv_ns;
+	LIST_HEAD(waiting);
 	enum tests tnum;
 	struct rnd_state rstate;
 
@@ -120,6 +164,12 @@ static int ldlm_extent_init(void)
 				LDLM_NAMESPACE_MODEST,
 				LDLM_NS_TYPE_MDT);
 	res = ldlm_resource_get(ns, &RES_ID, LDLM_EXTENT, 1);
+	/* waiting locks are only indexed by range on the server side */
+	srv_ns = ldlm_namespace_new(obd, "extent-test-srv",
+				    LDLM_NAMESPACE_SERVER,
+				    LDLM_NAMESPACE_MODEST,
+				    LDLM_NS_TYPE_OST);
+	srv_res = ldlm_resource_get(srv_ns, &RES_ID, LDLM_EXTENT, 1);
 
 	pr_info("ldlm_extent: sizeof(struct ldlm_lock)=%lu\n",
 	       sizeof(struct ldlm_lock));
@@ -129,6 +179,8 @@ static int ldlm_extent_init(void)
 		int loops;
 
 		pr_info("ldlm_extent: start test %d\n", tnum);
+		if (tnum == TEST_WAITING_NO_OVERLAP)
+			fill_waiting(srv_res, &waiting);
 		for (loops = 0; loops < 10 ; loops++) {
 			struct ldlm_lock *lock;
 			ktime_t start, now;
@@ -169,6 +221,14 @@ static int ldlm_extent_init(void)
 					if (lock)
 						ldlm_extent_shift_kms(lock, 1000);
 					break;
+				case TEST_WAITING_NO_OVERLAP:
+					max = min(8000, min_iters);
+					if (i < max * 16 / 15)
+						max = i * 15 / 16;
+					test_one(srv_res,
+						 prandom_u32_state(&rstate), 1,
+						 LCK_EX, &cnt, max, &list);
+					break;
 				case NUM_TESTS:
 					break;
 				}
@@ -214,6 +274,7 @@ static int ldlm_extent_init(void)
 		pr_info("ldlm_extent: test %d ended - loops=%d min_iters=%d mean=%ld stddev=%ld\n",
 		       tnum, loops, min_iters, sum / loops,
 		       int_sqrt((sumsq - sum*sum/loops) / loops-1));
+		drain_waiting(&waiting);
 	}
 	class_detach(obd, cfg);
 
@@ -221,6 +282,8 @@ static int ldlm_extent_init(void)
 	OBD_FREE(uuid, MAX_OBD_NAME);
 	OBD_FREE(cfg, lustre_cfg_len(bufs.lcfg_bufcount, bufs.lcfg_buflen));
 
+	ldlm_resource_putref(srv_res);
+	ldlm_namespace_free_post(srv_ns);
 	ldlm_resource_putref(res);
 	ldlm_namespace_free_post(ns);
 	class_unregister_type("ldlm_test");
@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+
+#include <libcfs/libcfs.h>
+#include <lustre_dlm.h>
+#include <obd_support.h>
+#include <obd.h>
+#include <obd_class.h>
+#include <lustre_lib.h>
+#include "../../ldlm/ldlm_internal.h"
+
+/*
+ * Performance tests for ldlm_inodebits compatibility checks against a
+ * hot resource with many granted locks
+ */
+static int ibits_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
+{
+	return 0;
+}
+static int ibits_cleanup(struct obd_device *obd)
+{
+	return 0;
+}
+static const struct obd_ops ibits_ops = {
+	.o_owner       = THIS_MODULE,
+	.o_setup       = ibits_setup,
+	.o_cleanup     = ibits_cleanup,
+};
+
+static struct ldlm_res_id RES_ID = {
+	.name = {1, 2, 3, 4},
+};
+
+/* bits taken by the granted locks, in every combination */
+#define GRANTED_BITS	(MDS_INODELOCK_LOOKUP | MDS_INODELOCK_UPDATE | \
+			 MDS_INODELOCK_PERM | MDS_INODELOCK_XATTR)
+#define GRANTED_LOCKS	16384
+
+static struct ldlm_lock *enqueue_one(struct ldlm_resource *res,
+				     __u64 bits, enum ldlm_mode mode)
+{
+	__u64 flags = 0;
+	enum ldlm_error err;
+	ldlm_processing_policy pol;
+	struct ldlm_lock *lock = ldlm_lock_new_testing(res);
+
+	if (!lock)
+		return NULL;
+
+	refcount_inc(&res->lr_refcount);
+
+	lock->l_req_mode = mode;
+	lock->l_policy_data.l_inodebits.bits = bits;
+
+	pol = ldlm_get_processing_policy(res);
+
+	lock_res(res);
+	pol(lock, &flags, LDLM_PROCESS_ENQUEUE, &err, NULL);
+	unlock_res(res);
+
+	if (!ldlm_is_granted(lock)) {
+		ldlm_lock_cancel(lock);
+		ldlm_lock_put(lock);
+		return NULL;
+	}
+
+	return lock;
+}
+
+static void cancel_one(struct ldlm_lock *lock)
+{
+	ldlm_lock_cancel(lock);
+	ldlm_lock_put(lock);
+}
+
+/* grant PR and CR locks with all subsets of GRANTED_BITS */
+static int fill_granted(struct ldlm_resource *res, struct list_head *list)
+{
+	struct ldlm_lock *lock;
+	__u64 bits = 0;
+	int cnt = 0;
+	int i;
+
+	for (i = 0; i < GRANTED_LOCKS; i++) {
+		do {
+			bits = (bits - GRANTED_BITS) & GRANTED_BITS;
+		} while (bits == 0);
+
+		lock = enqueue_one(res, bits, i & 1 ? LCK_CR : LCK_PR);
+		if (!lock)
+			break;
+
+		list_add_tail(&lock->l_lru, list);
+		cnt++;
+	}
+
+	return cnt;
+}
+
+static void drain_granted(struct list_head *list)
+{
+	struct ldlm_lock *lock;
+
+	while ((lock = list_first_entry_or_null(list, struct ldlm_lock,
+						l_lru)) != NULL) {
+		list_del_init(&lock->l_lru);
+		cancel_one(lock);
+	}
+}
+
+enum tests {
+	TEST_PR_SAME_BITS,
+	TEST_EX_OTHER_BITS,
+	TEST_EX_CONFLICT,
+
+	NUM_TESTS,
+};
+
+static int ldlm_inodebits_init(void)
+{
+	struct lustre_cfg *cfg;
+	struct lustre_cfg_bufs bufs;
+	char *name, *uuid;
+	struct ldlm_resource *res;
+	struct obd_device *obd;
+	struct ldlm_namespace *ns;
+	LIST_HEAD(granted);
+	enum tests tnum;
+	int nr_granted;
+
+	class_register_type(&ibits_ops, NULL, false, "ldlm_ibits_test", NULL);
+
+	OBD_ALLOC(name, MAX_OBD_NAME);
+	OBD_ALLOC(uuid, MAX_OBD_NAME);
+	strscpy(name, "ibits_test", MAX_OBD_NAME);
+	lustre_cfg_bufs_reset(&bufs, name);
+	snprintf(uuid, MAX_OBD_NAME, "%s_UUID", name);
+
+	lustre_cfg_bufs_set_string(&bufs, 1, "ldlm_ibits_test"); /* typename */
+	lustre_cfg_bufs_set_string(&bufs, 2, uuid);
+	OBD_ALLOC(cfg, lustre_cfg_len(bufs.lcfg_bufcount, bufs.lcfg_buflen));
+	lustre_cfg_init(cfg, LCFG_ATTACH, &bufs);
+
+	class_attach(cfg);
+	obd = class_name2obd("ibits_test");
+	/* granted locks are only counted per bit on the server side */
+	ns = ldlm_namespace_new(obd, "ibits-test", LDLM_NAMESPACE_SERVER,
+				LDLM_NAMESPACE_MODEST,
+				LDLM_NS_TYPE_MDT);
+	res = ldlm_resource_get(ns, &RES_ID, LDLM_IBITS, 1);
+
+	nr_granted = fill_granted(res, &granted);
+	pr_info("ldlm_inodebits: %d granted locks\n", nr_granted);
+
+	for (tnum = 0; tnum < NUM_TESTS; tnum++) {
+		long sum = 0, sumsq = 0, nsec;
+		int nr_ok = 0;
+		int loops;
+
+		pr_info("ldlm_inodebits: start test %d\n", tnum);
+		for (loops = 0; loops < 10 ; loops++) {
+			struct ldlm_lock *lock = NULL;
+			ktime_t start, now;
+			int i;
+
+			start = now = ktime_get();
+			for (i = 0; i < 100000; i++) {
+				switch (tnum) {
+				case TEST_PR_SAME_BITS:
+					lock = enqueue_one(res,
+						MDS_INODELOCK_LOOKUP |
+						MDS_INODELOCK_UPDATE, LCK_PR);
+					break;
+				case TEST_EX_OTHER_BITS:
+					lock = enqueue_one(res,
+						MDS_INODELOCK_LAYOUT, LCK_EX);
+					break;
+				case TEST_EX_CONFLICT:
+					lock = enqueue_one(res,
+						MDS_INODELOCK_UPDATE, LCK_EX);
+					break;
+				case NUM_TESTS:
+					break;
+				}
+				if (lock) {
+					cancel_one(lock);
+					nr_ok++;
+				}
+				now = ktime_get();
+				if (ktime_to_ms(ktime_sub(now, start)) > 10000)
+					break;
+				cond_resched();
+			}
+			i++;
+			nsec = ktime_to_ns(ktime_sub(now, start)) / i;
+			sum += nsec;
+			sumsq += nsec * nsec;
+			pr_info("ldlm_inodebits: test %d loop=%d iters=%d ns/iter=%lu\n",
+				tnum, loops, i, nsec);
+		}
+
+		pr_info("ldlm_inodebits: test %d ended - loops=%d granted=%d mean=%ld stddev=%ld\n",
+			tnum, loops, nr_ok, sum / loops,
+			int_sqrt((sumsq - sum*sum/loops) / loops-1));
+	}
+	drain_granted(&granted);
+	class_detach(obd, cfg);
+
+	OBD_FREE(name, MAX_OBD_NAME);
+	OBD_FREE(uuid, MAX_OBD_NAME);
+	OBD_FREE(cfg, lustre_cfg_len(bufs.lcfg_bufcount, bufs.lcfg_buflen));
+
+	ldlm_resource_putref(res);
+	ldlm_namespace_free_post(ns);
+	class_unregister_type("ldlm_ibits_test");
+
+	return 0;
+}
+
+static void ldlm_inodebits_exit(void)
+{
+}
+
+MODULE_DESCRIPTION("Lustre ldlm_inodebits performance test");
+MODULE_LICENSE("GPL");
+
+module_init(ldlm_inodebits_init);
+module_exit(ldlm_inodebits_exit);
@@ -360,6 +360,85 @@ ldlm_extent_internal_policy_waiting(struct ldlm_lock *req,
 }
 
 
+/**
+ * Detect a client writing an object with a constant stride.
+ *
+ * Collective MPI-IO writers interleave fixed-size blocks of the same object.
+ * Expanding the lock of one writer covers the blocks the others are going to
+ * write next, so every enqueue calls the previous lock back. Once a client
+ * repeated the same stride, larger than its block, \a ns_stride_hits times,
+ * and another client wrote the resource with a stride too, or it is
+ * contended, see ldlm_check_contention(), its locks are granted as
+ * requested, the way lockahead locks are. That leaves the blocks in between
+ * for the other writers without any callback. A single strided writer keeps
+ * its expanded locks.
+ *
+ * Called with the resource locked.
+ *
+ * \param[in] lock	write lock being granted
+ *
+ * \retval true		\a lock should not be expanded
+ */
+static bool ldlm_extent_strided(struct ldlm_lock *lock)
+{
+	struct obd_export *exp = lock->l_export;
+	struct ldlm_resource *res = lock->l_resource;
+	struct ldlm_res_id *resid = &res->lr_name;
+	struct ldlm_extent *ext = &lock->l_req_extent;
+	unsigned int hits = ldlm_lock_to_ns(lock)->ns_stride_hits;
+	time64_t now = ktime_get_seconds();
+	struct ldlm_stride_slot *slot;
+	bool strided;
+	__u64 len;
+
+	if (hits == 0 || !(lock->l_req_mode & (LCK_PW | LCK_CW)))
+		return false;
+
+	len = ext->end - ext->start + 1;
+	slot = &exp->exp_stride[cfs_hash_64(resid->name[0] ^ resid->name[1],
+					    ilog2(LDLM_STRIDE_SLOTS))];
+
+	spin_lock(&exp->exp_stride_lock);
+	if (!ldlm_res_eq(&slot->lss_resid, resid) ||
+	    now > slot->lss_time + LDLM_STRIDE_MAX_AGE ||
+	    ext->start <= slot->lss_start) {
+		slot->lss_resid = *resid;
+		slot->lss_stride = 0;
+		slot->lss_hits = 0;
+	} else {
+		__u64 stride = ext->start - slot->lss_start;
+
+		if (stride == slot->lss_stride && len == slot->lss_len &&
+		    stride > len) {
+			if (slot->lss_hits < hits)
+				slot->lss_hits++;
+		} else {
+			slot->lss_hits = 0;
+		}
+		slot->lss_stride = stride;
+	}
+	slot->lss_start = ext->start;
+	slot->lss_len = len;
+	slot->lss_time = now;
+	strided = slot->lss_hits >= hits;
+	spin_unlock(&exp->exp_stride_lock);
+
+	if (!strided)
+		return false;
+
+	/* interleaved writers alternate here, unlike a single one */
+	if (res->lr_stride_exp != exp) {
+		if (res->lr_stride_exp != NULL)
+			res->lr_stride_shared = now;
+		res->lr_stride_exp = exp;
+	}
+
+	/* lr_contention_time is refreshed by the compat queue scan */
+	return now <= res->lr_stride_shared + LDLM_STRIDE_MAX_AGE ||
+	       now < res->lr_contention_time +
+		     ldlm_res_to_ns(res)->ns_contention_time;
+}
+
 /* In order to determine the largest possible extent we can grant, we need
  * to scan all of the queues.
  */
@@ -367,6 +446,7 @@ static void ldlm_extent_policy(struct ldlm_resource *res,
 			       struct ldlm_lock *lock, __u64 *flags)
 {
 	struct ldlm_extent new_ex = { .start = 0, .end = OBD_OBJECT_EOF };
+	bool expand = true;
 
 	if (lock->l_export == NULL)
 		/* this is a local lock taken by server (e.g., as a part of
@@ -386,11 +466,18 @@ static void ldlm_extent_policy(struct ldlm_resource *res,
 	 * LDLM_FL_LOCK_CHANGED, we must check for the NO_EXPANSION flag
 	 * in the lock flags rather than the 'flags' argument
 	 */
-	if (likely(!(lock->l_flags & LDLM_FL_NO_EXPANSION))) {
+	if (unlikely(lock->l_flags & LDLM_FL_NO_EXPANSION)) {
+		LDLM_DEBUG(lock, "Not expanding manually requested lock");
+		expand = false;
+	} else if (ldlm_extent_strided(lock)) {
+		LDLM_DEBUG(lock, "Not expanding lock of strided writer");
+		expand = false;
+	}
+
+	if (likely(expand)) {
 		ldlm_extent_internal_policy_granted(lock, &new_ex);
 		ldlm_extent_internal_policy_waiting(lock, &new_ex);
 	} else {
-		LDLM_DEBUG(lock, "Not expanding manually requested lock");
 		new_ex.start = lock->l_policy_data.l_extent.start;
 		new_ex.end = lock->l_policy_data.l_extent.end;
 		/* In case the request is not on correct boundaries, we call
@@ -422,6 +509,43 @@ static bool ldlm_check_contention(struct ldlm_lock *lock, int contended_locks)
 		ldlm_res_to_ns(res)->ns_contention_time;
 }
 
+/**
+ * Check whether the waiting queue of \a res may hold a lock that matters for
+ * the compatibility of \a req, using the waiting lock range index.
+ *
+ * Only waiting locks overlapping the requested extent are relevant, except
+ * GROUP locks which conflict with any other mode whatever their extent.
+ * If nothing but \a req itself overlaps, the queue walk can be skipped.
+ */
+static bool ldlm_extent_waiting_may_conflict(struct ldlm_resource *res,
+					     struct ldlm_lock *req)
+{
+	__u64 req_start = req->l_req_extent.start;
+	__u64 req_end = req->l_req_extent.end;
+	struct ldlm_interval_tree *tree;
+	struct ldlm_lock *lock;
+
+	if (list_empty(&res->lr_waiting))
+		return false;
+
+	if (!ns_is_server(ldlm_res_to_ns(res)) || req->l_req_mode == LCK_GROUP)
+		return true;
+
+	tree = &res->lr_itree[LDLM_ITREE_WAITING_GROUP];
+	if (!INTERVAL_TREE_EMPTY(&tree->lit_root))
+		return true;
+
+	tree = &res->lr_itree[LDLM_ITREE_WAITING];
+	for (lock = extent_iter_first(&tree->lit_root, req_start, req_end);
+	     lock;
+	     lock = extent_iter_next(lock, req_start, req_end)) {
+		if (lock != req || !list_empty(&lock->l_same_extent))
+			return true;
+	}
+
+	return false;
+}
+
 struct ldlm_extent_compat_args {
 	struct list_head *work_list;
 	struct ldlm_lock *lock;
@@ -564,7 +688,8 @@ ldlm_extent_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 					compat = 0;
 			}
 		}
-	} else { /* for waiting queue */
+	} else if (ldlm_extent_waiting_may_conflict(res, req)) {
+		/* for waiting queue, when some lock there overlaps req */
 		list_for_each_entry(lock, queue, l_res_link) {
 			check_contention = 1;
 
@@ -734,7 +859,7 @@ ldlm_extent_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 
 	RETURN(compat);
 destroylock:
-	list_del_init(&req->l_res_link);
+	ldlm_resource_unlink_lock(req);
 	if (ldlm_is_local(req))
 		ldlm_lock_decref_internal_nolock(req, req_mode);
 	ldlm_lock_destroy_nolock(req);
@@ -776,29 +901,182 @@ void ldlm_lock_prolong_one(struct ldlm_lock *lock,
 }
 EXPORT_SYMBOL(ldlm_lock_prolong_one);
 
+/* state of one walk of ldlm_resource_prolong() over the interval trees */
+struct ldlm_prolong_walk {
+	struct ldlm_prolong_args	*lpw_arg;
+	/* widest extent of a counted lock containing the whole walk */
+	struct ldlm_extent		 lpw_cover;
+};
+
 static bool ldlm_resource_prolong_cb(struct ldlm_lock *lock, void *data)
 {
-	struct ldlm_prolong_args *arg = data;
+	struct ldlm_prolong_walk *walk = data;
+	struct ldlm_prolong_args *arg = walk->lpw_arg;
+	struct ldlm_extent *ext = &lock->l_policy_data.l_extent;
+	int locks_cnt = arg->lpa_locks_cnt;
 
 	ENTRY;
 	ldlm_lock_prolong_one(lock, arg);
 
+	if (arg->lpa_locks_cnt > locks_cnt &&
+	    ldlm_extent_contain(ext, &arg->lpa_extent) &&
+	    ext->end - ext->start > walk->lpw_cover.end - walk->lpw_cover.start)
+		walk->lpw_cover = *ext;
+
 	RETURN(false);
 }
 
+static void ldlm_prolong_walk(struct ldlm_resource *res,
+			      struct ldlm_prolong_walk *walk)
+{
+	struct ldlm_prolong_args *arg = walk->lpw_arg;
+	struct ldlm_interval_tree *tree;
+	int idx;
+
+	walk->lpw_cover = arg->lpa_extent;
+	for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+		tree = &res->lr_itree[idx];
+		if (INTERVAL_TREE_EMPTY(&tree->lit_root))
+			continue;
+
+		/* There is no possibility to check for the groupID
+		 * so all the group locks are considered as valid
+		 * here, especially because the client is supposed
+		 * to check it has such a lock before sending an RPC.
+		 */
+		if (!(tree->lit_mode & arg->lpa_mode))
+			continue;
+
+		ldlm_extent_search(&tree->lit_root, arg->lpa_extent.start,
+				   arg->lpa_extent.end,
+				   ldlm_resource_prolong_cb, walk);
+	}
+}
+
+static inline struct ldlm_prolong_slot *
+ldlm_prolong_slot(struct obd_export *exp, const struct ldlm_res_id *resid)
+{
+	return &exp->exp_prolong[cfs_hash_64(resid->name[0] ^ resid->name[1],
+					     ilog2(LDLM_PROLONG_SLOTS))];
+}
+
+/**
+ * Check whether a walk done earlier in this time slice already counted the
+ * locks of \a arg.
+ *
+ * The stored walk covered the extent of one lock of the export, so any
+ * extent within it is covered by that lock too, and the locks being called
+ * back that it overlaps had their timers refreshed by that walk. That is
+ * only good enough if the refresh gives them about as much time as this
+ * RPC would, since RPCs arriving later may be granted a later deadline.
+ *
+ * \param[in] arg		prolong args
+ * \param[in] gen		exp_prolong_gen sampled by the caller
+ *
+ * \retval true		\a arg counters are filled from the slot
+ * \retval false		the resource has to be walked
+ */
+static bool ldlm_prolong_merge(struct ldlm_prolong_args *arg, int gen)
+{
+	struct obd_export *exp = arg->lpa_export;
+	struct ldlm_prolong_slot *slot;
+	time64_t refreshed = 0;
+	int locks_cnt = 0;
+	int blocks_cnt = 0;
+	bool merged = false;
+
+	slot = ldlm_prolong_slot(exp, &arg->lpa_resid);
+	spin_lock(&exp->exp_prolong_lock);
+	if (slot->lps_gen == gen && slot->lps_mode == arg->lpa_mode &&
+	    ldlm_res_eq(&slot->lps_resid, &arg->lpa_resid) &&
+	    ktime_ms_delta(ktime_get(), slot->lps_stamp) <
+	    LDLM_PROLONG_SLICE_MS &&
+	    ldlm_extent_contain(&slot->lps_extent, &arg->lpa_extent)) {
+		locks_cnt = slot->lps_locks_cnt;
+		blocks_cnt = slot->lps_blocks_cnt;
+		refreshed = slot->lps_refreshed;
+		merged = true;
+	}
+	spin_unlock(&exp->exp_prolong_lock);
+
+	if (merged && blocks_cnt > 0 &&
+	    ktime_get_seconds() + ldlm_bl_timeout_by_rpc(arg->lpa_req) >
+	    refreshed + LDLM_PROLONG_SLICE_MS / MSEC_PER_SEC)
+		merged = false;
+
+	if (merged) {
+		arg->lpa_locks_cnt += locks_cnt;
+		arg->lpa_blocks_cnt += blocks_cnt;
+	}
+
+	return merged;
+}
+
+/* remember the result of a walk for the rest of the time slice */
+static void ldlm_prolong_update(struct ldlm_prolong_args *hull, int gen,
+				ktime_t stamp)
+{
+	struct obd_export *exp = hull->lpa_export;
+	struct ldlm_prolong_slot *slot;
+	time64_t refreshed = 0;
+
+	/* nothing to reuse, the next RPC has to look for its locks again */
+	if (hull->lpa_locks_cnt == 0)
+		return;
+
+	if (hull->lpa_blocks_cnt > 0)
+		refreshed = ktime_get_seconds() +
+			    ldlm_bl_timeout_by_rpc(hull->lpa_req);
+
+	slot = ldlm_prolong_slot(exp, &hull->lpa_resid);
+	spin_lock(&exp->exp_prolong_lock);
+	slot->lps_resid = hull->lpa_resid;
+	slot->lps_extent = hull->lpa_extent;
+	slot->lps_stamp = stamp;
+	slot->lps_refreshed = refreshed;
+	slot->lps_gen = gen;
+	slot->lps_mode = hull->lpa_mode;
+	slot->lps_locks_cnt = hull->lpa_locks_cnt;
+	slot->lps_blocks_cnt = hull->lpa_blocks_cnt;
+	spin_unlock(&exp->exp_prolong_lock);
+}
+
 /**
  * Walk through granted tree and prolong locks if they overlaps extent.
  *
+ * Walks of the same export over the same resource are merged within
+ * LDLM_PROLONG_SLICE_MS, see ldlm_prolong_merge(). When a lock of the export
+ * covers the whole extent, the extent of that lock is walked as well, so
+ * that the next RPCs under it, e.g. those flushing its pages while it is
+ * called back, are answered from that walk.
+ *
  * \param[in] arg		prolong args
  */
 void ldlm_resource_prolong(struct ldlm_prolong_args *arg)
 {
-	struct ldlm_interval_tree *tree;
+	struct ldlm_prolong_walk walk = { .lpw_arg = arg };
+	struct ldlm_prolong_args hull;
 	struct ldlm_resource *res;
-	int idx;
+	int locks_cnt = arg->lpa_locks_cnt;
+	int blocks_cnt = arg->lpa_blocks_cnt;
+	ktime_t stamp;
+	int gen;
 
 	ENTRY;
 
+	/* sample before the walk so that a callback racing with it
+	 * invalidates the result
+	 */
+	gen = atomic_read(&arg->lpa_export->exp_prolong_gen);
+	stamp = ktime_get();
+	if (ldlm_prolong_merge(arg, gen)) {
+		CDEBUG(D_DLMTRACE,
+		       "merged prolong for resid %llu/%llu (%llu->%llu)\n",
+		       arg->lpa_resid.name[0], arg->lpa_resid.name[1],
+		       arg->lpa_extent.start, arg->lpa_extent.end);
+		RETURN_EXIT;
+	}
+
 	res = ldlm_resource_get(arg->lpa_export->exp_obd->obd_namespace,
 				&arg->lpa_resid, LDLM_EXTENT, 0);
 	if (IS_ERR(res)) {
@@ -807,27 +1085,25 @@ void ldlm_resource_prolong(struct ldlm_prolong_args *arg)
 		RETURN_EXIT;
 	}
 
-	lock_res(res);
-	for (idx = 0; idx < LCK_MODE_NUM; idx++) {
-		tree = &res->lr_itree[idx];
-		if (INTERVAL_TREE_EMPTY(&tree->lit_root))
-			continue;
+	hull = *arg;
+	hull.lpa_locks_cnt = 0;
+	hull.lpa_blocks_cnt = 0;
 
-		/* There is no possibility to check for the groupID
-		 * so all the group locks are considered as valid
-		 * here, especially because the client is supposed
-		 * to check it has such a lock before sending an RPC.
-		 */
-		if (!(tree->lit_mode & arg->lpa_mode))
-			continue;
-
-		ldlm_extent_search(&tree->lit_root, arg->lpa_extent.start,
-				 arg->lpa_extent.end,
-				 ldlm_resource_prolong_cb, arg);
+	lock_res(res);
+	ldlm_prolong_walk(res, &walk);
+	if (walk.lpw_cover.start != arg->lpa_extent.start ||
+	    walk.lpw_cover.end != arg->lpa_extent.end) {
+		hull.lpa_extent = walk.lpw_cover;
+		walk.lpw_arg = &hull;
+		ldlm_prolong_walk(res, &walk);
+	} else {
+		hull.lpa_locks_cnt = arg->lpa_locks_cnt - locks_cnt;
+		hull.lpa_blocks_cnt = arg->lpa_blocks_cnt - blocks_cnt;
 	}
 	unlock_res(res);
 	ldlm_resource_putref(res);
 
+	ldlm_prolong_update(&hull, gen, stamp);
 	EXIT;
 }
 EXPORT_SYMBOL(ldlm_resource_prolong);
@@ -897,8 +1173,11 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 	}
 
 	if (rc + rc2 == 2) {
-		ldlm_extent_policy(res, lock, flags);
+		/* unlink first, the waiting lock index is keyed by the extent
+		 * which ldlm_extent_policy() may change
+		 */
 		ldlm_resource_unlink_lock(lock);
+		ldlm_extent_policy(res, lock, flags);
 		ldlm_grant_lock(lock, grant_work);
 	} else {
 		/* Adding LDLM_FL_NO_TIMEOUT flag to granted lock to
@@ -1067,7 +1346,35 @@ void ldlm_extent_add_lock(struct ldlm_resource *res,
 	}
 }
 
-/** Remove cancelled lock from resource interval tree. */
+/**
+ * Add a lock queued on the waiting list of a server resource into the
+ * waiting lock range index, so that enqueues which overlap none of the
+ * waiting locks need not walk the whole waiting list.
+ *
+ * Client waiting locks are not indexed: their extent may be changed by
+ * the completion AST while they are still on the waiting list.
+ */
+void ldlm_extent_add_waiting_lock(struct ldlm_resource *res,
+				  struct ldlm_lock *lock)
+{
+	struct ldlm_interval_tree *tree;
+	struct ldlm_lock *orig;
+
+	if (!ns_is_server(ldlm_res_to_ns(res)))
+		return;
+
+	LASSERT(RB_EMPTY_NODE(&lock->l_rb));
+	LASSERT(list_empty(&lock->l_same_extent));
+
+	tree = &res->lr_itree[lock->l_req_mode == LCK_GROUP ?
+			      LDLM_ITREE_WAITING_GROUP : LDLM_ITREE_WAITING];
+	orig = extent_insert_unique(lock, &tree->lit_root);
+	if (orig)
+		list_add(&lock->l_same_extent, &orig->l_same_extent);
+	tree->lit_size++;
+}
+
+/** Remove cancelled or granted lock from resource interval tree. */
 void ldlm_extent_unlink_lock(struct ldlm_lock *lock)
 {
 	struct ldlm_resource *res = lock->l_resource;
@@ -1078,8 +1385,13 @@ void ldlm_extent_unlink_lock(struct ldlm_lock *lock)
 	    list_empty(&lock->l_same_extent)) /* duplicate unlink */
 		return;
 
-	idx = ldlm_mode_to_index(lock->l_granted_mode);
-	LASSERT(lock->l_granted_mode == BIT(idx));
+	if (ldlm_is_granted(lock)) {
+		idx = ldlm_mode_to_index(lock->l_granted_mode);
+		LASSERT(lock->l_granted_mode == BIT(idx));
+	} else {
+		idx = lock->l_req_mode == LCK_GROUP ?
+		      LDLM_ITREE_WAITING_GROUP : LDLM_ITREE_WAITING;
+	}
 	tree = &res->lr_itree[idx];
 
 	LASSERT(!INTERVAL_TREE_EMPTY(&tree->lit_root));
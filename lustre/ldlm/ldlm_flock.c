@@ -79,45 +79,185 @@ static int ldlm_flocks_are_equal(struct ldlm_lock *l1, struct ldlm_lock *l2)
 	       l2->l_policy_data.l_flock.end;
 }
 
-static inline void ldlm_flock_blocking_link(struct ldlm_lock *req,
-					    struct ldlm_lock *lock)
+/**
+ * POSIX locks deadlock detection graph.
+ *
+ * The server keeps a wait-for graph of flock owners, i.e. processes on a
+ * client node, which have a request blocked by another owner. A blocked
+ * request is linked on the waiting list of its own owner node and refers to
+ * the node of the owner holding the conflicting lock, so following the graph
+ * from one owner to the next is a pointer dereference. Only the two ends of
+ * a new edge are looked up in the per-namespace owner hash.
+ *
+ * The graph is protected by ns_flock_lock, which nests inside the resource
+ * lock. An owner node lives as long as some blocked request is linked to it
+ * from either end. A linked request holds a lock reference, and it is taken
+ * off the graph whenever it leaves its resource, i.e. when it is granted,
+ * cancelled on deadlock, by the client, on eviction or on namespace cleanup,
+ * see ldlm_flock_unlink_lock().
+ */
+#define LDLM_FLOCK_OWNER_HASH_BITS	8
+
+struct ldlm_flock_owner {
+	struct hlist_node	lfo_hash;
+	struct lnet_nid		lfo_nid;
+	__u64			lfo_owner;
+	/* blocked requests of this owner, linked by l_flock_waiting */
+	struct list_head	lfo_waiting;
+	/* blocked requests of this owner and blocked on it */
+	unsigned int		lfo_refs;
+};
+
+int ldlm_flock_graph_init(struct ldlm_namespace *ns)
+{
+	int i;
+
+	spin_lock_init(&ns->ns_flock_lock);
+	ns->ns_flock_nr_owners = 0;
+	OBD_ALLOC_PTR_ARRAY(ns->ns_flock_owners,
+			    1 << LDLM_FLOCK_OWNER_HASH_BITS);
+	if (!ns->ns_flock_owners)
+		return -ENOMEM;
+
+	for (i = 0; i < 1 << LDLM_FLOCK_OWNER_HASH_BITS; i++)
+		INIT_HLIST_HEAD(&ns->ns_flock_owners[i]);
+
+	return 0;
+}
+
+void ldlm_flock_graph_fini(struct ldlm_namespace *ns)
+{
+	if (!ns->ns_flock_owners)
+		return;
+
+	LASSERTF(ns->ns_flock_nr_owners == 0, "%s: %u flock owners left\n",
+		 ns->ns_name, ns->ns_flock_nr_owners);
+	OBD_FREE_PTR_ARRAY(ns->ns_flock_owners,
+			   1 << LDLM_FLOCK_OWNER_HASH_BITS);
+	ns->ns_flock_owners = NULL;
+}
+
+/* Find or add the graph node for the owner of @lock, with a reference. */
+static struct ldlm_flock_owner *
+ldlm_flock_owner_get(struct ldlm_namespace *ns, struct ldlm_lock *lock)
 {
+	struct lnet_nid *nid = &lock->l_export->exp_connection->c_peer.nid;
+	__u64 owner = lock->l_policy_data.l_flock.owner;
+	struct hlist_head *head;
+	struct ldlm_flock_owner *lfo;
+
+	head = &ns->ns_flock_owners[cfs_hash_64(owner,
+					    LDLM_FLOCK_OWNER_HASH_BITS)];
+	hlist_for_each_entry(lfo, head, lfo_hash) {
+		if (lfo->lfo_owner == owner && nid_same(&lfo->lfo_nid, nid)) {
+			lfo->lfo_refs++;
+			return lfo;
+		}
+	}
+
+	/* under the resource lock, can't sleep */
+	OBD_ALLOC_GFP(lfo, sizeof(*lfo), GFP_ATOMIC);
+	if (!lfo)
+		return NULL;
+
+	lfo->lfo_nid = *nid;
+	lfo->lfo_owner = owner;
+	INIT_LIST_HEAD(&lfo->lfo_waiting);
+	lfo->lfo_refs = 1;
+	hlist_add_head(&lfo->lfo_hash, head);
+	ns->ns_flock_nr_owners++;
+
+	return lfo;
+}
+
+static void ldlm_flock_owner_put(struct ldlm_namespace *ns,
+				 struct ldlm_flock_owner *lfo)
+{
+	LASSERT(lfo->lfo_refs > 0);
+	if (--lfo->lfo_refs > 0)
+		return;
+
+	LASSERT(list_empty(&lfo->lfo_waiting));
+	hlist_del(&lfo->lfo_hash);
+	ns->ns_flock_nr_owners--;
+	OBD_FREE_PTR(lfo);
+}
+
+/**
+ * Add the edge from the owner of blocked request \a req to the owner of the
+ * conflicting lock \a lock to the deadlock detection graph.
+ *
+ * \retval -ENOMEM if the graph nodes could not be allocated
+ */
+static inline int ldlm_flock_blocking_link(struct ldlm_lock *req,
+					   struct ldlm_lock *lock)
+{
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(req);
+	struct ldlm_flock_owner *waiter;
+	struct ldlm_flock_owner *blocker = NULL;
+
 	/* For server only */
 	if (req->l_export == NULL)
-		return;
+		return 0;
 
-	LASSERT(hlist_unhashed(&req->l_exp_flock_hash));
+	LASSERT(req->l_flock_owner == NULL);
+
+	spin_lock(&ns->ns_flock_lock);
+	waiter = ldlm_flock_owner_get(ns, req);
+	if (waiter)
+		blocker = ldlm_flock_owner_get(ns, lock);
+	if (!blocker) {
+		if (waiter)
+			ldlm_flock_owner_put(ns, waiter);
+		spin_unlock(&ns->ns_flock_lock);
+		return -ENOMEM;
+	}
 
-	req->l_policy_data.l_flock.blocking_owner =
-		lock->l_policy_data.l_flock.owner;
-	req->l_policy_data.l_flock.blocking_export =
-		lock->l_export;
-	atomic_set(&req->l_policy_data.l_flock.blocking_refs, 0);
+	list_add_tail(&req->l_flock_waiting, &waiter->lfo_waiting);
+	req->l_flock_owner = waiter;
+	req->l_flock_blocker = blocker;
+	/* the graph walk may look at @req from any other resource */
+	LDLM_LOCK_GET(req);
+	spin_unlock(&ns->ns_flock_lock);
 
-	cfs_hash_add(req->l_export->exp_flock_hash,
-		     &req->l_policy_data.l_flock.owner,
-		     &req->l_exp_flock_hash);
+	return 0;
 }
 
 static inline void ldlm_flock_blocking_unlink(struct ldlm_lock *req)
 {
+	struct ldlm_namespace *ns;
+
 	/* For server only */
 	if (req->l_export == NULL)
 		return;
 
 	check_res_locked(req->l_resource);
-	if (req->l_export->exp_flock_hash != NULL &&
-	    !hlist_unhashed(&req->l_exp_flock_hash))
-		cfs_hash_del(req->l_export->exp_flock_hash,
-			     &req->l_policy_data.l_flock.owner,
-			     &req->l_exp_flock_hash);
+	if (req->l_flock_owner == NULL)
+		return;
+
+	ns = ldlm_lock_to_ns(req);
+	spin_lock(&ns->ns_flock_lock);
+	list_del_init(&req->l_flock_waiting);
+	ldlm_flock_owner_put(ns, req->l_flock_owner);
+	ldlm_flock_owner_put(ns, req->l_flock_blocker);
+	req->l_flock_owner = NULL;
+	req->l_flock_blocker = NULL;
+	spin_unlock(&ns->ns_flock_lock);
+
+	/* never the last reference, the caller holds one */
+	LDLM_LOCK_RELEASE(req);
 }
 
-/* Remove cancelled lock from resource interval tree. */
+/*
+ * Remove cancelled lock from resource interval tree, and a waiting one from
+ * the deadlock detection graph.
+ */
 void ldlm_flock_unlink_lock(struct ldlm_lock *lock)
 {
 	struct ldlm_resource *res = lock->l_resource;
 
+	ldlm_flock_blocking_unlink(lock);
+
 	if (RB_EMPTY_NODE(&lock->l_fl_rb)) /* duplicate unlink */
 		return;
 
@@ -132,8 +272,8 @@ ldlm_flock_destroy(struct ldlm_lock *lock, enum ldlm_mode mode, __u64 flags)
 
 	LDLM_DEBUG(lock, "%s(mode: %d, flags: %#llx)", __func__, mode, flags);
 
-	/* Safe to not lock here, since it should be empty anyway */
-	LASSERT(hlist_unhashed(&lock->l_exp_flock_hash));
+	/* Safe to not lock here, since it should be unlinked anyway */
+	LASSERT(lock->l_flock_owner == NULL);
 
 	list_del_init(&lock->l_res_link);
 	if (flags == LDLM_FL_WAIT_NOREPROC) {
@@ -155,101 +295,51 @@ ldlm_flock_destroy(struct ldlm_lock *lock, enum ldlm_mode mode, __u64 flags)
 /**
  * POSIX locks deadlock detection code.
  *
- * Given a new lock \a req and an existing lock \a bl_lock it conflicts
- * with, we need to iterate through all blocked POSIX locks for this
- * export and see if there is a deadlock condition arising. (i.e. when
- * one client holds a lock on something and want a lock on something
- * else and at the same time another client has the opposite situation).
+ * Given a new lock \a req blocked by an existing lock \a bl_lock, follow the
+ * owners blocked on one another in the wait-for graph, starting with the
+ * owner of \a bl_lock. There is a deadlock if this leads back to the owner of
+ * \a req (i.e. when one client holds a lock on something and want a lock on
+ * something else and at the same time another client has the opposite
+ * situation). The request must already be linked into the graph.
  */
-struct ldlm_flock_lookup_cb_data {
-	__u64 *bl_owner;
-	struct ldlm_lock *lock;
-	struct obd_export *exp;
-};
-
-static int ldlm_flock_lookup_cb(struct obd_export *exp, void *data)
-{
-	struct ldlm_flock_lookup_cb_data *cb_data = data;
-	struct ldlm_lock *lock;
-
-	if (exp->exp_failed)
-		return 0;
-
-	lock = cfs_hash_lookup(exp->exp_flock_hash, cb_data->bl_owner);
-	if (lock == NULL)
-		return 0;
-
-	/* Stop on first found lock. Same process can't sleep twice */
-	cb_data->lock = lock;
-	cb_data->exp = class_export_get(exp);
-
-	return 1;
-}
-
 static int
 ldlm_flock_deadlock(struct ldlm_lock *req, struct ldlm_lock *bl_lock)
 {
-	struct obd_export *req_exp = req->l_export;
-	struct obd_export *bl_exp = bl_lock->l_export;
-	__u64 req_owner = req->l_policy_data.l_flock.owner;
-	__u64 bl_owner = bl_lock->l_policy_data.l_flock.owner;
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(req);
+	struct ldlm_flock_owner *lfo;
+	unsigned int hops = 0;
+	int rc = 0;
 
 	/* For server only */
-	if (req_exp == NULL)
+	if (req->l_export == NULL || req->l_flock_owner == NULL)
 		return 0;
 
-	class_export_get(bl_exp);
-	while (1) {
-		struct ldlm_flock_lookup_cb_data cb_data = {
-			.bl_owner = &bl_owner,
-			.lock = NULL,
-			.exp = NULL,
-		};
-		struct ptlrpc_connection *bl_exp_conn;
-		struct obd_export *bl_exp_new;
-		struct ldlm_lock *lock = NULL;
-		struct ldlm_flock *flock;
-
-		bl_exp_conn = bl_exp->exp_connection;
-		if (bl_exp->exp_flock_hash != NULL) {
-			obd_nid_export_for_each(bl_exp->exp_obd,
-						&bl_exp_conn->c_peer.nid,
-						ldlm_flock_lookup_cb,
-						&cb_data);
-			lock = cb_data.lock;
-		}
-		if (lock == NULL)
-			break;
-
-		class_export_put(bl_exp);
-		bl_exp = cb_data.exp;
-
-		flock = &lock->l_policy_data.l_flock;
-		LASSERT(flock->owner == bl_owner);
-		bl_owner = flock->blocking_owner;
-		bl_exp_new = class_export_get(flock->blocking_export);
-		class_export_put(bl_exp);
-
-		cfs_hash_put(bl_exp->exp_flock_hash, &lock->l_exp_flock_hash);
-		bl_exp = bl_exp_new;
+	spin_lock(&ns->ns_flock_lock);
+	lfo = req->l_flock_blocker;
+	while (lfo != NULL) {
+		struct ldlm_lock *lock;
 
-		if (req == lock) {
-			class_export_put(bl_exp);
-			return 1;
+		if (lfo == req->l_flock_owner) {
+			rc = 1;
+			break;
 		}
-		if (bl_exp->exp_failed)
+
+		/* Stop on first blocked request. Same process can't sleep
+		 * twice, but threads sharing an owner could already have
+		 * formed a cycle which does not go through @req.
+		 */
+		lock = list_first_entry_or_null(&lfo->lfo_waiting,
+						struct ldlm_lock,
+						l_flock_waiting);
+		if (lock == NULL || lock->l_export->exp_failed ||
+		    ++hops > ns->ns_flock_nr_owners)
 			break;
 
-		if (bl_owner == req_owner &&
-		    nid_same(&bl_exp_conn->c_peer.nid,
-			     &req_exp->exp_connection->c_peer.nid)) {
-			class_export_put(bl_exp);
-			return 1;
-		}
+		lfo = lock->l_flock_blocker;
 	}
-	class_export_put(bl_exp);
+	spin_unlock(&ns->ns_flock_lock);
 
-	return 0;
+	return rc;
 }
 
 static void ldlm_flock_cancel_on_deadlock(struct ldlm_lock *lock,
@@ -441,8 +531,11 @@ reprocess:
 
 			if (intention != LDLM_PROCESS_ENQUEUE) {
 				ldlm_flock_blocking_unlink(req);
-				ldlm_flock_blocking_link(req, lock);
-				if (ldlm_flock_deadlock(req, lock)) {
+				/* without memory for the graph the request
+				 * just keeps waiting unchecked
+				 */
+				if (ldlm_flock_blocking_link(req, lock) == 0 &&
+				    ldlm_flock_deadlock(req, lock)) {
 					ldlm_flock_cancel_on_deadlock(
 						req, grant_work);
 					RETURN(LDLM_ITER_CONTINUE);
@@ -472,7 +565,11 @@ reprocess:
 			/* Add lock to blocking list before deadlock
 			 * check to prevent race
 			 */
-			ldlm_flock_blocking_link(req, lock);
+			if (ldlm_flock_blocking_link(req, lock)) {
+				ldlm_flock_destroy(req, mode, *flags);
+				*err = -ENOMEM;
+				RETURN(LDLM_ITER_STOP);
+			}
 
 			if (ldlm_flock_deadlock(req, lock)) {
 				ldlm_flock_blocking_unlink(req);
@@ -495,7 +592,7 @@ reprocess:
 	}
 
 	/* In case we had slept on this lock request take it off of the
-	 * deadlock detection hash list.
+	 * deadlock detection graph.
 	 */
 	ldlm_flock_blocking_unlink(req);
 #endif /* HAVE_SERVER_SUPPORT */
@@ -831,7 +928,7 @@ ldlm_flock_completion_ast(struct ldlm_lock *lock, __u64 flags, void *data)
 	rc = l_wait_event_abortable(lock->l_waitq,
 				    is_granted_or_cancelled(lock));
 	if (rc < 0) {
-		/* take lock off the deadlock detection hash list. */
+		/* take lock off the deadlock detection graph. */
 		lock_res_and_lock(lock);
 		ldlm_flock_blocking_unlink(lock);
 
@@ -1019,7 +1116,7 @@ int ldlm_flock_blocking_ast(struct ldlm_lock *lock, struct ldlm_lock_desc *desc,
 	LASSERT(lock);
 	LASSERT(flag == LDLM_CB_CANCELING);
 
-	/* take lock off the deadlock detection hash list. */
+	/* take lock off the deadlock detection graph. */
 	lock_res_and_lock(lock);
 	ldlm_flock_blocking_unlink(lock);
 	unlock_res_and_lock(lock);
@@ -1044,106 +1141,3 @@ void ldlm_flock_policy_local_to_wire(const union ldlm_policy_data *lpolicy,
 	wpolicy->l_flock.lfw_pid = lpolicy->l_flock.pid;
 	wpolicy->l_flock.lfw_owner = lpolicy->l_flock.owner;
 }
-
-/*
- * Export handle<->flock hash operations.
- */
-static unsigned int
-ldlm_export_flock_hash(struct cfs_hash *hs, const void *key,
-		       const unsigned int bits)
-{
-	return cfs_hash_64(*(__u64 *)key, bits);
-}
-
-static void *
-ldlm_export_flock_key(struct hlist_node *hnode)
-{
-	struct ldlm_lock *lock;
-
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
-	return &lock->l_policy_data.l_flock.owner;
-}
-
-static int
-ldlm_export_flock_keycmp(const void *key, struct hlist_node *hnode)
-{
-	return !memcmp(ldlm_export_flock_key(hnode), key, sizeof(__u64));
-}
-
-static void *
-ldlm_export_flock_object(struct hlist_node *hnode)
-{
-	return hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
-}
-
-static void
-ldlm_export_flock_get(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-	struct ldlm_lock *lock;
-	struct ldlm_flock *flock;
-
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
-	ldlm_lock_get(lock);
-
-	flock = &lock->l_policy_data.l_flock;
-	LASSERT(flock->blocking_export != NULL);
-	class_export_get(flock->blocking_export);
-	atomic_inc(&flock->blocking_refs);
-}
-
-static void
-ldlm_export_flock_put(struct cfs_hash *hs, struct hlist_node *hnode)
-{
-	struct ldlm_lock *lock;
-	struct ldlm_flock *flock;
-
-	lock = hlist_entry(hnode, struct ldlm_lock, l_exp_flock_hash);
-
-	flock = &lock->l_policy_data.l_flock;
-	LASSERT(flock->blocking_export != NULL);
-	class_export_put(flock->blocking_export);
-	if (atomic_dec_and_test(&flock->blocking_refs)) {
-		flock->blocking_owner = 0;
-		flock->blocking_export = NULL;
-	}
-	ldlm_lock_put(lock);
-}
-
-static struct cfs_hash_ops ldlm_export_flock_ops = {
-	.hs_hash        = ldlm_export_flock_hash,
-	.hs_key         = ldlm_export_flock_key,
-	.hs_keycmp      = ldlm_export_flock_keycmp,
-	.hs_object      = ldlm_export_flock_object,
-	.hs_get         = ldlm_export_flock_get,
-	.hs_put         = ldlm_export_flock_put,
-	.hs_put_locked  = ldlm_export_flock_put,
-};
-
-int ldlm_init_flock_export(struct obd_export *exp)
-{
-	if (strcmp(exp->exp_obd->obd_type->typ_name, LUSTRE_MDT_NAME) != 0)
-		RETURN(0);
-
-	exp->exp_flock_hash =
-		cfs_hash_create(obd_uuid2str(&exp->exp_client_uuid),
-				HASH_EXP_LOCK_CUR_BITS,
-				HASH_EXP_LOCK_MAX_BITS,
-				HASH_EXP_LOCK_BKT_BITS, 0,
-				CFS_HASH_MIN_THETA, CFS_HASH_MAX_THETA,
-				&ldlm_export_flock_ops,
-				CFS_HASH_DEFAULT | CFS_HASH_NBLK_CHANGE);
-	if (!exp->exp_flock_hash)
-		RETURN(-ENOMEM);
-
-	RETURN(0);
-}
-
-void ldlm_destroy_flock_export(struct obd_export *exp)
-{
-	ENTRY;
-	if (exp->exp_flock_hash) {
-		cfs_hash_putref(exp->exp_flock_hash);
-		exp->exp_flock_hash = NULL;
-	}
-	EXIT;
-}
@@ -140,6 +140,32 @@ static inline bool ldlm_txn_same_server(const struct ldlm_lock *req,
 			req->l_policy_data.l_inodebits.li_initiator_id;
 }
 
+/**
+ * Check the per-bit granted counters of \a res for a granted lock holding
+ * any of \a bits in a mode incompatible with \a mode.
+ *
+ * \retval false if no granted lock can conflict, so the granted queue need
+ *	   not be walked at all
+ */
+static bool ldlm_inodebits_granted_may_conflict(struct ldlm_resource *res,
+						enum ldlm_mode mode,
+						__u64 bits)
+{
+	struct ldlm_ibits_queues *queues = res->lr_ibits_queues;
+	__u32 modes = 0;
+	int i;
+
+	for (i = 0; i < MDS_INODELOCK_NUMBITS; i++)
+		if (bits & BIT(i))
+			modes |= queues->liq_granted_modes[i];
+
+	for (i = 0; modes != 0; i++, modes >>= 1)
+		if ((modes & 1) && !lockmode_compat(BIT(i), mode))
+			return true;
+
+	return false;
+}
+
 /**
  * Determine if the lock is compatible with all locks on the queue.
  *
@@ -154,6 +180,10 @@ static inline bool ldlm_txn_same_server(const struct ldlm_lock *req,
  * bunch contains a pointer to the end of the bunch.  This allows us to
  * skip an entire bunch when iterating the list in search for conflicting
  * locks if first lock of the bunch is not conflicting with us.
+ *
+ * On the server, the granted queue is not walked at all when the per-bit
+ * granted counters show no lock with both a shared bit and a conflicting
+ * mode, which is the common case for hot directories with many PR locks.
  */
 static int
 ldlm_inodebits_compat_queue(struct list_head *queue, struct ldlm_lock *req,
@@ -183,6 +213,16 @@ ldlm_inodebits_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 		     (req_bits | *try_bits) != MDS_INODELOCK_DOM))
 		RETURN(-EPROTO);
 
+	/* Granted locks have no try_bits to drop, so with nothing to conflict
+	 * with the walk below would only come to the same answer.
+	 * GROUP locks need the walk to find their own group.
+	 */
+	if (queue == &req->l_resource->lr_granted && ldlm_is_ns_srv(req) &&
+	    req_mode != LCK_GROUP &&
+	    !ldlm_inodebits_granted_may_conflict(req->l_resource, req_mode,
+						 req_bits | *try_bits))
+		RETURN(1);
+
 	list_for_each(tmp, queue) {
 		struct list_head *mode_tail;
 
@@ -495,7 +535,6 @@ EXPORT_SYMBOL(ldlm_inodebits_drop);
 int ldlm_cli_inodebits_convert(struct ldlm_lock *lock,
 			       enum ldlm_cancel_flags cancel_flags)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
 	struct ldlm_lock_desc ld = { { 0 } };
 	__u64 drop_bits, new_bits;
 	__u32 flags = 0;
@@ -581,10 +620,8 @@ int ldlm_cli_inodebits_convert(struct ldlm_lock *lock,
 	 */
 	ldlm_clear_cbpending(lock);
 	ldlm_clear_bl_ast(lock);
-	spin_lock(&ns->ns_lock);
 	if (list_empty(&lock->l_lru))
-		ldlm_lock_add_to_lru_nolock(lock);
-	spin_unlock(&ns->ns_lock);
+		ldlm_lock_add_to_lru(lock);
 
 	/* the job is done, zero the cancel_bits. If more conflicts appear,
 	 * it will result in another cycle of ldlm_cli_inodebits_convert().
@@ -655,6 +692,40 @@ void ldlm_inodebits_add_lock(struct ldlm_resource *res, struct list_head *head,
 	}
 }
 
+/* Account a granted server lock in the per-bit granted counters. */
+static void ldlm_inodebits_count_granted(struct ldlm_lock *lock, bool add)
+{
+	struct ldlm_ibits_queues *queues = lock->l_resource->lr_ibits_queues;
+	__u64 bits = lock->l_policy_data.l_inodebits.bits;
+	int mode = ffs(lock->l_granted_mode) - 1;
+	int i;
+
+	if (mode < 0)
+		return;
+
+	for (i = 0; i < MDS_INODELOCK_NUMBITS; i++) {
+		if (!(bits & BIT(i)))
+			continue;
+
+		if (add) {
+			if (queues->liq_granted[i][mode]++ == 0)
+				queues->liq_granted_modes[i] |= BIT(mode);
+		} else {
+			LASSERT(queues->liq_granted[i][mode] > 0);
+			if (--queues->liq_granted[i][mode] == 0)
+				queues->liq_granted_modes[i] &= ~BIT(mode);
+		}
+	}
+}
+
+void ldlm_inodebits_add_granted(struct ldlm_lock *lock)
+{
+	check_res_locked(lock->l_resource);
+
+	if (ldlm_is_ns_srv(lock))
+		ldlm_inodebits_count_granted(lock, true);
+}
+
 void ldlm_inodebits_unlink_lock(struct ldlm_lock *lock)
 {
 	int i;
@@ -663,6 +734,9 @@ void ldlm_inodebits_unlink_lock(struct ldlm_lock *lock)
 	if (!ldlm_is_ns_srv(lock))
 		return;
 
+	if (!list_empty(&lock->l_res_link) && ldlm_is_granted(lock))
+		ldlm_inodebits_count_granted(lock, false);
+
 	for (i = 0; i < MDS_INODELOCK_NUMBITS; i++)
 		list_del_init(&lock->l_ibits_node->lin_link[i]);
 }
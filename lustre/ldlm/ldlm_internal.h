@@ -82,6 +82,8 @@ int ldlm_cancel_lru_local(struct ldlm_namespace *ns,
 			  struct list_head *cancels, int min, int max,
 			  enum ldlm_cancel_flags cancel_flags,
 			  enum ldlm_lru_flags lru_flags);
+int ldlm_cli_cancel_batch(struct ldlm_namespace *ns,
+			  struct list_head *cancels, int count);
 extern unsigned int ldlm_enqueue_min;
 /* ldlm_resource.c */
 extern struct kmem_cache *ldlm_resource_slab;
@@ -141,7 +143,20 @@ int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, ktime_t last_use);
 #define ldlm_lock_remove_from_lru(lock) \
 		ldlm_lock_remove_from_lru_check(lock, ktime_set(0, 0))
 int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock);
-void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock);
+void ldlm_lock_add_to_lru(struct ldlm_lock *lock);
+
+/* number of unused locks in all LRU partitions of \a ns */
+static inline int ldlm_ns_nr_unused(struct ldlm_namespace *ns)
+{
+	struct ldlm_ns_lru *lru;
+	int nr = 0;
+	int i;
+
+	cfs_percpt_for_each(lru, i, ns->ns_lru)
+		nr += READ_ONCE(lru->nl_nr_unused);
+
+	return nr;
+}
 void ldlm_lock_touch_in_lru(struct ldlm_lock *lock);
 void ldlm_lock_destroy_nolock(struct ldlm_lock *lock);
 
@@ -185,6 +200,8 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 			     enum ldlm_error *err, struct list_head *work_list);
 #endif
 void ldlm_extent_add_lock(struct ldlm_resource *res, struct ldlm_lock *lock);
+void ldlm_extent_add_waiting_lock(struct ldlm_resource *res,
+				  struct ldlm_lock *lock);
 void ldlm_extent_unlink_lock(struct ldlm_lock *lock);
 void ldlm_extent_search(struct interval_tree_root *root,
 			u64 start, u64 end,
@@ -195,13 +212,14 @@ int ldlm_inodebits_alloc_lock(struct ldlm_lock *lock);
 void ldlm_inodebits_add_lock(struct ldlm_resource *res, struct list_head *head,
 			     struct ldlm_lock *lock, bool tail);
 void ldlm_inodebits_unlink_lock(struct ldlm_lock *lock);
+void ldlm_inodebits_add_granted(struct ldlm_lock *lock);
 
 /* ldlm_flock.c */
 int ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags,
 			    enum ldlm_process_intention intention,
 			    enum ldlm_error *err, struct list_head *work_list);
-int ldlm_init_flock_export(struct obd_export *exp);
-void ldlm_destroy_flock_export(struct obd_export *exp);
+int ldlm_flock_graph_init(struct ldlm_namespace *ns);
+void ldlm_flock_graph_fini(struct ldlm_namespace *ns);
 void ldlm_flock_add_lock(struct ldlm_resource *req, struct list_head *head,
 			 struct ldlm_lock *lock);
 void ldlm_flock_unlink_lock(struct ldlm_lock *lock);
@@ -389,6 +407,7 @@ void ldlm_reclaim_cleanup(void);
 void ldlm_reclaim_add(struct ldlm_lock *lock);
 void ldlm_reclaim_del(struct ldlm_lock *lock);
 bool ldlm_reclaim_full(void);
+int ldlm_reclaim_top_seq_show(struct seq_file *m, void *v);
 
 static inline bool ldlm_res_eq(const struct ldlm_res_id *res0,
 			       const struct ldlm_res_id *res1)
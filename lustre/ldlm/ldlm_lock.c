@@ -227,22 +227,28 @@ void ldlm_lock_put(struct ldlm_lock *lock)
 }
 EXPORT_SYMBOL(ldlm_lock_put);
 
+static inline struct ldlm_ns_lru *ldlm_lock_lru(struct ldlm_lock *lock)
+{
+	return ldlm_lock_to_ns(lock)->ns_lru[lock->l_lru_cpt];
+}
+
 /**
- * Removes LDLM lock \a lock from LRU. Assumes LRU is already locked.
+ * Removes LDLM lock \a lock from LRU. Assumes the LRU partition of the lock
+ * is already locked.
  */
 int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock)
 {
 	int rc = 0;
 
 	if (!list_empty(&lock->l_lru)) {
-		struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+		struct ldlm_ns_lru *lru = ldlm_lock_lru(lock);
 
 		LASSERT(lock->l_resource->lr_type != LDLM_FLOCK);
-		if (ns->ns_last_pos == &lock->l_lru)
-			ns->ns_last_pos = lock->l_lru.prev;
+		if (lru->nl_last_pos == &lock->l_lru)
+			lru->nl_last_pos = lock->l_lru.prev;
 		list_del_init(&lock->l_lru);
-		LASSERT(ns->ns_nr_unused > 0);
-		ns->ns_nr_unused--;
+		LASSERT(lru->nl_nr_unused > 0);
+		lru->nl_nr_unused--;
 		rc = 1;
 	}
 	return rc;
@@ -250,6 +256,8 @@ int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock)
 
 /**
  * Removes LDLM lock \a lock from LRU. Obtains the LRU lock first.
+ * Must be called with the resource lock held, so that the lock cannot
+ * move to another LRU partition meanwhile.
  *
  * If \a last_use is non-zero, it will remove the lock from LRU only if
  * it matches lock's l_last_used.
@@ -261,7 +269,7 @@ int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock)
  */
 int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, ktime_t last_use)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_ns_lru *lru;
 	int rc = 0;
 
 	ENTRY;
@@ -270,47 +278,49 @@ int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, ktime_t last_use)
 		RETURN(0);
 	}
 
-	spin_lock(&ns->ns_lock);
+	lru = ldlm_lock_lru(lock);
+	spin_lock(&lru->nl_lock);
 	if (!ktime_compare(last_use, ktime_set(0, 0)) ||
 	    !ktime_compare(last_use, lock->l_last_used))
 		rc = ldlm_lock_remove_from_lru_nolock(lock);
-	spin_unlock(&ns->ns_lock);
+	spin_unlock(&lru->nl_lock);
 
 	RETURN(rc);
 }
 
-/* Adds LDLM lock \a lock to namespace LRU. Assumes LRU is already locked.  */
-void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock)
-{
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
-
-	lock->l_last_used = ktime_get();
-	LASSERT(list_empty(&lock->l_lru));
-	LASSERT(lock->l_resource->lr_type != LDLM_FLOCK);
-	list_add_tail(&lock->l_lru, &ns->ns_unused_list);
-	LASSERT(ns->ns_nr_unused >= 0);
-	ns->ns_nr_unused++;
-}
-
-/* Adds LDLM lock \a lock to namespace LRU. Obtains necessary LRU locks first */
-static void ldlm_lock_add_to_lru(struct ldlm_lock *lock)
+/**
+ * Adds LDLM lock \a lock to the LRU partition of the current CPU.
+ * Obtains the LRU lock first, the resource lock must be held.
+ */
+void ldlm_lock_add_to_lru(struct ldlm_lock *lock)
 {
 	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	int cpt = cfs_cpt_current(cfs_cpt_tab, 1);
+	struct ldlm_ns_lru *lru = ns->ns_lru[cpt];
 
 	ENTRY;
-	spin_lock(&ns->ns_lock);
-	ldlm_lock_add_to_lru_nolock(lock);
-	spin_unlock(&ns->ns_lock);
+	LASSERT(lock->l_resource->lr_type != LDLM_FLOCK);
+	spin_lock(&lru->nl_lock);
+	LASSERT(list_empty(&lock->l_lru));
+	lock->l_last_used = ktime_get();
+	lock->l_lru_cpt = cpt;
+	lock->l_lru_spared = 0;
+	list_add_tail(&lock->l_lru, &lru->nl_unused_list);
+	LASSERT(lru->nl_nr_unused >= 0);
+	lru->nl_nr_unused++;
+	spin_unlock(&lru->nl_lock);
 	EXIT;
 }
 
 /**
  * Moves LDLM lock \a lock that is already in namespace LRU to the tail of
- * the LRU. Performs necessary LRU locking
+ * the LRU of the current CPU. Performs necessary LRU locking, the resource
+ * lock must be held.
  */
 void ldlm_lock_touch_in_lru(struct ldlm_lock *lock)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_ns_lru *lru;
+	int removed;
 
 	ENTRY;
 	if (ldlm_is_ns_srv(lock)) {
@@ -319,12 +329,13 @@ void ldlm_lock_touch_in_lru(struct ldlm_lock *lock)
 		return;
 	}
 
-	spin_lock(&ns->ns_lock);
-	if (!list_empty(&lock->l_lru)) {
-		ldlm_lock_remove_from_lru_nolock(lock);
-		ldlm_lock_add_to_lru_nolock(lock);
-	}
-	spin_unlock(&ns->ns_lock);
+	lru = ldlm_lock_lru(lock);
+	spin_lock(&lru->nl_lock);
+	removed = ldlm_lock_remove_from_lru_nolock(lock);
+	spin_unlock(&lru->nl_lock);
+
+	if (removed)
+		ldlm_lock_add_to_lru(lock);
 	EXIT;
 }
 
@@ -369,6 +380,10 @@ static int ldlm_lock_destroy_internal(struct ldlm_lock *lock)
 	ldlm_set_destroyed(lock);
 	wake_up(&lock->l_waitq);
 
+	/* merged prolong results may count this lock */
+	if (lock->l_export)
+		atomic_inc(&lock->l_export->exp_prolong_gen);
+
 	if (lock->l_export && lock->l_export->exp_lock_hash) {
 		/* Safe to call cfs_hash_del as lock isn't in exp_lock_hash. */
 		/* below, .hs_keycmp resolves to ldlm_export_lock_keycmp() */
@@ -454,7 +469,9 @@ static struct ldlm_lock *ldlm_lock_new(struct ldlm_resource *resource)
 		INIT_LIST_HEAD(&lock->l_sl_policy);
 		break;
 	case LDLM_FLOCK:
-		INIT_HLIST_NODE(&lock->l_exp_flock_hash);
+		INIT_LIST_HEAD(&lock->l_flock_waiting);
+		lock->l_flock_owner = NULL;
+		lock->l_flock_blocker = NULL;
 		RB_CLEAR_NODE(&lock->l_fl_rb);
 		break;
 	case LDLM_EXTENT:
@@ -492,6 +509,8 @@ struct ldlm_lock *ldlm_lock_new_testing(struct ldlm_resource *resource)
 	if (!lock)
 		return NULL;
 	lock->l_flags |= BIT(63);
+	if (ns_is_server(ldlm_res_to_ns(resource)))
+		ldlm_set_ns_srv(lock);
 	switch (resource->lr_type) {
 	case LDLM_IBITS:
 		rc = ldlm_inodebits_alloc_lock(lock);
@@ -1093,6 +1112,9 @@ void ldlm_grant_lock_with_skiplist(struct ldlm_lock *lock)
 
 	search_granted_lock(&lock->l_resource->lr_granted, lock, &prev);
 	ldlm_granted_list_add_lock(lock, &prev);
+	if (lock->l_resource->lr_type == LDLM_IBITS &&
+	    !list_empty(&lock->l_res_link))
+		ldlm_inodebits_add_granted(lock);
 }
 
 /**
@@ -38,6 +38,11 @@ static char *ldlm_cpts;
 module_param(ldlm_cpts, charp, 0444);
 MODULE_PARM_DESC(ldlm_cpts, "CPU partitions ldlm threads should run on");
 
+static unsigned int ldlm_bl_batch_max = 64;
+module_param(ldlm_bl_batch_max, uint, 0644);
+MODULE_PARM_DESC(ldlm_bl_batch_max,
+		 "max queued blocking ASTs cancelled together (0 to disable)");
+
 static DEFINE_MUTEX(ldlm_ref_mutex);
 static int ldlm_refcount;
 
@@ -431,6 +436,8 @@ static int ldlm_add_waiting_lock(struct ldlm_lock *lock, timeout_t timeout)
 	 */
 	if (lock->l_export != NULL) {
 		obd = lock->l_export->exp_obd;
+		/* next prolong walk has to see this lock as blocking */
+		atomic_inc(&lock->l_export->exp_prolong_gen);
 
 		if (exp_connect_flags(lock->l_export) & OBD_CONNECT_MDS_MDS)
 			return 0;
@@ -2909,6 +2916,147 @@ static int ldlm_bl_thread_need_create(struct ldlm_bl_pool *blp,
 	return 1;
 }
 
+/**
+ * Check whether blocking AST work item \a blwi may be folded into a batched
+ * cancel for locks of export \a exp.
+ *
+ * Only extent locks are batched: their client blocking AST does nothing but
+ * cancel the lock, while the data flush is done by the LDLM_CB_CANCELING
+ * callback which the batched local cancel runs as well.
+ */
+static bool ldlm_bl_blwi_batchable(struct ldlm_bl_work_item *blwi,
+				   struct obd_export *exp)
+{
+	struct ldlm_lock *lock = blwi->blwi_lock;
+
+	if (lock == NULL || blwi->blwi_count != 0 ||
+	    blwi->blwi_mem_pressure || !(blwi->blwi_flags & LCF_ASYNC))
+		return false;
+
+	/* granted lock, the resource cannot change */
+	if (lock->l_resource->lr_type != LDLM_EXTENT || !ldlm_is_bl_ast(lock))
+		return false;
+
+	if (lock->l_conn_export == NULL || !exp_connect_cancelset(exp))
+		return false;
+
+	return lock->l_conn_export == exp;
+}
+
+/**
+ * Coalesce blocking ASTs queued for the same namespace and export.
+ *
+ * When a shared file or directory is revoked the server sends one blocking
+ * AST per lock, and each of them would otherwise produce its own LDLM_CANCEL
+ * RPC. Pull the other queued blocking ASTs for locks of the same export off
+ * the priority list and cancel all unused ones with a single batched cancel.
+ *
+ * Cancelling a lock flushes the pages it covers, and the batch is cancelled
+ * serially by this thread. To not have the last locks miss their blocking
+ * callback deadline behind the flush of the others, only locks that have
+ * no pages cached, as told by ns_lock_has_pages(), join the batch. The
+ * others go back to the priority list for the other blocking threads.
+ *
+ * \retval true if \a blwi was handled (and its lock reference consumed)
+ * \retval false if the caller should handle \a blwi by itself
+ */
+static bool ldlm_bl_thread_batch(struct ldlm_bl_pool *blp,
+				 struct ldlm_bl_work_item *blwi)
+{
+	struct ldlm_namespace *ns = blwi->blwi_ns;
+	struct obd_export *exp = blwi->blwi_lock->l_conn_export;
+	struct ldlm_bl_work_item *tmp, *next;
+	unsigned int max = READ_ONCE(ldlm_bl_batch_max);
+	LIST_HEAD(batch);
+	LIST_HEAD(putback);
+	LIST_HEAD(cancels);
+	int nback = 0;
+	int count = 0;
+	int nr = 1;
+
+	ENTRY;
+
+	if (max < 2 || exp == NULL || !ldlm_bl_blwi_batchable(blwi, exp))
+		RETURN(false);
+
+	spin_lock(&blp->blp_lock);
+	list_for_each_entry_safe(tmp, next, &blp->blp_prio_list, blwi_entry) {
+		if (nr >= max)
+			break;
+		if (tmp->blwi_ns != ns || !ldlm_bl_blwi_batchable(tmp, exp))
+			continue;
+
+		list_move_tail(&tmp->blwi_entry, &batch);
+		blp->blp_total_locks--;
+		blp->blp_total_blwis--;
+		nr++;
+	}
+	spin_unlock(&blp->blp_lock);
+
+	if (nr > 1 && ns->ns_lock_has_pages != NULL) {
+		list_for_each_entry_safe(tmp, next, &batch, blwi_entry) {
+			if (!ns->ns_lock_has_pages(tmp->blwi_lock))
+				continue;
+
+			list_move_tail(&tmp->blwi_entry, &putback);
+			nback++;
+			nr--;
+		}
+	}
+
+	if (nback > 0) {
+		spin_lock(&blp->blp_lock);
+		list_splice(&putback, &blp->blp_prio_list);
+		blp->blp_total_locks += nback;
+		blp->blp_total_blwis += nback;
+		spin_unlock(&blp->blp_lock);
+		wake_up_nr(&blp->blp_waitq, nback);
+	}
+
+	if (nr == 1)
+		RETURN(false);
+
+	list_add(&blwi->blwi_entry, &batch);
+	list_for_each_entry_safe(tmp, next, &batch, blwi_entry) {
+		struct ldlm_lock *lock = tmp->blwi_lock;
+		bool cancel;
+
+		list_del(&tmp->blwi_entry);
+
+		lock_res_and_lock(lock);
+		ldlm_bl_desc2lock(&tmp->blwi_ld, lock);
+		ldlm_set_cbpending(lock);
+		cancel = !lock->l_readers && !lock->l_writers &&
+			 !ldlm_is_canceling(lock) && !ldlm_is_destroyed(lock) &&
+			 !ldlm_is_ast_sent(lock);
+		if (cancel)
+			ldlm_set_canceling(lock);
+		unlock_res_and_lock(lock);
+
+		if (cancel) {
+			LDLM_DEBUG(lock, "blocking AST, batched cancel");
+			/* the blwi lock reference moves to the cancel list */
+			LASSERT(list_empty(&lock->l_bl_ast));
+			list_add_tail(&lock->l_bl_ast, &cancels);
+			count++;
+		} else {
+			ldlm_handle_bl_callback(ns, &tmp->blwi_ld, lock);
+		}
+
+		/* the caller frees or completes the original work item */
+		if (tmp != blwi)
+			OBD_FREE(tmp, sizeof(*tmp));
+	}
+
+	CDEBUG(D_DLMTRACE, "%s: batched %d blocking ASTs, cancelling %d\n",
+	       ldlm_ns_name(ns), nr, count);
+
+	if (count > 0)
+		ldlm_cli_cancel_batch(ns, &cancels, count);
+
+	RETURN(true);
+}
+
 static int ldlm_bl_thread_blwi(struct ldlm_bl_pool *blp,
 			       struct ldlm_bl_work_item *blwi)
 {
@@ -2940,8 +3088,9 @@ static int ldlm_bl_thread_blwi(struct ldlm_bl_pool *blp,
 		ldlm_cli_cancel_list(&blwi->blwi_head, count, NULL,
 				     blwi->blwi_flags);
 	} else if (blwi->blwi_lock) {
-		ldlm_handle_bl_callback(blwi->blwi_ns, &blwi->blwi_ld,
-					blwi->blwi_lock);
+		if (!ldlm_bl_thread_batch(blp, blwi))
+			ldlm_handle_bl_callback(blwi->blwi_ns, &blwi->blwi_ld,
+						blwi->blwi_lock);
 	} else {
 		ldlm_pool_recalc(&blwi->blwi_ns->ns_pool, true);
 		spin_lock(&blwi->blwi_ns->ns_lock);
@@ -3171,8 +3320,6 @@ static struct cfs_hash_ops ldlm_export_lock_ops = {
 
 int ldlm_init_export(struct obd_export *exp)
 {
-	int rc;
-
 	ENTRY;
 
 	exp->exp_lock_hash =
@@ -3188,14 +3335,7 @@ int ldlm_init_export(struct obd_export *exp)
 	if (!exp->exp_lock_hash)
 		RETURN(-ENOMEM);
 
-	rc = ldlm_init_flock_export(exp);
-	if (rc)
-		GOTO(err, rc);
-
 	RETURN(0);
-err:
-	ldlm_destroy_export(exp);
-	RETURN(rc);
 }
 EXPORT_SYMBOL(ldlm_init_export);
 
@@ -3204,8 +3344,6 @@ void ldlm_destroy_export(struct obd_export *exp)
 	ENTRY;
 	cfs_hash_putref(exp->exp_lock_hash);
 	exp->exp_lock_hash = NULL;
-
-	ldlm_destroy_flock_export(exp);
 	EXIT;
 }
 EXPORT_SYMBOL(ldlm_destroy_export);
@@ -3514,7 +3652,7 @@ int ldlm_init(void)
 		goto out_resource;
 
 	ldlm_interval_tree_slab = kmem_cache_create("interval_tree",
-			sizeof(struct ldlm_interval_tree) * LCK_MODE_NUM,
+			sizeof(struct ldlm_interval_tree) * LDLM_ITREE_NUM,
 			0, SLAB_HWCACHE_ALIGN, NULL);
 	if (ldlm_interval_tree_slab == NULL)
 		goto out_lock_slab;
@@ -523,14 +523,13 @@ static int ldlm_cli_pool_shrink(struct ldlm_pool *pl,
 	ldlm_cli_pool_pop_slv(pl);
 	spin_unlock(&pl->pl_lock);
 
-	spin_lock(&ns->ns_lock);
-	unused = ns->ns_nr_unused;
-	spin_unlock(&ns->ns_lock);
+	unused = ldlm_ns_nr_unused(ns);
 
 	if (nr == 0)
 		return (unused / 100) * sysctl_vfs_cache_pressure;
 	else
-		return ldlm_cancel_lru(ns, nr, LCF_ASYNC, 0);
+		return ldlm_cancel_lru(ns, nr, LCF_ASYNC,
+				       LDLM_LRU_FLAG_SHRINK);
 }
 
 static struct ldlm_pool_ops ldlm_srv_pool_ops = {
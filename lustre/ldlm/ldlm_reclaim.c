@@ -33,6 +33,11 @@
  * ldlm_reclaim_threshold & ldlm_lock_limit is set to 20% & 30% of the
  * total memory by default. It is tunable via proc entry, when it's set
  * to 0, the feature is disabled.
+ *
+ * Reclaim first revokes the aged locks of the exports holding far more
+ * locks than the average export of the same target, so that a single
+ * runaway client pays for the memory it takes, and only then scans the
+ * resources of all namespaces in a roundrobin manner.
  */
 
 #ifdef HAVE_SERVER_SUPPORT
@@ -60,6 +65,9 @@ struct ldlm_reclaim_cb_data {
 	bool			 rcd_skip;
 	s64			 rcd_age_ns;
 	struct cfs_hash_bd	*rcd_prev_bd;
+	/* candidates picked from exp_lock_hash, see ldlm_reclaim_export() */
+	struct ldlm_lock	**rcd_locks;
+	int			 rcd_nr_locks;
 };
 
 static inline bool ldlm_lock_reclaimable(struct ldlm_lock *lock)
@@ -210,6 +218,248 @@ static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
 	EXIT;
 }
 
+/**
+ * Callback function for picking the locks of an export to revoke.
+ *
+ * The bucket lock is held, so only take a reference on the aged locks
+ * here, ldlm_reclaim_export() checks them again under the resource lock.
+ *
+ * \param [in] hs	exp_lock_hash
+ * \param [in] bd	current bucket of exp_lock_hash
+ * \param [in] hnode	hnode of the lock
+ * \param [in] arg	opaque data
+ *
+ * \retval 0		continue the scan
+ * \retval 1		stop the iteration
+ */
+static int ldlm_reclaim_export_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+				  struct hlist_node *hnode, void *arg)
+{
+	struct ldlm_reclaim_cb_data *data = arg;
+	struct ldlm_lock *lock = cfs_hash_object(hs, hnode);
+
+	if (ldlm_is_ast_sent(lock) ||
+	    (!CFS_FAIL_CHECK(OBD_FAIL_LDLM_WATERMARK_LOW) &&
+	     ktime_before(ktime_get(), ktime_add_ns(lock->l_last_used,
+						    data->rcd_age_ns))))
+		return 0;
+
+	data->rcd_locks[data->rcd_nr_locks++] = LDLM_LOCK_GET(lock);
+
+	return data->rcd_nr_locks == data->rcd_total;
+}
+
+/**
+ * Collect up to \a data->rcd_total aged locks of \a exp for revocation.
+ *
+ * exp_lock_hash rehashes its keys and cannot be walked without the bucket
+ * locks, under which the resource lock cannot be taken, so the locks are
+ * picked first and queued for the revoke AST afterwards.
+ *
+ * \param[in] exp	export to revoke the locks of
+ * \param[in] data	revoke list and limits, rcd_added is set to the
+ *			number of locks queued on rcd_rpc_list
+ */
+static void ldlm_reclaim_export(struct obd_export *exp,
+				struct ldlm_reclaim_cb_data *data)
+{
+	int i;
+
+	OBD_ALLOC_PTR_ARRAY_LARGE(data->rcd_locks, data->rcd_total);
+	if (!data->rcd_locks)
+		return;
+
+	data->rcd_nr_locks = 0;
+	cfs_hash_for_each(exp->exp_lock_hash, ldlm_reclaim_export_cb, data);
+
+	for (i = 0; i < data->rcd_nr_locks; i++) {
+		struct ldlm_lock *lock = data->rcd_locks[i];
+		bool queued = false;
+
+		lock_res_and_lock(lock);
+		if (ldlm_is_granted(lock) && ldlm_lock_reclaimable(lock) &&
+		    !ldlm_is_ast_sent(lock)) {
+			ldlm_set_ast_sent(lock);
+			LASSERT(list_empty(&lock->l_rk_ast));
+			/* the reference goes with the AST work */
+			list_add(&lock->l_rk_ast, &data->rcd_rpc_list);
+			data->rcd_added++;
+			queued = true;
+		}
+		unlock_res_and_lock(lock);
+
+		if (!queued)
+			LDLM_LOCK_RELEASE(lock);
+	}
+
+	OBD_FREE_PTR_ARRAY_LARGE(data->rcd_locks, data->rcd_total);
+}
+
+/* only exports holding this many times the average are targeted */
+#define LDLM_RECLAIM_HEAVY_FACTOR	2
+
+struct ldlm_reclaim_top {
+	struct obd_export	*rt_exp;
+	int			 rt_locks;
+};
+
+/**
+ * Find the exports of \a obd holding most locks.
+ *
+ * \param[in] obd	target to look at
+ * \param[out] top	up to \a nr exports, with a reference, heaviest first
+ * \param[in] nr	size of \a top
+ * \param[out] total	number of locks held by all the exports
+ * \param[out] holders	number of exports holding any lock
+ *
+ * \retval		number of exports filled into \a top
+ */
+static int ldlm_reclaim_top_exports(struct obd_device *obd,
+				    struct ldlm_reclaim_top *top, int nr,
+				    long *total, int *holders)
+{
+	struct obd_export *exp;
+	int filled = 0;
+	int i;
+
+	*total = 0;
+	*holders = 0;
+
+	spin_lock(&obd->obd_dev_lock);
+	list_for_each_entry(exp, &obd->obd_exports, exp_obd_chain) {
+		int locks = atomic_read(&exp->exp_locks_count);
+
+		if (locks == 0)
+			continue;
+
+		*total += locks;
+		(*holders)++;
+
+		if (filled == nr && locks <= top[nr - 1].rt_locks)
+			continue;
+
+		i = filled < nr ? filled++ : nr - 1;
+		for (; i > 0 && top[i - 1].rt_locks < locks; i--)
+			top[i] = top[i - 1];
+		top[i].rt_exp = exp;
+		top[i].rt_locks = locks;
+	}
+	/* exports on obd_exports are referenced, pin the ones we keep */
+	for (i = 0; i < filled; i++)
+		class_export_get(top[i].rt_exp);
+	spin_unlock(&obd->obd_dev_lock);
+
+	return filled;
+}
+
+#define LDLM_RECLAIM_TOP	8
+
+/**
+ * Revoke the aged locks of the heaviest lock holders of a namespace,
+ * each export down to LDLM_RECLAIM_HEAVY_FACTOR times the average.
+ * The locks of one export are revoked in a single batch of AST RPCs.
+ *
+ * \param[in] ns	namespace to do the lock revoke on
+ * \param[in] count	count of lock to be revoked
+ * \param[in] age	only revoke locks older than the 'age'
+ * \param[out] count	count of lock still to be revoked
+ */
+static void ldlm_reclaim_heavy(struct ldlm_namespace *ns, int *count,
+			       s64 age_ns)
+{
+	struct ldlm_reclaim_top top[LDLM_RECLAIM_TOP];
+	struct ldlm_reclaim_cb_data data;
+	long total, limit;
+	int holders;
+	int nr, i, rc;
+
+	ENTRY;
+
+	if (!ns->ns_obd || atomic_read(&ns->ns_bref) == 0)
+		RETURN_EXIT;
+
+	nr = ldlm_reclaim_top_exports(ns->ns_obd, top, LDLM_RECLAIM_TOP,
+				      &total, &holders);
+	if (nr == 0)
+		RETURN_EXIT;
+
+	limit = total / holders * LDLM_RECLAIM_HEAVY_FACTOR;
+	for (i = 0; i < nr; i++) {
+		struct obd_export *exp = top[i].rt_exp;
+
+		if (*count == 0 || top[i].rt_locks <= limit ||
+		    !exp->exp_lock_hash) {
+			class_export_put(exp);
+			continue;
+		}
+
+		INIT_LIST_HEAD(&data.rcd_rpc_list);
+		data.rcd_added = 0;
+		data.rcd_total = min_t(long, *count, top[i].rt_locks - limit);
+		data.rcd_age_ns = age_ns;
+
+		ldlm_reclaim_export(exp, &data);
+
+		CDEBUG(D_DLMTRACE,
+		       "NS(%s): export %s holds %d locks, average %ld, reclaiming %d\n",
+		       ldlm_ns_name(ns), obd_export_nid2str(exp),
+		       top[i].rt_locks, total / holders, data.rcd_added);
+		class_export_put(exp);
+
+		if (data.rcd_added == 0)
+			continue;
+
+		rc = ldlm_run_ast_work(ns, &data.rcd_rpc_list,
+				       LDLM_WORK_REVOKE_AST);
+		if (rc == -ERESTART)
+			ldlm_reprocess_recovery_done(ns);
+
+		*count -= data.rcd_added;
+	}
+	EXIT;
+}
+
+/**
+ * Show the heaviest lock holders of every server namespace.
+ */
+int ldlm_reclaim_top_seq_show(struct seq_file *m, void *v)
+{
+	enum ldlm_side side = LDLM_NAMESPACE_SERVER;
+	struct ldlm_reclaim_top top[LDLM_RECLAIM_TOP];
+	struct ldlm_namespace *ns;
+	long total;
+	int holders;
+	int nr, i;
+
+	mutex_lock(ldlm_namespace_lock(side));
+	list_for_each_entry(ns, ldlm_namespace_list(side), ns_list_chain) {
+		if (!ns->ns_obd)
+			continue;
+
+		nr = ldlm_reclaim_top_exports(ns->ns_obd, top,
+					      LDLM_RECLAIM_TOP, &total,
+					      &holders);
+		seq_printf(m, "- namespace: %s\n", ldlm_ns_name(ns));
+		seq_printf(m, "  locks: %ld\n", total);
+		seq_printf(m, "  holders: %d\n", holders);
+		seq_puts(m, "  top:\n");
+		for (i = 0; i < nr; i++) {
+			struct obd_export *exp = top[i].rt_exp;
+
+			seq_printf(m,
+				   "  - { client: %s, nid: %s, locks: %d, bytes: %llu }\n",
+				   exp->exp_client_uuid.uuid,
+				   obd_export_nid2str(exp), top[i].rt_locks,
+				   (u64)top[i].rt_locks *
+				   sizeof(struct ldlm_lock));
+			class_export_put(exp);
+		}
+	}
+	mutex_unlock(ldlm_namespace_lock(side));
+
+	return 0;
+}
+
 #define LDLM_RECLAIM_BATCH	512
 #define LDLM_RECLAIM_AGE_MIN	(300 * NSEC_PER_SEC)
 #define LDLM_RECLAIM_AGE_MAX	(LDLM_DEFAULT_LRU_MAX_AGE * NSEC_PER_SEC * 3/4)
@@ -231,8 +481,9 @@ static inline s64 ldlm_reclaim_age(void)
 
 /**
  * Revoke certain amount of locks from all the server namespaces
- * in a roundrobin manner. Lock age is used to avoid reclaim on
- * the non-aged locks.
+ * in a roundrobin manner, starting with the heaviest lock holders
+ * of each namespace. Lock age is used to avoid reclaim on the
+ * non-aged locks.
  */
 static void ldlm_reclaim_ns(void)
 {
@@ -265,7 +516,9 @@ again:
 		ldlm_namespace_move_to_active_locked(ns, ns_cli);
 		mutex_unlock(ldlm_namespace_lock(ns_cli));
 
-		ldlm_reclaim_res(ns, &count, age_ns, skip);
+		ldlm_reclaim_heavy(ns, &count, age_ns);
+		if (count > 0)
+			ldlm_reclaim_res(ns, &count, age_ns, skip);
 		ldlm_namespace_put(ns);
 		nr_processed++;
 	}
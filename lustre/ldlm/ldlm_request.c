@@ -860,7 +860,7 @@ int ldlm_prep_elc_req(struct obd_export *exp, struct ptlrpc_request *req,
 
 		/* If we have reached the limit, free +1 slot for the new one */
 		if (!ns_connect_lru_resize(ns) && opc == LDLM_ENQUEUE &&
-		    ns->ns_nr_unused >= ns->ns_max_unused)
+		    ldlm_ns_nr_unused(ns) >= ns->ns_max_unused)
 			to_free = 1;
 
 		/*
@@ -1690,6 +1690,46 @@ int ldlm_cli_cancel(const struct lustre_handle *lockh,
 }
 EXPORT_SYMBOL(ldlm_cli_cancel);
 
+/**
+ * Cancel a batch of locks which got blocking ASTs over the same export.
+ *
+ * The \a count locks on \a cancels are already marked LDLM_FL_CANCELING
+ * and the caller hands over one reference per lock. They are cancelled
+ * locally and reported to the server with as few LDLM_CANCEL RPCs as the
+ * request format allows; unused LRU locks fill the remaining room.
+ */
+int ldlm_cli_cancel_batch(struct ldlm_namespace *ns,
+			  struct list_head *cancels, int count)
+{
+	struct obd_export *exp;
+	struct ldlm_lock *lock;
+	LIST_HEAD(lru);
+	int avail;
+
+	ENTRY;
+
+	if (list_empty(cancels) || count == 0)
+		RETURN(0);
+
+	lock = list_first_entry(cancels, struct ldlm_lock, l_bl_ast);
+	exp = lock->l_conn_export;
+	avail = ldlm_format_handles_avail(class_exp2cliimp(exp),
+					  &RQF_LDLM_CANCEL, RCL_CLIENT, 0);
+	LASSERT(avail > 0);
+
+	count = ldlm_cli_cancel_list_local(cancels, count, LCF_BL_AST);
+	if (count > 0 && count % avail != 0) {
+		count += ldlm_cancel_lru_local(ns, &lru, 0,
+					       avail - count % avail,
+					       LCF_BL_AST,
+					       LDLM_LRU_FLAG_NO_WAIT);
+		list_splice_tail(&lru, cancels);
+	}
+	ldlm_cli_cancel_list(cancels, count, NULL, LCF_ASYNC);
+
+	RETURN(count);
+}
+
 /**
  * Locally cancel up to \a count locks in list \a cancels.
  * Return the number of cancelled locks.
@@ -1803,7 +1843,7 @@ static enum ldlm_policy_res ldlm_cancel_lrur_policy(struct ldlm_namespace *ns,
 	lvf = ldlm_pool_get_lvf(pl);
 	la = div_u64(ktime_to_ns(ktime_sub(cur, lock->l_last_used)),
 		     NSEC_PER_SEC);
-	lv = lvf * la * ns->ns_nr_unused >> 8;
+	lv = lvf * la * ldlm_ns_nr_unused(ns) >> 8;
 
 	/* Inform pool about current CLV to see it via debugfs. */
 	ldlm_pool_set_clv(pl, lv);
@@ -1887,6 +1927,121 @@ ldlm_cancel_lru_policy(struct ldlm_namespace *ns, enum ldlm_lru_flags lru_flags)
 	}
 }
 
+/**
+ * Give an unused lock that ns_lock_cost() scores as worth keeping a second
+ * chance by moving it to the LRU tail, so that cheaper locks behind it are
+ * cancelled first. The lock is stamped as just used to keep the LRU sorted
+ * by l_last_used, so it is spared only once until it is really used again.
+ * Locks unused for longer than ns_max_age are not spared, and a scan spares
+ * at most \a spare locks so that it always makes progress. Scans that must
+ * free locks now, i.e. cleanup, shrinker and no-wait ones, spare nothing.
+ *
+ * \retval true if the lock was moved and should be left alone by this scan
+ */
+static bool ldlm_lru_spare_lock(struct ldlm_namespace *ns,
+				struct ldlm_lock *lock,
+				enum ldlm_lru_flags lru_flags, int *spare)
+{
+	bool spared = false;
+
+	if (*spare <= 0 || !ns->ns_lock_cost || !ns->ns_lru_cost_keep ||
+	    (lru_flags & (LDLM_LRU_FLAG_CLEANUP | LDLM_LRU_FLAG_SHRINK |
+			  LDLM_LRU_FLAG_NO_WAIT)) || lock->l_lru_spared)
+		return false;
+
+	if (ktime_after(ktime_get(),
+			ktime_add(lock->l_last_used, ns->ns_max_age)))
+		return false;
+
+	if (ns->ns_lock_cost(lock) < ns->ns_lru_cost_keep)
+		return false;
+
+	(*spare)--;
+	/* the resource lock keeps the lock in its LRU partition */
+	lock_res_and_lock(lock);
+	if (!list_empty(&lock->l_lru) && !ldlm_is_canceling(lock) &&
+	    !lock->l_lru_spared) {
+		struct ldlm_ns_lru *lru = ns->ns_lru[lock->l_lru_cpt];
+
+		spin_lock(&lru->nl_lock);
+		if (lru->nl_last_pos == &lock->l_lru)
+			lru->nl_last_pos = lock->l_lru.prev;
+		lock->l_last_used = ktime_get();
+		list_move_tail(&lock->l_lru, &lru->nl_unused_list);
+		spin_unlock(&lru->nl_lock);
+		lock->l_lru_spared = 1;
+		spared = true;
+	}
+	unlock_res_and_lock(lock);
+
+	if (spared)
+		LDLM_DEBUG(lock, "kept in LRU, too costly to cancel");
+
+	return spared;
+}
+
+/**
+ * Find the least recently used lock over all LRU partitions of \a ns.
+ *
+ * Each partition is sorted by l_last_used, locks spared by
+ * ldlm_lru_spare_lock() are requeued with a fresh one, so comparing the
+ * partition heads cancels locks in about the same order as a single LRU list
+ * would, while each partition lock is only held to look at its head.
+ *
+ * \param[in] ns		namespace to scan
+ * \param[in] no_wait	start each partition from its nl_last_pos
+ * \param[out] cpt	partition the lock was found on
+ * \param[out] last_use	l_last_used of the lock when it was found
+ *
+ * \retval lock with a reference held, NULL if all partitions are empty
+ */
+static struct ldlm_lock *ldlm_lru_first(struct ldlm_namespace *ns,
+					bool no_wait, int *cpt,
+					ktime_t *last_use)
+{
+	struct ldlm_lock *best = NULL;
+	struct ldlm_ns_lru *lru;
+	int i;
+
+	cfs_percpt_for_each(lru, i, ns->ns_lru) {
+		struct ldlm_lock *lock = NULL, *old = NULL;
+		struct list_head *item, *next;
+
+		spin_lock(&lru->nl_lock);
+		item = no_wait ? lru->nl_last_pos : &lru->nl_unused_list;
+		for (item = item->next, next = item->next;
+		     item != &lru->nl_unused_list;
+		     item = next, next = item->next) {
+			lock = list_entry(item, struct ldlm_lock, l_lru);
+
+			/* No locks which got blocking requests. */
+			LASSERT(!ldlm_is_bl_ast(lock));
+
+			if (!ldlm_is_canceling(lock))
+				break;
+
+			/*
+			 * Somebody is already doing CANCEL. No need for this
+			 * lock in LRU, do not traverse it again.
+			 */
+			ldlm_lock_remove_from_lru_nolock(lock);
+		}
+		if (item != &lru->nl_unused_list &&
+		    (!best || ktime_before(lock->l_last_used, *last_use))) {
+			old = best;
+			best = ldlm_lock_get(lock);
+			*last_use = lock->l_last_used;
+			*cpt = i;
+		}
+		spin_unlock(&lru->nl_lock);
+
+		if (old)
+			ldlm_lock_put(old);
+	}
+
+	return best;
+}
+
 /**
  * - Free space in LRU for \a min new locks,
  *   redundant unused locks are canceled locally;
@@ -1903,8 +2058,11 @@ ldlm_cancel_lru_policy(struct ldlm_namespace *ns, enum ldlm_lru_flags lru_flags)
  * attempt to cancel a lock rely on this flag, l_bl_ast list is accessed
  * later without any special locking.
  *
- * Locks are cancelled according to the LRU resize policy (SLV from server)
- * if LRU resize is enabled; otherwise, the "aged policy" is used;
+ * Locks are taken oldest first from all CPU partitions of the LRU, see
+ * ldlm_lru_first(), and cancelled according to the LRU resize policy (SLV
+ * from server) if LRU resize is enabled; otherwise, the "aged policy" is
+ * used; locks the namespace scores as costly to re-acquire are passed over
+ * for cheaper ones, see ldlm_lru_spare_lock();
  *
  * LRU flags:
  * ----------------------------------------
@@ -1924,6 +2082,9 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 	ldlm_cancel_lru_policy_t pf;
 	int added = 0;
 	int no_wait = lru_flags & LDLM_LRU_FLAG_NO_WAIT;
+	int nr_unused = ldlm_ns_nr_unused(ns);
+	/* ELC cancels the oldest locks to fill an RPC, nothing to spare */
+	int spare = max == 0 ? nr_unused : 0;
 	ENTRY;
 
 	/*
@@ -1941,7 +2102,7 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 	LASSERT(ergo(max, batch == 0));
 
 	if (!ns_connect_lru_resize(ns))
-		min = max_t(int, min, ns->ns_nr_unused - ns->ns_max_unused);
+		min = max_t(int, min, nr_unused - ns->ns_max_unused);
 
 	/* If at least 1 lock is to be cancelled, cancel at least @batch locks */
 	if (min && min < batch)
@@ -1951,40 +2112,15 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 	LASSERT(pf != NULL);
 
 	/* For any flags, stop scanning if @max is reached. */
-	while (!list_empty(&ns->ns_unused_list) && (max == 0 || added < max)) {
+	while (max == 0 || added < max) {
 		struct ldlm_lock *lock;
-		struct list_head *item, *next;
 		enum ldlm_policy_res result;
 		ktime_t last_use = ktime_set(0, 0);
+		int cpt = 0;
 
-		spin_lock(&ns->ns_lock);
-		item = no_wait ? ns->ns_last_pos : &ns->ns_unused_list;
-		for (item = item->next, next = item->next;
-		     item != &ns->ns_unused_list;
-		     item = next, next = item->next) {
-			lock = list_entry(item, struct ldlm_lock, l_lru);
-
-			/* No locks which got blocking requests. */
-			LASSERT(!ldlm_is_bl_ast(lock));
-
-			if (!ldlm_is_canceling(lock))
-				break;
-
-			/*
-			 * Somebody is already doing CANCEL. No need for this
-			 * lock in LRU, do not traverse it again.
-			 */
-			ldlm_lock_remove_from_lru_nolock(lock);
-		}
-		if (item == &ns->ns_unused_list) {
-			spin_unlock(&ns->ns_lock);
+		lock = ldlm_lru_first(ns, no_wait, &cpt, &last_use);
+		if (!lock)
 			break;
-		}
-
-		last_use = lock->l_last_used;
-
-		ldlm_lock_get(lock);
-		spin_unlock(&ns->ns_lock);
 
 		/*
 		 * Pass the lock through the policy filter and see if it
@@ -2009,17 +2145,26 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 
 		if (result == LDLM_POLICY_SKIP_LOCK) {
 			if (no_wait) {
-				spin_lock(&ns->ns_lock);
-				if (!list_empty(&lock->l_lru) &&
-				    lock->l_lru.prev == ns->ns_last_pos)
-					ns->ns_last_pos = &lock->l_lru;
-				spin_unlock(&ns->ns_lock);
+				struct ldlm_ns_lru *lru = ns->ns_lru[cpt];
+
+				/* only follow links of this partition, the
+				 * lock may have moved to another one since
+				 */
+				spin_lock(&lru->nl_lock);
+				if (lru->nl_last_pos->next == &lock->l_lru)
+					lru->nl_last_pos = &lock->l_lru;
+				spin_unlock(&lru->nl_lock);
 			}
 
 			ldlm_lock_put(lock);
 			continue;
 		}
 
+		if (ldlm_lru_spare_lock(ns, lock, lru_flags, &spare)) {
+			ldlm_lock_put(lock);
+			continue;
+		}
+
 		lock_res_and_lock(lock);
 		/* Check flags again under the lock. */
 		if (ldlm_is_canceling(lock) ||
@@ -2613,7 +2758,7 @@ static void ldlm_cancel_unused_locks_for_replay(struct ldlm_namespace *ns)
 
 	CDEBUG(D_DLMTRACE,
 	       "Dropping as many unused locks as possible before replay for namespace %s (%d)\n",
-	       ldlm_ns_name(ns), ns->ns_nr_unused);
+	       ldlm_ns_name(ns), ldlm_ns_nr_unused(ns));
 
 	CFS_FAIL_TIMEOUT(OBD_FAIL_LDLM_REPLAY_PAUSE, cfs_fail_val);
 
@@ -2622,8 +2767,8 @@ static void ldlm_cancel_unused_locks_for_replay(struct ldlm_namespace *ns)
 	 * because the LDLM_LRU_FLAG_NO_WAIT policy doesn't use the
 	 * count parameter
 	 */
-	canceled = ldlm_cancel_lru_local(ns, &cancels, ns->ns_nr_unused, 0,
-					 LCF_LOCAL, LDLM_LRU_FLAG_NO_WAIT);
+	canceled = ldlm_cancel_lru_local(ns, &cancels, ldlm_ns_nr_unused(ns),
+					 0, LCF_LOCAL, LDLM_LRU_FLAG_NO_WAIT);
 
 	CDEBUG(D_DLMTRACE, "Canceled %d unused locks from namespace %s\n",
 			   canceled, ldlm_ns_name(ns));
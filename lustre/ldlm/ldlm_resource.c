@@ -183,6 +183,19 @@ static const struct file_operations ldlm_granted_fops = {
 	.release = single_release,
 };
 
+static int seq_lock_top_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ldlm_reclaim_top_seq_show, inode->i_private);
+}
+
+static const struct file_operations ldlm_lock_top_fops = {
+	.owner	= THIS_MODULE,
+	.open	= seq_lock_top_open,
+	.read	= seq_read,
+	.llseek	= seq_lseek,
+	.release = single_release,
+};
+
 #endif /* HAVE_SERVER_SUPPORT */
 
 static struct ldebugfs_vars ldlm_debugfs_list[] = {
@@ -202,6 +215,8 @@ static struct ldebugfs_vars ldlm_debugfs_list[] = {
 	{ .name =	"lock_granted_count",
 	  .fops =	&ldlm_granted_fops,
 	  .data =	&ldlm_granted_total },
+	{ .name =	"lock_top_holders",
+	  .fops =	&ldlm_lock_top_fops },
 #endif
 	{ NULL }
 };
@@ -265,7 +280,7 @@ static ssize_t lock_unused_count_show(struct kobject *kobj,
 	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
 						 ns_kobj);
 
-	return sprintf(buf, "%d\n", ns->ns_nr_unused);
+	return sprintf(buf, "%d\n", ldlm_ns_nr_unused(ns));
 }
 LUSTRE_RO_ATTR(lock_unused_count);
 
@@ -274,11 +289,11 @@ static ssize_t lru_size_show(struct kobject *kobj, struct attribute *attr,
 {
 	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
 						 ns_kobj);
-	__u32 *nr = &ns->ns_max_unused;
+	__u32 nr = ns->ns_max_unused;
 
 	if (ns_connect_lru_resize(ns))
-		nr = &ns->ns_nr_unused;
-	return sprintf(buf, "%u\n", *nr);
+		nr = ldlm_ns_nr_unused(ns);
+	return sprintf(buf, "%u\n", nr);
 }
 
 static ssize_t lru_size_store(struct kobject *kobj, struct attribute *attr,
@@ -294,7 +309,7 @@ static ssize_t lru_size_store(struct kobject *kobj, struct attribute *attr,
 		CDEBUG(D_DLMTRACE,
 		       "dropping all unused locks from namespace %s\n",
 		       ldlm_ns_name(ns));
-		/* Try to cancel all @ns_nr_unused locks. */
+		/* Try to cancel all unused locks. */
 		ldlm_cancel_lru(ns, INT_MAX, 0, LDLM_LRU_FLAG_CLEANUP);
 		return count;
 	}
@@ -307,17 +322,18 @@ static ssize_t lru_size_store(struct kobject *kobj, struct attribute *attr,
 	lru_resize = (tmp == 0);
 
 	if (ns_connect_lru_resize(ns)) {
+		int nr_unused = ldlm_ns_nr_unused(ns);
+
 		if (!lru_resize)
 			ns->ns_max_unused = (unsigned int)tmp;
 
-		if (tmp > ns->ns_nr_unused)
-			tmp = ns->ns_nr_unused;
-		tmp = ns->ns_nr_unused - tmp;
+		if (tmp > nr_unused)
+			tmp = nr_unused;
+		tmp = nr_unused - tmp;
 
 		CDEBUG(D_DLMTRACE,
 		       "changing namespace %s unused locks from %u to %u\n",
-		       ldlm_ns_name(ns), ns->ns_nr_unused,
-		       (unsigned int)tmp);
+		       ldlm_ns_name(ns), nr_unused, (unsigned int)tmp);
 
 		if (!lru_resize) {
 			CDEBUG(D_DLMTRACE,
@@ -386,6 +402,35 @@ static ssize_t lru_cancel_batch_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(lru_cancel_batch);
 
+static ssize_t lru_cost_keep_show(struct kobject *kobj,
+				  struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%u\n", ns->ns_lru_cost_keep);
+}
+
+static ssize_t lru_cost_keep_store(struct kobject *kobj,
+				   struct attribute *attr,
+				   const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	unsigned int tmp;
+
+	if (kstrtouint(buffer, 10, &tmp))
+		return -EINVAL;
+
+	if (tmp > 100)
+		return -ERANGE;
+
+	ns->ns_lru_cost_keep = tmp;
+
+	return count;
+}
+LUSTRE_RW_ATTR(lru_cost_keep);
+
 static ssize_t ns_recalc_pct_show(struct kobject *kobj,
 				  struct attribute *attr, char *buf)
 {
@@ -660,6 +705,35 @@ static ssize_t contended_locks_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(contended_locks);
 
+static ssize_t stride_hits_show(struct kobject *kobj,
+				struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%u\n", ns->ns_stride_hits);
+}
+
+static ssize_t stride_hits_store(struct kobject *kobj,
+				 struct attribute *attr,
+				 const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	unsigned int tmp;
+
+	if (kstrtouint(buffer, 10, &tmp))
+		return -EINVAL;
+
+	if (tmp > NS_MAX_STRIDE_HITS)
+		return -ERANGE;
+
+	ns->ns_stride_hits = tmp;
+
+	return count;
+}
+LUSTRE_RW_ATTR(stride_hits);
+
 static ssize_t max_parallel_ast_show(struct kobject *kobj,
 				     struct attribute *attr, char *buf)
 {
@@ -698,6 +772,7 @@ static struct attribute *ldlm_ns_attrs[] = {
 	&lustre_attr_ns_recalc_pct.attr,
 	&lustre_attr_lru_size.attr,
 	&lustre_attr_lru_cancel_batch.attr,
+	&lustre_attr_lru_cost_keep.attr,
 	&lustre_attr_lru_max_age.attr,
 	&lustre_attr_early_lock_cancel.attr,
 	&lustre_attr_dirty_age_limit.attr,
@@ -708,6 +783,7 @@ static struct attribute *ldlm_ns_attrs[] = {
 	&lustre_attr_max_nolock_bytes.attr,
 	&lustre_attr_contention_seconds.attr,
 	&lustre_attr_contended_locks.attr,
+	&lustre_attr_stride_hits.attr,
 	&lustre_attr_max_parallel_ast.attr,
 #endif
 	NULL,
@@ -912,6 +988,7 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 					  enum ldlm_ns_type ns_type)
 {
 	struct ldlm_namespace *ns = NULL;
+	struct ldlm_ns_lru *lru;
 	int idx;
 	int rc;
 
@@ -974,18 +1051,32 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	if (!ns->ns_name)
 		GOTO(out_hash, rc = -ENOMEM);
 
+	ns->ns_lru = cfs_percpt_alloc(cfs_cpt_tab, sizeof(**ns->ns_lru));
+	if (!ns->ns_lru)
+		GOTO(out_hash, rc = -ENOMEM);
+
+	cfs_percpt_for_each(lru, idx, ns->ns_lru) {
+		spin_lock_init(&lru->nl_lock);
+		INIT_LIST_HEAD(&lru->nl_unused_list);
+		lru->nl_nr_unused = 0;
+		lru->nl_last_pos = &lru->nl_unused_list;
+	}
+
 	INIT_LIST_HEAD(&ns->ns_list_chain);
-	INIT_LIST_HEAD(&ns->ns_unused_list);
 	spin_lock_init(&ns->ns_lock);
+	if (client == LDLM_NAMESPACE_SERVER) {
+		rc = ldlm_flock_graph_init(ns);
+		if (rc)
+			GOTO(out_hash, rc);
+	}
 	atomic_set(&ns->ns_bref, 0);
 	init_waitqueue_head(&ns->ns_waitq);
 
 	ns->ns_connect_flags	    = 0;
 	ns->ns_orig_connect_flags   = 0;
-	ns->ns_nr_unused	    = 0;
-	ns->ns_last_pos		    = &ns->ns_unused_list;
 	ns->ns_max_unused	    = LDLM_DEFAULT_LRU_SIZE;
 	ns->ns_cancel_batch	    = LDLM_DEFAULT_LRU_SHRINK_BATCH;
+	ns->ns_lru_cost_keep	    = LDLM_DEFAULT_LRU_COST_KEEP;
 	ns->ns_recalc_pct	    = LDLM_DEFAULT_SLV_RECALC_PCT;
 	ns->ns_max_age		    = ktime_set(LDLM_DEFAULT_LRU_MAX_AGE, 0);
 	ns->ns_timeouts		    = 0;
@@ -994,6 +1085,7 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	ns->ns_contended_locks	    = NS_DEFAULT_CONTENDED_LOCKS;
 	ns->ns_contention_time	    = NS_DEFAULT_CONTENTION_SECONDS;
 	ns->ns_max_nolock_size	    = NS_DEFAULT_MAX_NOLOCK_BYTES;
+	ns->ns_stride_hits	    = NS_DEFAULT_STRIDE_HITS;
 	ns->ns_max_parallel_ast	    = LDLM_DEFAULT_PARALLEL_AST_LIMIT;
 	ns->ns_stopping		    = 0;
 	ns->ns_rpc_recalc	    = 0;
@@ -1028,6 +1120,9 @@ out_sysfs:
 	ldlm_namespace_sysfs_unregister(ns);
 	ldlm_namespace_cleanup(ns, 0);
 out_hash:
+	ldlm_flock_graph_fini(ns);
+	if (ns->ns_lru)
+		cfs_percpt_free(ns->ns_lru);
 	OBD_FREE_PTR_ARRAY_LARGE(ns->ns_rs_buckets, 1 << ns->ns_bucket_bits);
 	kfree(ns->ns_name);
 	cfs_hash_putref(ns->ns_rs_hash);
@@ -1298,6 +1393,8 @@ void ldlm_namespace_free_post(struct ldlm_namespace *ns)
 	ldlm_namespace_sysfs_unregister(ns);
 	cfs_hash_putref(ns->ns_rs_hash);
 	OBD_FREE_PTR_ARRAY_LARGE(ns->ns_rs_buckets, 1 << ns->ns_bucket_bits);
+	ldlm_flock_graph_fini(ns);
+	cfs_percpt_free(ns->ns_lru);
 	kfree(ns->ns_name);
 	/* Namespace \a ns should be not on list at this time, otherwise
 	 * this will cause issues related to using freed \a ns in poold
@@ -1413,7 +1510,7 @@ static bool ldlm_resource_extent_new(struct ldlm_resource *res)
 	int idx;
 
 	OBD_SLAB_ALLOC(res->lr_itree, ldlm_interval_tree_slab,
-		       sizeof(*res->lr_itree) * LCK_MODE_NUM);
+		       sizeof(*res->lr_itree) * LDLM_ITREE_NUM);
 	if (res->lr_itree == NULL)
 		return false;
 	/* Initialize interval trees for each lock mode. */
@@ -1422,6 +1519,12 @@ static bool ldlm_resource_extent_new(struct ldlm_resource *res)
 		res->lr_itree[idx].lit_mode = BIT(idx);
 		res->lr_itree[idx].lit_root = INTERVAL_TREE_ROOT;
 	}
+	/* and for waiting locks, which may have any mode */
+	for (; idx < LDLM_ITREE_NUM; idx++) {
+		res->lr_itree[idx].lit_size = 0;
+		res->lr_itree[idx].lit_mode = LCK_MINMODE;
+		res->lr_itree[idx].lit_root = INTERVAL_TREE_ROOT;
+	}
 	return true;
 }
 
@@ -1504,7 +1607,7 @@ static void ldlm_resource_free(struct ldlm_resource *res)
 	if (res->lr_type == LDLM_EXTENT) {
 		if (res->lr_itree != NULL)
 			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
-				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
+				      sizeof(*res->lr_itree) * LDLM_ITREE_NUM);
 	} else if (res->lr_type == LDLM_IBITS) {
 		OBD_FREE_PTR(res->lr_ibits_queues);
 	}
@@ -1679,6 +1782,8 @@ static void __ldlm_resource_add_lock(struct ldlm_resource *res,
 
 	if (res->lr_type == LDLM_IBITS)
 		ldlm_inodebits_add_lock(res, head, lock, tail);
+	else if (res->lr_type == LDLM_EXTENT && !ldlm_is_granted(lock))
+		ldlm_extent_add_waiting_lock(res, lock);
 	else if (res->lr_type == LDLM_FLOCK)
 		LASSERT(lock->l_req_mode != LCK_NL || head != &res->lr_waiting);
 
@@ -1693,6 +1798,7 @@ void ldlm_resource_add_lock(struct ldlm_resource *res, struct list_head *head,
 
 	__ldlm_resource_add_lock(res, head, lock, true);
 }
+EXPORT_SYMBOL(ldlm_resource_add_lock);
 
 /* Insert a lock into resource after specified lock. */
 void ldlm_resource_insert_lock_after(struct ldlm_lock *original,
@@ -181,6 +181,43 @@ void ll_release_page(struct inode *inode, struct page *page,
 	put_page(page);
 }
 
+/*
+ * Refresh the lazy size of a cached file from its readdir-plus attributes.
+ * They are not covered by any lock, so only the LSOM copy used by
+ * stat(AT_STATX_DONT_SYNC) is updated, the inode attributes are left to the
+ * next getattr.
+ */
+void ll_dirent_attrs_update(struct super_block *sb, const struct lu_fid *fid,
+			    const struct luda_attrs *lat)
+{
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+	__u64 valid = le64_to_cpu(lat->lat_valid);
+	struct ll_inode_info *lli;
+	struct inode *inode;
+
+	if (!(valid & OBD_MD_FLLAZYSIZE) ||
+	    !S_ISREG(le32_to_cpu(lat->lat_mode)))
+		return;
+
+	inode = ilookup5_nowait(sb, cl_fid_build_ino(fid,
+						     ll_need_32bit_api(sbi)),
+				ll_test_inode_by_fid, (void *)fid);
+	if (!inode)
+		return;
+
+	/* lli_lazysize holds the clear text size of encrypted files */
+	if (!IS_ENCRYPTED(inode) && S_ISREG(inode->i_mode)) {
+		lli = ll_i2info(inode);
+		lli->lli_lazysize = le64_to_cpu(lat->lat_size);
+		lli->lli_attr_valid |= OBD_MD_FLLAZYSIZE;
+		if (valid & OBD_MD_FLLAZYBLOCKS) {
+			lli->lli_lazyblocks = le64_to_cpu(lat->lat_blocks);
+			lli->lli_attr_valid |= OBD_MD_FLLAZYBLOCKS;
+		}
+	}
+	iput(inode);
+}
+
 #ifdef HAVE_DIR_CONTEXT
 int ll_dir_read(struct inode *inode, __u64 *ppos, struct md_op_data *op_data,
 		struct dir_context *ctx, int *partial_readdir_rc)
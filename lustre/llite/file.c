@@ -39,6 +39,7 @@
 #include <lustre_dlm.h>
 #include <linux/pagemap.h>
 #include <linux/file.h>
+#include <linux/mmu_context.h>
 #include <linux/sched.h>
 #include <linux/user_namespace.h>
 #include <linux/uidgid.h>
@@ -140,6 +141,55 @@ static void ll_prepare_close(struct inode *inode, struct md_op_data *op_data,
 	EXIT;
 }
 
+/*
+ * Pack the size and blocks of a file closed for write as exact, so that the
+ * MDT can keep them as strict SOM if this is the last writer. The data
+ * version request takes a PR lock on the OST objects, which flushes the
+ * dirty pages of all clients first.
+ */
+static void ll_close_strict_som(struct inode *inode,
+				struct md_op_data *op_data)
+{
+	struct lu_env *env;
+	__u64 data_version;
+	__u16 refcheck;
+	int rc;
+
+	ENTRY;
+	if (ll_i2info(inode)->lli_clob == NULL ||
+	    llcrypt_require_key(inode) == -ENOKEY)
+		RETURN_EXIT;
+
+	rc = ll_data_version(inode, &data_version,
+			     LL_DV_RD_FLUSH | LL_DV_SZ_UPDATE);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env))
+		GOTO(out, rc = PTR_ERR(env));
+
+	rc = ll_merge_attr(env, inode);
+	cl_env_put(env, &refcheck);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	op_data->op_attr.ia_size = i_size_read(inode);
+	op_data->op_attr_blocks = inode->i_blocks;
+	op_data->op_attr.ia_valid |= ATTR_SIZE;
+	CFS_FAIL_TIMEOUT(OBD_FAIL_LLITE_STRICT_SOM_PAUSE, cfs_fail_val);
+	/* keep the lazy update on servers not knowing the strict close */
+	op_data->op_xvalid |= OP_XVALID_BLOCKS | OP_XVALID_LAZYSIZE |
+			      OP_XVALID_LAZYBLOCKS;
+	op_data->op_bias |= MDS_CLOSE_STRICT_SOM;
+	EXIT;
+out:
+	if (rc != 0)
+		CDEBUG(D_INODE, "%s: no strict SOM on close of "DFID": rc = %d\n",
+		       ll_i2sbi(inode)->ll_fsname,
+		       PFID(ll_inode2fid(inode)), rc);
+}
+
 /*
  * Perform a close, possibly with a bias.
  * The meaning of "data" depends on the value of "bias".
@@ -248,6 +298,10 @@ static int ll_close_inode_openhandle(struct inode *inode,
 
 	default:
 		LASSERT(data == NULL);
+		if (och->och_flags & MDS_FMODE_WRITE &&
+		    S_ISREG(inode->i_mode) &&
+		    test_bit(LL_SBI_STRICT_SOM, ll_i2sbi(inode)->ll_flags))
+			ll_close_strict_som(inode, op_data);
 		break;
 	}
 
@@ -448,6 +502,8 @@ int ll_file_release(struct inode *inode, struct file *file)
 		if (lli->lli_clob != NULL)
 			lov_read_and_clear_async_rc(lli->lli_clob);
 		lli->lli_async_rc = 0;
+		/* prefetch it again if it is scanned again */
+		clear_bit(LLIF_XFILE_READAHEAD, &lli->lli_flags);
 	}
 
 	lli->lli_close_fd_time = ktime_get();
@@ -801,7 +857,7 @@ static int ll_local_open(struct file *file, struct lookup_intent *it,
 	}
 
 	file->private_data = lfd;
-	ll_readahead_init(inode, &lfd->fd_ras);
+	ll_readahead_init(inode, &lfd->fd_ras_streams);
 	lfd->fd_omode = it->it_open_flags & (FMODE_READ | FMODE_WRITE |
 					     FMODE_EXEC);
 
@@ -1773,6 +1829,11 @@ ll_hybrid_bio_dio_switch_check(struct file *file, struct kiocb *iocb,
 	 * not if hybrid IO is disabled or the IO was never a candidate to
 	 * switch
 	 */
+	if (ll_file_is_contended(inode)) {
+		op = LPROC_LL_HYBRID_CONTENDED_SWITCH;
+		GOTO(out, dio_switch = true);
+	}
+
 	if (iot == CIT_WRITE &&
 	    count >= sbi->ll_hybrid_io_write_threshold_bytes) {
 		op = LPROC_LL_HYBRID_WRITESIZE_SWITCH;
@@ -1793,6 +1854,386 @@ out:
 #endif
 }
 
+/*
+ * Parallel buffered read.
+ *
+ * A large read of a file striped over several OSTs is split at stripe
+ * boundaries, one component at a time, and the stripes are dealt round-robin
+ * to worker threads spread over the CPTs, the caller being worker 0. Each
+ * worker runs a plain cl_io per stripe in the address space of the caller,
+ * so that one process is not limited by the page cache copy bandwidth of a
+ * single core. Writes are not split: a failed stripe would leave the later
+ * ones written beyond the short count returned to the application.
+ */
+static struct workqueue_struct **ll_pio_wqs;
+static int ll_pio_nwqs;
+
+struct ll_pio_ctl {
+	struct file		*lpc_file;
+	struct kiocb		*lpc_iocb;
+	/* iterator of the caller, positioned at lpc_pos */
+	struct iov_iter		*lpc_iter;
+	struct mm_struct	*lpc_mm;
+	const struct cred	*lpc_cred;
+	loff_t			 lpc_pos;
+	loff_t			 lpc_end;
+	/* start of the stripe lpc_pos is in */
+	loff_t			 lpc_base;
+	unsigned int		 lpc_stripe_size;
+	unsigned int		 lpc_nr;
+	/* a stripe came back short, the later ones are not needed */
+	bool			 lpc_short;
+	atomic_t		 lpc_pending;
+	struct completion	 lpc_done;
+};
+
+struct ll_pio_worker {
+	struct work_struct	 lpw_work;
+	struct ll_pio_ctl	*lpw_ctl;
+	unsigned int		 lpw_index;
+	/* all stripes of this worker before this offset are done */
+	loff_t			 lpw_done;
+};
+
+/* reserve up to \a want worker threads from the budget of the mount */
+static unsigned int ll_pio_threads_get(struct ll_sb_info *sbi,
+				       unsigned int want)
+{
+	unsigned int max = READ_ONCE(sbi->ll_pio_max_threads);
+	unsigned int got;
+	int cur;
+	int old;
+
+	cur = atomic_read(&sbi->ll_pio_threads);
+	while (1) {
+		if (cur >= max)
+			return 0;
+		got = min(want, max - cur);
+		old = atomic_cmpxchg(&sbi->ll_pio_threads, cur, cur + got);
+		if (old == cur)
+			return got;
+		cur = old;
+	}
+}
+
+/* read \a count bytes at \a pos into \a from, which is positioned at \a pos */
+static ssize_t ll_pio_range_io(const struct lu_env *env, struct file *file,
+			       struct kiocb *iocb, const struct iov_iter *from,
+			       loff_t pos, size_t count)
+{
+	struct inode *inode = file_inode(file);
+	struct vvp_io *vio = vvp_env_io(env);
+	struct cl_io *io = vvp_env_thread_io(env);
+	struct iov_iter iter = *from;
+	struct vvp_io_args args = { 0 };
+	struct kiocb kiocb;
+	ssize_t rc;
+
+	iov_iter_truncate(&iter, count);
+
+	init_sync_kiocb(&kiocb, file);
+	kiocb.ki_flags = iocb->ki_flags;
+	kiocb.ki_pos = pos;
+	args.u.normal.via_iter = &iter;
+	args.u.normal.via_iocb = &kiocb;
+
+	ll_io_init(io, file, CIT_READ, &args);
+	if (cl_io_rw_init(env, io, CIT_READ, pos, count) == 0) {
+		vio->vui_fd = file->private_data;
+		vio->vui_iter = &iter;
+		vio->vui_iocb = &kiocb;
+
+		ll_cl_add(inode, env, io, LCC_RW);
+		rc = cl_io_loop(env, io);
+		ll_cl_remove(inode, env);
+	} else {
+		rc = io->ci_result;
+	}
+	if (io->ci_bytes > 0)
+		rc = io->ci_bytes;
+	cl_io_fini(env, io);
+
+	return rc;
+}
+
+/* do every lpc_nr-th stripe, starting with stripe lpw_index */
+static void ll_pio_stripes(const struct lu_env *env, struct ll_pio_worker *lpw)
+{
+	struct ll_pio_ctl *ctl = lpw->lpw_ctl;
+	loff_t step = (loff_t)ctl->lpc_nr * ctl->lpc_stripe_size;
+	loff_t start;
+
+	lpw->lpw_done = ctl->lpc_end;
+	for (start = ctl->lpc_base +
+		     (loff_t)lpw->lpw_index * ctl->lpc_stripe_size;
+	     start < ctl->lpc_end; start += step) {
+		loff_t pos = max(start, ctl->lpc_pos);
+		size_t count = min(start + ctl->lpc_stripe_size,
+				   ctl->lpc_end) - pos;
+		struct iov_iter iter = *ctl->lpc_iter;
+		ssize_t rc;
+
+		/* nothing past a short stripe is reported, EOF or error */
+		if (READ_ONCE(ctl->lpc_short)) {
+			lpw->lpw_done = pos;
+			break;
+		}
+
+		iov_iter_advance(&iter, pos - ctl->lpc_pos);
+		rc = ll_pio_range_io(env, ctl->lpc_file, ctl->lpc_iocb, &iter,
+				     pos, count);
+		if (rc < 0 || (size_t)rc < count) {
+			lpw->lpw_done = pos + max_t(ssize_t, rc, 0);
+			WRITE_ONCE(ctl->lpc_short, true);
+			break;
+		}
+	}
+}
+
+static void ll_pio_work(struct work_struct *work)
+{
+	struct ll_pio_worker *lpw = container_of(work, struct ll_pio_worker,
+						 lpw_work);
+	struct ll_pio_ctl *ctl = lpw->lpw_ctl;
+	const struct cred *old_cred;
+	struct lu_env *env;
+	__u16 refcheck;
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env)) {
+		lpw->lpw_done = ctl->lpc_pos;
+	} else {
+		kthread_use_mm(ctl->lpc_mm);
+		old_cred = override_creds(ctl->lpc_cred);
+		ll_pio_stripes(env, lpw);
+		revert_creds(old_cred);
+		kthread_unuse_mm(ctl->lpc_mm);
+		cl_env_put(env, &refcheck);
+	}
+
+	if (atomic_dec_and_test(&ctl->lpc_pending))
+		complete(&ctl->lpc_done);
+}
+
+static bool ll_pio_allowed(struct ll_sb_info *sbi, struct vvp_io_args *args,
+			   enum cl_io_type iot, int flags)
+{
+	if (!READ_ONCE(sbi->ll_pio_max_threads) || !ll_pio_wqs)
+		return false;
+
+	/* DIO is already parallel */
+	if (iot != CIT_READ || iocb_ki_flags_check(flags, DIRECT))
+		return false;
+
+	/* workers borrow the address space of the caller */
+	if (!current->mm || iov_iter_is_pipe(args->u.normal.via_iter))
+		return false;
+
+	return is_sync_kiocb(args->u.normal.via_iocb);
+}
+
+/**
+ * Fan the part of a buffered read within one layout component out to worker
+ * threads by stripe. The caller is worker 0 and runs its stripes in \a env,
+ * which must not be the env of an I/O in progress.
+ *
+ * \param[in,out] count	bytes to read, cut down to the end of the component
+ *			if it is known
+ *
+ * \retval number of bytes read from \a pos on, 0 if the component is not
+ *	   worth splitting or no worker thread is available
+ */
+static ssize_t ll_file_io_parallel_comp(const struct lu_env *env,
+					struct vvp_io_args *args,
+					struct file *file, loff_t pos,
+					size_t *count)
+{
+	struct inode *inode = file_inode(file);
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct cl_layout cl = { .cl_stripe_pos = pos };
+	struct ll_pio_worker *workers;
+	struct ll_pio_ctl ctl;
+	size_t bytes = *count;
+	ssize_t done = 0;
+	unsigned int nr;
+	unsigned int i;
+	loff_t end;
+	u64 tmp;
+	int cpt;
+	int rc;
+
+	ENTRY;
+
+	rc = cl_object_layout_get(env, lli->lli_clob, &cl);
+	if (rc < 0 || cl.cl_stripe_end <= pos)
+		RETURN(0);
+
+	if (cl.cl_stripe_end - pos < bytes)
+		*count = bytes = cl.cl_stripe_end - pos;
+	if (cl.cl_stripe_count < 2 || cl.cl_stripe_size == 0 ||
+	    bytes < 2 * (size_t)cl.cl_stripe_size)
+		RETURN(0);
+
+	/* at most one worker per stripe, the caller is one of them */
+	nr = min_t(size_t, cl.cl_stripe_count, bytes / cl.cl_stripe_size);
+	nr = ll_pio_threads_get(sbi, nr - 1) + 1;
+	if (nr == 1) {
+		ll_stats_ops_tally(sbi, LPROC_LL_PIO_FALLBACK, 1);
+		RETURN(0);
+	}
+
+	OBD_ALLOC_PTR_ARRAY(workers, nr);
+	if (!workers)
+		GOTO(out_threads, done = 0);
+
+	tmp = pos;
+	ctl.lpc_file = file;
+	ctl.lpc_iocb = args->u.normal.via_iocb;
+	ctl.lpc_iter = args->u.normal.via_iter;
+	ctl.lpc_mm = current->mm;
+	ctl.lpc_cred = get_current_cred();
+	ctl.lpc_pos = pos;
+	ctl.lpc_end = pos + bytes;
+	ctl.lpc_base = pos - do_div(tmp, cl.cl_stripe_size);
+	ctl.lpc_stripe_size = cl.cl_stripe_size;
+	ctl.lpc_nr = nr;
+	ctl.lpc_short = false;
+	atomic_set(&ctl.lpc_pending, nr - 1);
+	init_completion(&ctl.lpc_done);
+
+	cpt = cfs_cpt_current(cfs_cpt_tab, 0);
+	for (i = 0; i < nr; i++) {
+		workers[i].lpw_ctl = &ctl;
+		workers[i].lpw_index = i;
+		if (i == 0)
+			continue;
+		INIT_WORK(&workers[i].lpw_work, ll_pio_work);
+		queue_work(ll_pio_wqs[(cpt + i) % ll_pio_nwqs],
+			   &workers[i].lpw_work);
+	}
+
+	ll_pio_stripes(env, &workers[0]);
+	wait_for_completion(&ctl.lpc_done);
+	put_cred(ctl.lpc_cred);
+
+	/* only the part done by every worker is reported */
+	end = ctl.lpc_end;
+	for (i = 0; i < nr; i++)
+		end = min(end, workers[i].lpw_done);
+	done = end - ctl.lpc_pos;
+
+	CDEBUG(D_VFSTRACE, "%s: parallel read pos: %llu, bytes: %zu, workers: %u, done: %zd\n",
+	       file_dentry(file)->d_name.name, pos, bytes, nr, done);
+
+	OBD_FREE_PTR_ARRAY(workers, nr);
+out_threads:
+	atomic_sub(nr - 1, &sbi->ll_pio_threads);
+
+	RETURN(done);
+}
+
+/**
+ * Fan a buffered read out to worker threads by stripe, one layout component
+ * after the other, as the components of a PFL file are striped differently.
+ * Components not worth splitting, such as DoM or single stripe ones, are
+ * read serially in between.
+ *
+ * The I/O runs in an env of its own, the cl_io of the caller's env is left
+ * for the serial path.
+ *
+ * \retval number of bytes read from *ppos on, the iterator and *ppos are
+ *	   advanced past them. The caller does the rest, if any, serially,
+ *	   which also reports any error hit by the workers.
+ */
+static ssize_t ll_file_io_parallel(struct vvp_io_args *args, struct file *file,
+				   loff_t *ppos, size_t bytes)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(file_inode(file));
+	struct lu_env *env;
+	ssize_t done = 0;
+	size_t count;
+	__u16 refcheck;
+	ssize_t rc;
+
+	ENTRY;
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env))
+		RETURN(0);
+
+	while (bytes > 0) {
+		count = bytes;
+		rc = ll_file_io_parallel_comp(env, args, file, *ppos, &count);
+		if (rc > 0) {
+			ll_stats_ops_tally(sbi, LPROC_LL_PIO_BYTES, rc);
+		} else if (count < bytes) {
+			/* the component ends before the read does */
+			rc = ll_pio_range_io(env, file, args->u.normal.via_iocb,
+					     args->u.normal.via_iter, *ppos,
+					     count);
+			if (rc <= 0)
+				break;
+		} else {
+			break;
+		}
+
+		iov_iter_advance(args->u.normal.via_iter, rc);
+		*ppos += rc;
+		bytes -= rc;
+		done += rc;
+		/* short read, let the serial path find out why */
+		if (rc < count)
+			break;
+	}
+	cl_env_put(env, &refcheck);
+
+	RETURN(done);
+}
+
+int ll_pio_init(void)
+{
+	int i;
+
+	ll_pio_nwqs = cfs_cpt_number(cfs_cpt_tab);
+	OBD_ALLOC_PTR_ARRAY(ll_pio_wqs, ll_pio_nwqs);
+	if (!ll_pio_wqs)
+		return -ENOMEM;
+
+	for (i = 0; i < ll_pio_nwqs; i++) {
+		struct workqueue_struct *wq;
+
+		wq = cfs_cpt_bind_workqueue("ll-pio-wq", cfs_cpt_tab, 0, i,
+					    cfs_cpt_weight(cfs_cpt_tab, i));
+		if (IS_ERR(wq)) {
+			int rc = PTR_ERR(wq);
+
+			CERROR("failed to create ll-pio-wq workqueue for CPT %d: rc = %d\n",
+			       i, rc);
+			ll_pio_fini();
+			return rc;
+		}
+		ll_pio_wqs[i] = wq;
+	}
+
+	return 0;
+}
+
+void ll_pio_fini(void)
+{
+	int i;
+
+	if (!ll_pio_wqs)
+		return;
+
+	for (i = 0; i < ll_pio_nwqs; i++)
+		if (ll_pio_wqs[i])
+			destroy_workqueue(ll_pio_wqs[i]);
+
+	OBD_FREE_PTR_ARRAY(ll_pio_wqs, ll_pio_nwqs);
+	ll_pio_wqs = NULL;
+}
+
 static ssize_t
 ll_file_io_generic(const struct lu_env *env, struct vvp_io_args *args,
 		   struct file *file, enum cl_io_type iot,
@@ -1853,6 +2294,15 @@ ll_file_io_generic(const struct lu_env *env, struct vvp_io_args *args,
 			GOTO(out, rc = -ENOMEM);
 	}
 
+	if (ll_pio_allowed(sbi, args, iot, flags)) {
+		result = ll_file_io_parallel(args, file, ppos,
+					     min(bytes, max_io_bytes));
+		bytes -= result;
+		/* the cl_io of this env was not used */
+		if (bytes == 0)
+			GOTO(out_tally, rc = 0);
+	}
+
 restart:
 	/*
 	 * IO block size need be aware of cached page limit, otherwise
@@ -1957,12 +2407,19 @@ restart:
 	}
 out:
 	cl_io_fini(env, io);
-
 	CDEBUG(D_VFSTRACE,
 	       "%s: %d io complete with rc: %d, result: %zd, restart: %d\n",
 	       file->f_path.dentry->d_name.name,
 	       iot, rc, result, io->ci_need_restart);
 
+	/* the OST refused a lock on a contended extent, the caller redoes the
+	 * IO as direct IO with server-side locking
+	 */
+	if (rc == -EUSERS) {
+		ll_file_set_contended(inode);
+		args->via_contended = 1;
+	}
+
 	if ((!rc || rc == -ENODATA || rc == -ENOLCK || rc == -EIOCBQUEUED) &&
 	    bytes > 0 && io->ci_need_restart && retries-- > 0) {
 		CDEBUG(D_VFSTRACE,
@@ -2021,6 +2478,7 @@ out:
 		}
 	}
 
+out_tally:
 	if (iot == CIT_READ) {
 		if (result > 0)
 			ll_stats_ops_tally(ll_i2sbi(inode),
@@ -2268,6 +2726,42 @@ static bool is_unaligned_directio(struct kiocb *iocb, struct iov_iter *iter,
 #endif /* HAVE_DIO_ITER */
 }
 
+#ifdef IOCB_DIRECT
+/*
+ * An OST refused an extent lock of this IO as contended, after \a done
+ * bytes were moved when it spans several stripes. Redo what is left of it
+ * as direct IO with server-side locking.
+ */
+static ssize_t ll_file_io_contended(const struct lu_env *env,
+				    struct vvp_io_args *args,
+				    struct file *file, enum cl_io_type iot,
+				    ssize_t done)
+{
+	struct kiocb *iocb = args->u.normal.via_iocb;
+	struct iov_iter *iter = args->u.normal.via_iter;
+	ssize_t rc;
+
+	if (done != -EUSERS && (done <= 0 || !args->via_contended))
+		return done;
+
+	if (args->via_hybrid_switched || iov_iter_count(iter) == 0 ||
+	    !ll_hybrid_bio_dio_switch_check(file, iocb, iot,
+					    iov_iter_count(iter)))
+		return done;
+
+	iocb->ki_flags |= IOCB_DIRECT;
+	CDEBUG(D_VFSTRACE, "contended after %zd bytes, switching to DIO\n",
+	       max_t(ssize_t, done, 0));
+	args->via_hybrid_switched = 1;
+	rc = ll_file_io_generic(env, args, file, iot, &iocb->ki_pos,
+				iov_iter_count(iter));
+	if (done <= 0)
+		return rc;
+
+	return rc > 0 ? done + rc : done;
+}
+#endif
+
 /* Read from a file (through the page cache) */
 static ssize_t do_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 {
@@ -2339,8 +2833,12 @@ static ssize_t do_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	if (result < 0 || iov_iter_count(to) == 0)
 		GOTO(out, result);
 
+	args->via_contended = 0;
 	rc2 = ll_file_io_generic(env, args, file, CIT_READ,
 				 &iocb->ki_pos, iov_iter_count(to));
+#ifdef IOCB_DIRECT
+	rc2 = ll_file_io_contended(env, args, file, CIT_READ, rc2);
+#endif
 	if (rc2 > 0)
 		result += rc2;
 	else if (result == 0)
@@ -2517,9 +3015,14 @@ static ssize_t do_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	args->u.normal.via_iter = from;
 	args->u.normal.via_iocb = iocb;
 	args->via_hybrid_switched = hybrid_switched;
+	args->via_contended = 0;
 
 	rc_normal = ll_file_io_generic(env, args, file, CIT_WRITE,
 				       &iocb->ki_pos, iov_iter_count(from));
+#ifdef IOCB_DIRECT
+	rc_normal = ll_file_io_contended(env, args, file, CIT_WRITE,
+					 rc_normal);
+#endif
 
 	/* On success, combine bytes written. */
 	if (rc_tiny >= 0 && rc_normal > 0)
@@ -153,6 +153,10 @@ enum ll_sa_pattern {
 	LSA_PATTERN_MAX,
 };
 
+/* size of the per-directory filter of missed names, a power of two */
+#define LL_MISS_FILTER_SHIFT	9
+#define LL_MISS_FILTER_BITS	(1 << LL_MISS_FILTER_SHIFT)
+
 struct ll_inode_info {
 	__u32				lli_inode_magic;
 	rwlock_t			lli_lock;
@@ -254,6 +258,12 @@ struct ll_inode_info {
 			struct lmv_stripe_object	*lli_lsm_obj;
 			/* directory default LMV */
 			struct lmv_stripe_object	*lli_def_lsm_obj;
+			/* bloom filter of names recently missed by lookup,
+			 * see ll_dir_miss_repeated()
+			 */
+			unsigned long			lli_miss_filter[
+				BITS_TO_LONGS(LL_MISS_FILTER_BITS)];
+			unsigned int			lli_miss_count;
 		};
 
 		/* for non-directory */
@@ -278,6 +288,9 @@ struct ll_inode_info {
 			__u32				lli_heat_flags;
 			struct obd_heat_instance	lli_heat_instances[OBD_HEAT_COUNT];
 
+			/* last time an OST refused a lock as contended */
+			time64_t		lli_contention_time;
+
 			/*
 			 * Whenever a process try to read/write the file, the
 			 * jobid, uid and gid of the process will be saved here,
@@ -354,7 +367,7 @@ struct ll_inode_info {
 
 	struct rw_semaphore		lli_xattrs_list_rwsem;
 	struct mutex			lli_xattrs_enq_lock;
-	struct list_head		lli_xattrs; /* ll_xattr_entry->xe_list*/
+	struct ll_xattr_blob		*lli_xattrs; /* all cached xattrs */
 	struct list_head		lli_lccs; /* list of ll_cl_context */
 	seqlock_t			lli_page_inv_lock;
 
@@ -546,6 +559,8 @@ enum ll_inode_flags {
 	/* 6 is not used for now */
 	/* Xattr cache is filled */
 	LLIF_XATTR_CACHE_FILLED	= 7,
+	/* Data is prefetched by cross-file read-ahead */
+	LLIF_XFILE_READAHEAD	= 8,
 
 /* New flags added to this enum potentially need to be handled in
  * ll_inode2ext_flags/ll_set_inode_flags
@@ -744,6 +759,16 @@ static inline void ll_inode_unlock(struct inode *inode)
 /* Min range pages */
 #define RA_MIN_MMAP_RANGE_PAGES			16UL
 
+/* read-ahead streams tracked per open file */
+#define LL_RA_STREAMS_MAX			4
+#define SBI_DEFAULT_RA_STREAMS			LL_RA_STREAMS_MAX
+
+/* files of a statahead scan prefetched ahead of the reader */
+#define LL_RA_XFILE_MAX				32
+#define SBI_DEFAULT_RA_XFILE_COUNT		4
+/* default pages in flight for cross-file read-ahead */
+#define SBI_DEFAULT_RA_XFILE_MAX		MiB_TO_PAGES(32UL)
+
 enum ra_stat {
 	RA_STAT_HIT = 0,
 	RA_STAT_MISS,
@@ -762,9 +787,18 @@ enum ra_stat {
 	RA_STAT_FAILED_FAST_READ,
 	RA_STAT_MMAP_RANGE_READ,
 	RA_STAT_READAHEAD_PAGES,
+	RA_STAT_STREAM_NEW,
+	RA_STAT_STREAM_SWITCH,
+	RA_STAT_XFILE,
+	RA_STAT_XFILE_HIT,
+	RA_STAT_XFILE_MISS,
 	_NR_RA_STAT,
 };
 
+/* per-stream counters of ll_sb_info::ll_ra_stream_stats */
+#define RA_STREAM_STAT_HIT(stream)	((stream) * 2)
+#define RA_STREAM_STAT_MISS(stream)	((stream) * 2 + 1)
+
 struct ll_ra_info {
 	atomic_t	ra_cur_pages;
 	unsigned long	ra_max_pages;
@@ -781,6 +815,13 @@ struct ll_ra_info {
 	atomic_t ra_async_inflight;
 	/* Threshold to control when to trigger async readahead */
 	unsigned long ra_async_pages_per_file_threshold;
+	/* read-ahead streams tracked by files opened from now on */
+	unsigned int ra_max_streams;
+	/* files prefetched ahead of a reader scanning a directory */
+	unsigned int ra_xfile_count;
+	/* max and current pages in flight for cross-file read-ahead */
+	unsigned long ra_xfile_max_pages;
+	atomic_t ra_xfile_pages;
 };
 
 /* ra_io_arg will be filled in the beginning of ll_readahead with
@@ -883,6 +924,9 @@ enum ll_sbi_flags {
 	LL_SBI_ENCRYPT_NAME,		/* name encryption */
 	LL_SBI_UNALIGNED_DIO,		/* unaligned DIO */
 	LL_SBI_HYBRID_IO,		/* allow BIO as DIO */
+	LL_SBI_READDIR_PLUS,		/* ask attributes with dir pages */
+	LL_SBI_DIR_MISS_LOCK,		/* lock dir on repeated lookup miss */
+	LL_SBI_STRICT_SOM,		/* pack flushed size on write close */
 	LL_SBI_NUM_FLAGS
 };
 
@@ -942,6 +986,7 @@ struct ll_sb_info {
 	struct cl_client_cache	 *ll_cache;
 
 	struct lprocfs_stats     *ll_ra_stats;
+	struct lprocfs_stats     *ll_ra_stream_stats;
 
 	struct ll_ra_info         ll_ra_info;
 	unsigned int              ll_namelen;
@@ -1017,9 +1062,23 @@ struct ll_sb_info {
 	/* Time in ms after last file close we no longer count prior opens*/
 	u32			  ll_oc_max_ms;
 
+	/* xattr caches of the inodes, least recently filled first */
+	spinlock_t		  ll_xattr_lru_lock;
+	struct list_head	  ll_xattr_lru;
+	unsigned long		  ll_xattr_cache_bytes;
+	unsigned long		  ll_xattr_cache_max_bytes;
+
 	/* I/O size thresholds for switching from buffered I/O to direct I/O */
 	u32			  ll_hybrid_io_write_threshold_bytes;
 	u32			  ll_hybrid_io_read_threshold_bytes;
+	/* seconds to keep doing direct I/O on a file after lock contention */
+	u32			  ll_contention_seconds;
+
+	/* buffered reads fanned out over stripes, max worker threads in use by
+	 * this mount (0 disables it) and the number currently in use
+	 */
+	unsigned int		  ll_pio_max_threads;
+	atomic_t		  ll_pio_threads;
 
 	/* filesystem fsname */
 	char			  ll_fsname[LUSTRE_MAXFSNAME + 1];
@@ -1048,6 +1107,8 @@ struct ll_sb_info {
 	struct list_head	 ll_all_quota_list;
 };
 
+#define SBI_DEFAULT_XATTR_CACHE_MAX_MB	(64)
+
 #define SBI_DEFAULT_HEAT_DECAY_WEIGHT	((80 * 256 + 50) / 100)
 #define SBI_DEFAULT_HEAT_PERIOD_SECOND	(60)
 
@@ -1055,10 +1116,16 @@ struct ll_sb_info {
 #define SBI_DEFAULT_OPENCACHE_THRESHOLD_MS	(100) /* 0.1 second */
 #define SBI_DEFAULT_OPENCACHE_THRESHOLD_MAX_MS	(60000) /* 1 minute */
 
-/* per file-descriptor read-ahead data. */
+/* read-ahead data of one stream of accesses to a file descriptor. */
 struct ll_readahead_state {
-	spinlock_t	ras_lock;
-	/* End byte that read(2) try to read.  */
+	/* ll_readahead_streams::rss_lock of the file descriptor */
+	spinlock_t	*ras_lock;
+	/* slot in ll_readahead_streams::rss_streams */
+	unsigned int	ras_stream;
+	/* ll_readahead_streams::rss_clock at the last access */
+	unsigned long	ras_access;
+	/* Start and end byte that read(2) try to read.  */
+	loff_t		ras_last_read_start_bytes;
 	loff_t		ras_last_read_end_bytes;
 	/*
 	 * number of bytes read after last read-ahead window reset. As window
@@ -1144,12 +1211,33 @@ struct ll_readahead_state {
 	bool		ras_whole_file_read;
 };
 
+/*
+ * Per file-descriptor read-ahead data. Interleaved sequential or strided
+ * readers of one file descriptor each get their own stream, so that they
+ * do not keep resetting a shared read-ahead window.
+ */
+struct ll_readahead_streams {
+	spinlock_t		  rss_lock;
+	/* streams in use, up to rss_max */
+	unsigned int		  rss_count;
+	unsigned int		  rss_max;
+	/* access counter, to find the least recently used stream */
+	unsigned long		  rss_clock;
+	/* stream of the last access */
+	struct ll_readahead_state *rss_last;
+	struct ll_readahead_state rss_streams[LL_RA_STREAMS_MAX];
+};
+
 struct ll_readahead_work {
 	/** File to readahead */
 	struct file			*lrw_file;
 	pgoff_t				 lrw_start_idx;
 	pgoff_t				 lrw_end_idx;
 	pid_t				 lrw_user_pid;
+	/** Stream the read-ahead is done for */
+	struct ll_readahead_state	*lrw_ras;
+	/** Inode of cross-file read-ahead, lrw_file is NULL then */
+	struct inode			*lrw_inode;
 
 	/* async worker to handler read */
 	struct work_struct		 lrw_readahead_work;
@@ -1159,7 +1247,7 @@ struct ll_readahead_work {
 extern struct kmem_cache *ll_file_data_slab;
 struct lustre_handle;
 struct ll_file_data {
-	struct ll_readahead_state fd_ras;
+	struct ll_readahead_streams fd_ras_streams;
 	struct ll_grouplock fd_grouplock;
 	__u64 lfd_pos;
 	__u32 fd_flags;
@@ -1314,9 +1402,16 @@ enum {
 	LPROC_LL_PCC_AUTOAT,
 	LPROC_LL_PCC_HIT_BYTES,
 	LPROC_LL_PCC_ATTACH_BYTES,
+	LPROC_LL_PCC_WRITEBACK,
+	LPROC_LL_PCC_EVICT,
 	LPROC_LL_HYBRID_NOSWITCH,
 	LPROC_LL_HYBRID_WRITESIZE_SWITCH,
 	LPROC_LL_HYBRID_READSIZE_SWITCH,
+	LPROC_LL_HYBRID_CONTENDED_SWITCH,
+	LPROC_LL_DIO_BVEC_BYTES,
+	LPROC_LL_PIO_BYTES,
+	LPROC_LL_PIO_FALLBACK,
+	LPROC_LL_DIR_MISS_LOCK,
 	LPROC_LL_FILE_OPCODES
 };
 
@@ -1340,6 +1435,8 @@ int ll_get_mdt_idx_by_fid(struct ll_sb_info *sbi, const struct lu_fid *fid);
 struct page *ll_get_dir_page(struct inode *dir, struct md_op_data *op_data,
 			      __u64 offset, int *partial_readdir_rc);
 void ll_release_page(struct inode *inode, struct page *page, bool remove);
+void ll_dirent_attrs_update(struct super_block *sb, const struct lu_fid *fid,
+			    const struct luda_attrs *lat);
 int quotactl_ioctl(struct super_block *sb, struct if_quotactl *qctl);
 void ll_quota_iter_check_and_cleanup(struct ll_sb_info *sbi, bool check);
 
@@ -1368,7 +1465,8 @@ int ll_read_folio(struct file *file, struct folio *folio);
 #endif
 int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 			   struct cl_page *page, struct file *file);
-void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras);
+void ll_readahead_init(struct inode *inode, struct ll_readahead_streams *rss);
+void ll_readahead_inode(struct inode *inode);
 int vvp_io_write_commit(const struct lu_env *env, struct cl_io *io);
 
 enum lcc_type;
@@ -1393,6 +1491,8 @@ int ll_file_release(struct inode *inode, struct file *file);
 int ll_release_openhandle(struct dentry *d, struct lookup_intent *l);
 int ll_md_real_close(struct inode *inode, fmode_t fmode);
 void ll_track_file_opens(struct inode *inode);
+int ll_pio_init(void);
+void ll_pio_fini(void);
 extern void ll_rw_stats_tally(struct ll_sb_info *sbi, pid_t pid,
 			      struct ll_file_data *file, loff_t pos,
 			      size_t count, int rw);
@@ -1608,6 +1708,8 @@ struct vvp_io_args {
 	} u;
 	/* did we switch this IO from BIO to DIO using hybrid IO? */
 	int	via_hybrid_switched:1;
+	/* did an OST refuse a lock of this IO as contended? */
+	int	via_contended:1;
 };
 
 static inline unsigned int iocb_ki_flags_get(const struct file *file,
@@ -1891,6 +1993,7 @@ int ll_start_statahead(struct inode *dir, struct dentry *dentry, bool agl);
 void ll_authorize_statahead(struct inode *dir, void *key);
 void ll_deauthorize_statahead(struct inode *dir, void *key);
 void ll_statahead_enter(struct inode *dir, struct dentry *dentry);
+void ll_statahead_read_enter(struct inode *dir, struct inode *inode);
 
 /* glimpse.c */
 blkcnt_t dirty_cnt(struct inode *inode);
@@ -2053,6 +2156,27 @@ static inline int d_lustre_invalid(const struct dentry *dentry)
 #define SBI_DEFAULT_HYBRID_IO_READ_THRESHOLD	(8 * 1024 * 1024) /* 8 MiB */
 /* 2 MiB is where writes are reliably better as DIO on most configs */
 #define SBI_DEFAULT_HYBRID_IO_WRITE_THRESHOLD	(2 * 1024 * 1024) /* 2 MiB */
+/* same as the OST side ldlm namespace contention_seconds default */
+#define SBI_DEFAULT_CONTENTION_SECONDS		NS_DEFAULT_CONTENTION_SECONDS
+
+/*
+ * Files whose extent locks were refused by an OST as contended are switched
+ * to direct I/O with server-side locking for ll_contention_seconds, to stop
+ * clients from ping-ponging locks on a shared file.
+ */
+static inline void ll_file_set_contended(struct inode *inode)
+{
+	WRITE_ONCE(ll_i2info(inode)->lli_contention_time,
+		   ktime_get_seconds());
+}
+
+static inline bool ll_file_is_contended(struct inode *inode)
+{
+	u32 seconds = ll_i2sbi(inode)->ll_contention_seconds;
+
+	return seconds != 0 && ktime_get_seconds() <
+	       READ_ONCE(ll_i2info(inode)->lli_contention_time) + seconds;
+}
 
 /*
  * Mark dentry INVALID, if dentry refcount is zero (this is normally case for
@@ -2097,8 +2221,6 @@ int ll_layout_restore(struct inode *inode, loff_t start, __u64 length);
 int ll_layout_write_intent(struct inode *inode, enum layout_intent_opc opc,
 			   struct lu_extent *ext);
 
-int ll_xattr_init(void);
-void ll_xattr_fini(void);
 
 int ll_page_sync_io(const struct lu_env *env, struct cl_io *io,
 		    struct cl_page *page, enum cl_req_type crt);
@@ -173,6 +173,11 @@ static struct ll_sb_info *ll_init_sbi(struct lustre_sb_info *lsi)
 				sbi->ll_ra_info.ra_max_pages_per_file;
 	sbi->ll_ra_info.ra_range_pages = SBI_DEFAULT_RA_RANGE_PAGES;
 	sbi->ll_ra_info.ra_max_read_ahead_whole_pages = -1;
+	sbi->ll_ra_info.ra_max_streams = SBI_DEFAULT_RA_STREAMS;
+	sbi->ll_ra_info.ra_xfile_count = SBI_DEFAULT_RA_XFILE_COUNT;
+	sbi->ll_ra_info.ra_xfile_max_pages =
+		min(sbi->ll_ra_info.ra_max_pages / 4, SBI_DEFAULT_RA_XFILE_MAX);
+	atomic_set(&sbi->ll_ra_info.ra_xfile_pages, 0);
 	atomic_set(&sbi->ll_ra_info.ra_async_inflight, 0);
 
 	set_bit(LL_SBI_VERBOSE, sbi->ll_flags);
@@ -211,6 +216,7 @@ static struct ll_sb_info *ll_init_sbi(struct lustre_sb_info *lsi)
 	set_bit(LL_SBI_TINY_WRITE, sbi->ll_flags);
 	set_bit(LL_SBI_PARALLEL_DIO, sbi->ll_flags);
 	set_bit(LL_SBI_UNALIGNED_DIO, sbi->ll_flags);
+	set_bit(LL_SBI_DIR_MISS_LOCK, sbi->ll_flags);
 	set_bit(LL_SBI_STATFS_PROJECT, sbi->ll_flags);
 	ll_sbi_set_encrypt(sbi, true);
 	ll_sbi_set_name_encrypt(sbi, true);
@@ -221,6 +227,11 @@ static struct ll_sb_info *ll_init_sbi(struct lustre_sb_info *lsi)
 	INIT_LIST_HEAD(&sbi->ll_squash.rsi_nosquash_nids);
 	spin_lock_init(&sbi->ll_squash.rsi_lock);
 
+	/* xattr cache memory */
+	spin_lock_init(&sbi->ll_xattr_lru_lock);
+	INIT_LIST_HEAD(&sbi->ll_xattr_lru);
+	sbi->ll_xattr_cache_max_bytes = SBI_DEFAULT_XATTR_CACHE_MAX_MB << 20;
+
 	/* Per-filesystem file heat */
 	sbi->ll_heat_decay_weight = SBI_DEFAULT_HEAT_DECAY_WEIGHT;
 	sbi->ll_heat_period_second = SBI_DEFAULT_HEAT_PERIOD_SECOND;
@@ -233,6 +244,7 @@ static struct ll_sb_info *ll_init_sbi(struct lustre_sb_info *lsi)
 		SBI_DEFAULT_HYBRID_IO_WRITE_THRESHOLD;
 	sbi->ll_hybrid_io_read_threshold_bytes =
 		SBI_DEFAULT_HYBRID_IO_READ_THRESHOLD;
+	sbi->ll_contention_seconds = SBI_DEFAULT_CONTENTION_SECONDS;
 
 	/* setstripe is allowed for all groups by default */
 	sbi->ll_enable_setstripe_gid = -1;
@@ -386,7 +398,8 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt)
 				   OBD_CONNECT2_DMV_IMP_INHERIT |
 				   OBD_CONNECT2_UNALIGNED_DIO |
 				   OBD_CONNECT2_PCCRO |
-				   OBD_CONNECT2_MIRROR_ID_FIX;
+				   OBD_CONNECT2_MIRROR_ID_FIX |
+				   OBD_CONNECT2_READDIR_PLUS;
 
 #ifdef HAVE_LRU_RESIZE_SUPPORT
 	if (test_bit(LL_SBI_LRU_RESIZE, sbi->ll_flags))
@@ -990,6 +1003,9 @@ void ll_kill_super(struct super_block *sb)
 	if (sbi) {
 		sb->s_dev = sbi->ll_sdev_orig;
 
+		/* PCC flusher holds inode references */
+		pcc_flush_stop(&sbi->ll_pcc_super);
+
 		/* wait running statahead threads to quit */
 		while (atomic_read(&sbi->ll_sa_running) > 0 ||
 		       atomic_read(&sbi->ll_sa_refcnt) > 0)
@@ -1048,6 +1064,9 @@ static const match_table_t ll_sbi_flags_name = {
 	{LL_SBI_HYBRID_IO,		"hybrid_io"},
 	{LL_SBI_ENCRYPT_NAME,		"name_encrypt"},
 	{LL_SBI_UNALIGNED_DIO,		"unaligned_dio"},
+	{LL_SBI_READDIR_PLUS,		"readdir_plus"},
+	{LL_SBI_DIR_MISS_LOCK,		"dir_miss_lock"},
+	{LL_SBI_STRICT_SOM,		"strict_som"},
 };
 
 int ll_sbi_flags_seq_show(struct seq_file *m, void *v)
@@ -1282,6 +1301,8 @@ void ll_lli_init(struct ll_inode_info *lli)
 		lli->lli_stat_pid = 0;
 		lli->lli_sa_enabled = 0;
 		init_rwsem(&lli->lli_lsm_sem);
+		bitmap_zero(lli->lli_miss_filter, LL_MISS_FILTER_BITS);
+		lli->lli_miss_count = 0;
 	} else {
 		struct job_info *ji = &lli->lli_jobinfo;
 
@@ -1298,6 +1319,7 @@ void ll_lli_init(struct ll_inode_info *lli)
 		spin_lock_init(&lli->lli_heat_lock);
 		obd_heat_clear(lli->lli_heat_instances, OBD_HEAT_COUNT);
 		lli->lli_heat_flags = 0;
+		lli->lli_contention_time = 0;
 		mutex_init(&lli->lli_pcc_lock);
 		lli->lli_pcc_state = PCC_STATE_FL_NONE;
 		lli->lli_pcc_inode = NULL;
@@ -3919,6 +3941,10 @@ struct md_op_data *ll_prep_md_op_data(struct md_op_data *op_data,
 	if (ll_need_32bit_api(ll_i2sbi(i1)))
 		op_data->op_cli_flags |= CLI_API32;
 
+	if (S_ISDIR(i1->i_mode) &&
+	    test_bit(LL_SBI_READDIR_PLUS, ll_i2sbi(i1)->ll_flags))
+		op_data->op_cli_flags |= CLI_READDIR_PLUS;
+
 	if ((i2 && is_root_inode(i2)) ||
 	    opc == LUSTRE_OPC_LOOKUP || opc == LUSTRE_OPC_CREATE) {
 		/* In case of lookup, ll_setup_filename() has already been
@@ -803,6 +803,70 @@ static ssize_t pcc_mode_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(pcc_mode);
 
+static ssize_t pcc_max_cached_mb_show(struct kobject *kobj,
+				      struct attribute *attr, char *buffer)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	struct pcc_super *super = &sbi->ll_pcc_super;
+
+	return scnprintf(buffer, PAGE_SIZE, "%llu\n",
+			 super->pccs_max_cached_mb);
+}
+
+static ssize_t pcc_max_cached_mb_store(struct kobject *kobj,
+				       struct attribute *attr,
+				       const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	struct pcc_super *super = &sbi->ll_pcc_super;
+	u64 bytes;
+	int rc;
+
+	rc = sysfs_memparse(buffer, count, &bytes, "MiB");
+	if (rc)
+		return rc;
+
+	super->pccs_max_cached_mb = bytes >> 20;
+	pcc_flush_start(super);
+
+	return count;
+}
+LUSTRE_RW_ATTR(pcc_max_cached_mb);
+
+static ssize_t pcc_writeback_delay_show(struct kobject *kobj,
+					struct attribute *attr, char *buffer)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	struct pcc_super *super = &sbi->ll_pcc_super;
+
+	return scnprintf(buffer, PAGE_SIZE, "%u\n",
+			 super->pccs_writeback_delay);
+}
+
+static ssize_t pcc_writeback_delay_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	struct pcc_super *super = &sbi->ll_pcc_super;
+	unsigned int delay;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &delay);
+	if (rc)
+		return rc;
+
+	super->pccs_writeback_delay = delay;
+	pcc_flush_start(super);
+
+	return count;
+}
+LUSTRE_RW_ATTR(pcc_writeback_delay);
+
 static ssize_t checksums_show(struct kobject *kobj, struct attribute *attr,
 			      char *buf)
 {
@@ -1487,6 +1551,40 @@ static ssize_t xattr_cache_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(xattr_cache);
 
+static ssize_t xattr_cache_max_mb_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%lu\n",
+			 sbi->ll_xattr_cache_max_bytes >> 20);
+}
+
+static ssize_t xattr_cache_max_mb_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned long val;
+	int rc;
+
+	rc = kstrtoul(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val > (ULONG_MAX >> 20))
+		return -ERANGE;
+
+	spin_lock(&sbi->ll_xattr_lru_lock);
+	sbi->ll_xattr_cache_max_bytes = val << 20;
+	spin_unlock(&sbi->ll_xattr_lru_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(xattr_cache_max_mb);
+
 static ssize_t intent_mkdir_show(struct kobject *kobj,
 				 struct attribute *attr, char *buf)
 {
@@ -1586,6 +1684,114 @@ static ssize_t unaligned_dio_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(unaligned_dio);
 
+static ssize_t readdir_plus_show(struct kobject *kobj,
+				 struct attribute *attr,
+				 char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			 test_bit(LL_SBI_READDIR_PLUS, sbi->ll_flags));
+}
+
+static ssize_t readdir_plus_store(struct kobject *kobj,
+				  struct attribute *attr,
+				  const char *buffer,
+				  size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	spin_lock(&sbi->ll_lock);
+	if (val)
+		set_bit(LL_SBI_READDIR_PLUS, sbi->ll_flags);
+	else
+		clear_bit(LL_SBI_READDIR_PLUS, sbi->ll_flags);
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(readdir_plus);
+
+static ssize_t dir_miss_lock_show(struct kobject *kobj,
+				  struct attribute *attr,
+				  char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			 test_bit(LL_SBI_DIR_MISS_LOCK, sbi->ll_flags));
+}
+
+static ssize_t dir_miss_lock_store(struct kobject *kobj,
+				   struct attribute *attr,
+				   const char *buffer,
+				   size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	spin_lock(&sbi->ll_lock);
+	if (val)
+		set_bit(LL_SBI_DIR_MISS_LOCK, sbi->ll_flags);
+	else
+		clear_bit(LL_SBI_DIR_MISS_LOCK, sbi->ll_flags);
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(dir_miss_lock);
+
+static ssize_t strict_som_show(struct kobject *kobj,
+			       struct attribute *attr,
+			       char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			 test_bit(LL_SBI_STRICT_SOM, sbi->ll_flags));
+}
+
+static ssize_t strict_som_store(struct kobject *kobj,
+				struct attribute *attr,
+				const char *buffer,
+				size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	spin_lock(&sbi->ll_lock);
+	if (val)
+		set_bit(LL_SBI_STRICT_SOM, sbi->ll_flags);
+	else
+		clear_bit(LL_SBI_STRICT_SOM, sbi->ll_flags);
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(strict_som);
+
 static ssize_t parallel_dio_show(struct kobject *kobj,
 				 struct attribute *attr,
 				 char *buf)
@@ -1728,6 +1934,40 @@ static ssize_t max_read_ahead_async_active_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(max_read_ahead_async_active);
 
+static ssize_t parallel_io_max_threads_show(struct kobject *kobj,
+					    struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", sbi->ll_pio_max_threads);
+}
+
+static ssize_t parallel_io_max_threads_store(struct kobject *kobj,
+					     struct attribute *attr,
+					     const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val > WQ_UNBOUND_MAX_ACTIVE) {
+		CERROR("%s: cannot set parallel_io_max_threads=%u larger than %u\n",
+		       sbi->ll_fsname, val, WQ_UNBOUND_MAX_ACTIVE);
+		return -ERANGE;
+	}
+
+	WRITE_ONCE(sbi->ll_pio_max_threads, val);
+
+	return count;
+}
+LUSTRE_RW_ATTR(parallel_io_max_threads);
+
 static ssize_t read_ahead_async_file_threshold_mb_show(struct kobject *kobj,
 						       struct attribute *attr,
 						       char *buf)
@@ -1814,6 +2054,114 @@ out:
 }
 LUSTRE_RW_ATTR(read_ahead_range_kb);
 
+static ssize_t read_ahead_streams_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			sbi->ll_ra_info.ra_max_streams);
+}
+
+/* only applies to the files opened afterwards */
+static ssize_t read_ahead_streams_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > LL_RA_STREAMS_MAX) {
+		CERROR("%s: read_ahead_streams=%u must be between 1 and %u\n",
+		       sbi->ll_fsname, val, LL_RA_STREAMS_MAX);
+		return -ERANGE;
+	}
+
+	sbi->ll_ra_info.ra_max_streams = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(read_ahead_streams);
+
+static ssize_t read_ahead_cross_files_show(struct kobject *kobj,
+					   struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			sbi->ll_ra_info.ra_xfile_count);
+}
+
+static ssize_t read_ahead_cross_files_store(struct kobject *kobj,
+					    struct attribute *attr,
+					    const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > LL_RA_XFILE_MAX) {
+		CERROR("%s: cannot set read_ahead_cross_files=%u > %u\n",
+		       sbi->ll_fsname, val, LL_RA_XFILE_MAX);
+		return -ERANGE;
+	}
+
+	sbi->ll_ra_info.ra_xfile_count = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(read_ahead_cross_files);
+
+static ssize_t read_ahead_cross_file_mb_show(struct kobject *kobj,
+					     struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return scnprintf(buf, PAGE_SIZE, "%lu\n",
+			 PAGES_TO_MiB(sbi->ll_ra_info.ra_xfile_max_pages));
+}
+
+static ssize_t read_ahead_cross_file_mb_store(struct kobject *kobj,
+					      struct attribute *attr,
+					      const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	u64 ra_max_mb, pages_number;
+	int rc;
+
+	rc = sysfs_memparse(buffer, count, &ra_max_mb, "MiB");
+	if (rc)
+		return rc;
+
+	pages_number = round_up(ra_max_mb, 1024 * 1024) >> PAGE_SHIFT;
+	if (pages_number > sbi->ll_ra_info.ra_max_pages) {
+		CERROR("%s: cannot set read_ahead_cross_file_mb=%llu > max_read_ahead_mb=%lu\n",
+		       sbi->ll_fsname, PAGES_TO_MiB(pages_number),
+		       PAGES_TO_MiB(sbi->ll_ra_info.ra_max_pages));
+		return -ERANGE;
+	}
+
+	sbi->ll_ra_info.ra_xfile_max_pages = pages_number;
+
+	return count;
+}
+LUSTRE_RW_ATTR(read_ahead_cross_file_mb);
+
 static ssize_t fast_read_show(struct kobject *kobj,
 			      struct attribute *attr,
 			      char *buf)
@@ -2152,6 +2500,34 @@ static ssize_t hybrid_io_read_threshold_bytes_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(hybrid_io_read_threshold_bytes);
 
+static ssize_t contention_seconds_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", sbi->ll_contention_seconds);
+}
+
+static ssize_t contention_seconds_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	sbi->ll_contention_seconds = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(contention_seconds);
+
 static int ll_unstable_stats_seq_show(struct seq_file *m, void *v)
 {
 	struct super_block	*sb    = m->private;
@@ -2456,8 +2832,12 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_max_read_ahead_per_file_mb.attr,
 	&lustre_attr_max_read_ahead_whole_mb.attr,
 	&lustre_attr_max_read_ahead_async_active.attr,
+	&lustre_attr_parallel_io_max_threads.attr,
 	&lustre_attr_read_ahead_async_file_threshold_mb.attr,
 	&lustre_attr_read_ahead_range_kb.attr,
+	&lustre_attr_read_ahead_streams.attr,
+	&lustre_attr_read_ahead_cross_files.attr,
+	&lustre_attr_read_ahead_cross_file_mb.attr,
 	&lustre_attr_stats_track_pid.attr,
 	&lustre_attr_stats_track_ppid.attr,
 	&lustre_attr_stats_track_gid.attr,
@@ -2476,11 +2856,15 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_max_easize.attr,
 	&lustre_attr_default_easize.attr,
 	&lustre_attr_xattr_cache.attr,
+	&lustre_attr_xattr_cache_max_mb.attr,
 	&lustre_attr_intent_mkdir.attr,
 	&lustre_attr_fast_read.attr,
 	&lustre_attr_tiny_write.attr,
 	&lustre_attr_parallel_dio.attr,
 	&lustre_attr_unaligned_dio.attr,
+	&lustre_attr_readdir_plus.attr,
+	&lustre_attr_dir_miss_lock.attr,
+	&lustre_attr_strict_som.attr,
 	&lustre_attr_hybrid_io.attr,
 	&lustre_attr_enable_setstripe_gid.attr,
 	&lustre_attr_file_heat.attr,
@@ -2492,6 +2876,7 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_inode_cache.attr,
 	&lustre_attr_hybrid_io_write_threshold_bytes.attr,
 	&lustre_attr_hybrid_io_read_threshold_bytes.attr,
+	&lustre_attr_contention_seconds.attr,
 #ifdef CONFIG_LL_ENCRYPTION
 	&lustre_attr_enable_filename_encryption.attr,
 #endif
@@ -2501,6 +2886,8 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_pcc_async_threshold.attr,
 	&lustre_attr_pcc_mode.attr,
 	&lustre_attr_pcc_async_affinity.attr,
+	&lustre_attr_pcc_max_cached_mb.attr,
+	&lustre_attr_pcc_writeback_delay.attr,
 	NULL,
 };
 
@@ -2571,12 +2958,23 @@ static const struct llite_file_opcode {
 	{ LPROC_LL_PCC_HIT_BYTES, LPROCFS_TYPE_BYTES_FULL, "pcc_hit_bytes" },
 	{ LPROC_LL_PCC_ATTACH_BYTES, LPROCFS_TYPE_BYTES_FULL,
 		"pcc_attach_bytes" },
+	{ LPROC_LL_PCC_WRITEBACK, LPROCFS_TYPE_REQS,	"pcc_writeback" },
+	{ LPROC_LL_PCC_EVICT,	LPROCFS_TYPE_REQS,	"pcc_evict" },
 	/* hybrid IO switch from buffered I/O (BIO) to direct I/O (DIO) */
 	{ LPROC_LL_HYBRID_NOSWITCH, LPROCFS_TYPE_REQS, "hybrid_noswitch" },
 	{ LPROC_LL_HYBRID_WRITESIZE_SWITCH, LPROCFS_TYPE_REQS,
 		"hybrid_writesize_switch" },
 	{ LPROC_LL_HYBRID_READSIZE_SWITCH, LPROCFS_TYPE_REQS,
 		"hybrid_readsize_switch" },
+	{ LPROC_LL_HYBRID_CONTENDED_SWITCH, LPROCFS_TYPE_REQS,
+		"hybrid_contended_switch" },
+	/* DIO on bvec pages, e.g. io_uring registered buffers */
+	{ LPROC_LL_DIO_BVEC_BYTES, LPROCFS_TYPE_BYTES_FULL, "dio_bvec_bytes" },
+	/* buffered I/O split over stripes and done by worker threads */
+	{ LPROC_LL_PIO_BYTES, LPROCFS_TYPE_BYTES_FULL, "parallel_io_bytes" },
+	{ LPROC_LL_PIO_FALLBACK, LPROCFS_TYPE_REQS, "parallel_io_fallback" },
+	/* dir UPDATE locks taken to cache negative dentries */
+	{ LPROC_LL_DIR_MISS_LOCK, LPROCFS_TYPE_REQS, "dir_miss_lock" },
 };
 
 void ll_stats_ops_tally(struct ll_sb_info *sbi, int op, long count)
@@ -2616,7 +3014,23 @@ static const char *const ra_stat_string[] = {
 	[RA_STAT_ASYNC]			= "async_readahead",
 	[RA_STAT_FAILED_FAST_READ]	= "failed_to_fast_read",
 	[RA_STAT_MMAP_RANGE_READ]	= "mmap_range_read",
-	[RA_STAT_READAHEAD_PAGES]	= "readahead_pages"
+	[RA_STAT_READAHEAD_PAGES]	= "readahead_pages",
+	[RA_STAT_STREAM_NEW]		= "stream_started",
+	[RA_STAT_STREAM_SWITCH]		= "stream_switched",
+	[RA_STAT_XFILE]			= "cross_file_readahead",
+	[RA_STAT_XFILE_HIT]		= "cross_file_hits",
+	[RA_STAT_XFILE_MISS]		= "cross_file_misses",
+};
+
+static const char *const ra_stream_stat_string[] = {
+	[RA_STREAM_STAT_HIT(0)]		= "stream0_hits",
+	[RA_STREAM_STAT_MISS(0)]	= "stream0_misses",
+	[RA_STREAM_STAT_HIT(1)]		= "stream1_hits",
+	[RA_STREAM_STAT_MISS(1)]	= "stream1_misses",
+	[RA_STREAM_STAT_HIT(2)]		= "stream2_hits",
+	[RA_STREAM_STAT_MISS(2)]	= "stream2_misses",
+	[RA_STREAM_STAT_HIT(3)]		= "stream3_hits",
+	[RA_STREAM_STAT_MISS(3)]	= "stream3_misses",
 };
 
 int ll_debugfs_register_super(struct super_block *sb, const char *name)
@@ -2696,7 +3110,26 @@ int ll_debugfs_register_super(struct super_block *sb, const char *name)
 	debugfs_create_file("read_ahead_stats", 0644, sbi->ll_debugfs_entry,
 			    sbi->ll_ra_stats, &ldebugfs_stats_seq_fops);
 
+	BUILD_BUG_ON(ARRAY_SIZE(ra_stream_stat_string) !=
+		     RA_STREAM_STAT_HIT(LL_RA_STREAMS_MAX));
+	sbi->ll_ra_stream_stats =
+		lprocfs_stats_alloc(ARRAY_SIZE(ra_stream_stat_string),
+				    LPROCFS_STATS_FLAG_NONE);
+	if (sbi->ll_ra_stream_stats == NULL)
+		GOTO(out_ra_stats, err = -ENOMEM);
+
+	for (id = 0; id < ARRAY_SIZE(ra_stream_stat_string); id++)
+		lprocfs_counter_init(sbi->ll_ra_stream_stats, id,
+				     LPROCFS_TYPE_PAGES,
+				     ra_stream_stat_string[id]);
+
+	debugfs_create_file("read_ahead_stream_stats", 0644,
+			    sbi->ll_debugfs_entry, sbi->ll_ra_stream_stats,
+			    &ldebugfs_stats_seq_fops);
+
 	RETURN(0);
+out_ra_stats:
+	lprocfs_stats_free(&sbi->ll_ra_stats);
 out_stats:
 	lprocfs_stats_free(&sbi->ll_stats);
 out_debugfs:
@@ -2725,6 +3158,7 @@ void ll_debugfs_unregister_super(struct super_block *sb)
 	kset_unregister(&sbi->ll_kset);
 	wait_for_completion(&sbi->ll_kobj_unregister);
 
+	lprocfs_stats_free(&sbi->ll_ra_stream_stats);
 	lprocfs_stats_free(&sbi->ll_ra_stats);
 	lprocfs_stats_free(&sbi->ll_stats);
 }
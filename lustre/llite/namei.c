@@ -33,6 +33,7 @@
 #include <linux/sched.h>
 #include <linux/mm.h>
 #include <linux/file.h>
+#include <linux/hash.h>
 #include <linux/quotaops.h>
 #include <linux/highmem.h>
 #include <linux/pagemap.h>
@@ -659,6 +660,96 @@ struct dentry *ll_splice_alias(struct inode *inode, struct dentry *de)
 	return de;
 }
 
+/*
+ * Names missed by lookup are remembered in a small bloom filter per
+ * directory. When one of them is looked up again, the UPDATE lock of the
+ * directory is taken before the lookup, so that a still missing name is
+ * kept as a valid negative dentry until the directory changes. A false
+ * positive of the filter only costs that lock. The filter is cleared when
+ * a quarter of it is used, to follow the recent misses only.
+ */
+#define LL_MISS_FILTER_SEED	0x9e3779b9
+
+static bool ll_dir_miss_repeated(struct inode *dir, const struct qstr *name)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+
+	if (!test_bit(LL_SBI_DIR_MISS_LOCK, ll_i2sbi(dir)->ll_flags) ||
+	    ll_dir_striped(dir))
+		return false;
+
+	return test_bit(hash_32(name->hash, LL_MISS_FILTER_SHIFT),
+			lli->lli_miss_filter) &&
+	       test_bit(hash_32(name->hash ^ LL_MISS_FILTER_SEED,
+				LL_MISS_FILTER_SHIFT), lli->lli_miss_filter);
+}
+
+static void ll_dir_miss_add(struct inode *dir, const struct qstr *name)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	bool seen1;
+	bool seen2;
+
+	if (ll_dir_striped(dir))
+		return;
+
+	seen1 = test_and_set_bit(hash_32(name->hash, LL_MISS_FILTER_SHIFT),
+				 lli->lli_miss_filter);
+	seen2 = test_and_set_bit(hash_32(name->hash ^ LL_MISS_FILTER_SEED,
+					 LL_MISS_FILTER_SHIFT),
+				 lli->lli_miss_filter);
+	if (seen1 && seen2)
+		return;
+
+	/* racy, but the filter is only a hint */
+	if (++lli->lli_miss_count > LL_MISS_FILTER_BITS / 4) {
+		bitmap_zero(lli->lli_miss_filter, LL_MISS_FILTER_BITS);
+		lli->lli_miss_count = 0;
+	}
+}
+
+/* get the UPDATE lock of @dir unless it is cached already */
+static void ll_dir_miss_lock(struct inode *dir)
+{
+	struct lookup_intent oit = { .it_op = IT_GETATTR };
+	struct obd_export *exp = ll_i2mdexp(dir);
+	struct ptlrpc_request *req = NULL;
+	struct md_op_data *op_data;
+	struct inode *inode = dir;
+	int rc;
+
+	ENTRY;
+
+	if (md_revalidate_lock(exp, &oit, ll_inode2fid(dir), NULL)) {
+		ll_intent_release(&oit);
+		RETURN_EXIT;
+	}
+
+	op_data = ll_prep_md_op_data(NULL, dir, dir, NULL, 0, 0,
+				     LUSTRE_OPC_ANY, NULL);
+	if (IS_ERR(op_data))
+		RETURN_EXIT;
+
+	rc = ll_intent_lock(exp, op_data, &oit, &req, &ll_md_blocking_ast, 0,
+			    true);
+	ll_finish_md_op_data(op_data);
+	if (rc == 0) {
+		/* the lock covers the attributes of the reply */
+		rc = ll_prep_inode(&inode, &req->rq_pill, NULL, &oit);
+		if (rc == 0) {
+			ll_set_lock_data(exp, dir, &oit, NULL);
+			ll_stats_ops_tally(ll_i2sbi(dir), LPROC_LL_DIR_MISS_LOCK,
+					   1);
+		}
+		ll_intent_release(&oit);
+	}
+	CDEBUG(D_DENTRY, "%s: UPDATE lock of "DFID" for lookup misses: rc = %d\n",
+	       ll_i2sbi(dir)->ll_fsname, PFID(ll_inode2fid(dir)), rc);
+	ptlrpc_req_put(req);
+
+	EXIT;
+}
+
 static int ll_lookup_it_finish(struct ptlrpc_request *request,
 			       struct lookup_intent *it,
 			       struct inode *parent, struct dentry **de,
@@ -804,6 +895,8 @@ static int ll_lookup_it_finish(struct ptlrpc_request *request,
 				       NULL)) {
 			d_lustre_revalidate(*de);
 			ll_intent_release(&parent_it);
+		} else {
+			ll_dir_miss_add(parent, &(*de)->d_name);
 		}
 	}
 
@@ -1030,6 +1123,11 @@ static struct dentry *ll_lookup_it(struct inode *parent, struct dentry *dentry,
 	if (rc)
 		RETURN(rc != -ENOENT ? ERR_PTR(rc) : NULL);
 
+	/* missed before, lock the directory first to cache a new miss */
+	if (!(it->it_op & IT_CREAT) &&
+	    ll_dir_miss_repeated(parent, &dentry->d_name))
+		ll_dir_miss_lock(parent);
+
 	op_data = ll_prep_md_op_data(NULL, parent, NULL, fname.disk_name.name,
 				     fname.disk_name.len, 0, opc, NULL);
 	if (IS_ERR(op_data)) {
@@ -116,6 +116,10 @@
 
 struct kmem_cache *pcc_inode_slab;
 
+static void pcc_flush_work(struct work_struct *work);
+static int pcc_get_layout_info(struct inode *inode, struct cl_layout *clt);
+static int pcc_hsm_remove_archive(struct inode *inode);
+
 int pcc_super_init(struct pcc_super *super)
 {
 	struct cred *cred;
@@ -131,6 +135,9 @@ int pcc_super_init(struct pcc_super *super)
 	super->pccs_generation = 1;
 	super->pccs_async_threshold = PCC_DEFAULT_ASYNC_THRESHOLD;
 	super->pccs_mode = S_IRUSR;
+	spin_lock_init(&super->pccs_lru_lock);
+	INIT_LIST_HEAD(&super->pccs_lru);
+	INIT_DELAYED_WORK(&super->pccs_flush_work, pcc_flush_work);
 
 	return 0;
 }
@@ -1326,12 +1333,19 @@ static void pcc_inode_init(struct pcc_inode *pcci, struct ll_inode_info *lli)
 	pcci->pcci_layout_gen = CL_LAYOUT_GEN_NONE;
 	atomic_set(&pcci->pcci_active_ios, 0);
 	init_waitqueue_head(&pcci->pcci_waitq);
+	INIT_LIST_HEAD(&pcci->pcci_lru);
+	pcci->pcci_dirty = false;
 }
 
 static void pcc_inode_fini(struct pcc_inode *pcci)
 {
 	struct inode *pcc_inode = pcci->pcci_path.dentry->d_inode;
 	struct ll_inode_info *lli = pcci->pcci_lli;
+	struct pcc_super *super = ll_info2pccs(lli);
+
+	spin_lock(&super->pccs_lru_lock);
+	list_del_init(&pcci->pcci_lru);
+	spin_unlock(&super->pccs_lru_lock);
 
 	/* The PCC file was once mmaped? */
 	if (pcc_inode && pcc_inode->i_mapping != &pcc_inode->i_data)
@@ -1370,6 +1384,298 @@ void pcc_inode_free(struct inode *inode)
 	pcc_inode_unlock(inode);
 }
 
+/* Note an I/O on the PCC copy for the LRU order and the writeback */
+static void pcc_inode_touch(struct pcc_inode *pcci, enum pcc_io_type iot)
+{
+	struct pcc_super *super = ll_info2pccs(pcci->pcci_lli);
+	time64_t now = ktime_get_seconds();
+
+	if (pcci->pcci_type == LU_PCC_READWRITE &&
+	    (iot == PIT_WRITE || iot == PIT_SETATTR || iot == PIT_PAGE_MKWRITE))
+		pcci->pcci_dirty = true;
+
+	/* move it at most once a second to keep the lock off the I/O path */
+	if (pcci->pcci_atime == now)
+		return;
+
+	pcci->pcci_atime = now;
+	spin_lock(&super->pccs_lru_lock);
+	if (!list_empty(&pcci->pcci_lru))
+		list_move_tail(&pcci->pcci_lru, &super->pccs_lru);
+	spin_unlock(&super->pccs_lru_lock);
+}
+
+static inline u64 pcc_inode_bytes(struct pcc_inode *pcci)
+{
+	struct inode *pcc_inode = pcci->pcci_path.dentry->d_inode;
+
+	return pcc_inode ? inode_get_bytes(pcc_inode) : 0;
+}
+
+#define PCC_FLUSH_INTERVAL	cfs_time_seconds(1)
+
+static int pcc_hsm_action_get(struct inode *inode,
+			      struct hsm_current_action *hca)
+{
+	struct md_op_data *op_data;
+	int rc;
+
+	op_data = ll_prep_md_op_data(NULL, inode, NULL, NULL, 0, 0,
+				     LUSTRE_OPC_ANY, hca);
+	if (IS_ERR(op_data))
+		return PTR_ERR(op_data);
+
+	rc = obd_iocontrol(LL_IOC_HSM_ACTION, ll_i2mdexp(inode),
+			   sizeof(*op_data), op_data, NULL);
+	ll_finish_md_op_data(op_data);
+
+	return rc;
+}
+
+/*
+ * Check the writeback restore of a RW-PCC file without waiting for it, and
+ * once it is confirmed remove the PCC copy. Nothing attaches the copy again
+ * after the restore, and a leftover archive copy would take PCC space
+ * outside of pccs_max_cached_mb.
+ *
+ * \retval 0 if the file is written back
+ * \retval -EINPROGRESS if the restore is still queued or running
+ * \retval negative errno if it failed, the PCC copy keeps the only data
+ */
+static int pcc_writeback_check(struct inode *inode)
+{
+	struct hsm_current_action hca = { 0 };
+	struct cl_layout clt = {
+		.cl_layout_gen = 0,
+		.cl_is_released = false,
+	};
+	struct pcc_inode *pcci;
+	bool attached;
+	__u32 gen;
+	int rc;
+
+	rc = pcc_hsm_action_get(inode, &hca);
+	if (rc)
+		return rc;
+
+	if (hca.hca_action == HUA_RESTORE &&
+	    (hca.hca_state == HPS_WAITING || hca.hca_state == HPS_RUNNING))
+		return -EINPROGRESS;
+
+	/* the restore is over, the layout lock is not held for it anymore */
+	rc = ll_layout_refresh(inode, &gen);
+	if (rc)
+		return rc;
+
+	rc = pcc_get_layout_info(inode, &clt);
+	if (rc)
+		return rc;
+
+	if (clt.cl_is_released)
+		return -EAGAIN;
+
+	/* the file may have been attached again meanwhile */
+	pcc_inode_lock(inode);
+	pcci = ll_i2pcci(inode);
+	attached = pcci && pcc_inode_has_layout(pcci);
+	pcc_inode_unlock(inode);
+	if (attached)
+		return 0;
+
+	return pcc_hsm_remove_archive(inode);
+}
+
+/*
+ * Write back the RW-PCC files which are not opened and were idle for
+ * pccs_writeback_delay seconds. The data is restored into Lustre by the
+ * HSM copytool of the dataset. The restore revokes the layout lock and so
+ * detaches the file.
+ *
+ * The flusher must not wait for the copytool, so the restores are only
+ * requested here, and checked by the next scans, which remove the PCC copy
+ * once the data is back in Lustre. Files still being restored hold their
+ * slot in pccs_wb_inodes, no more restores are requested than it has.
+ */
+static void pcc_writeback_scan(struct pcc_super *super)
+{
+	struct inode *inodes[PCC_FLUSH_BATCH];
+	const struct cred *old_cred;
+	struct pcc_inode *pcci;
+	time64_t idle;
+	int pending = 0;
+	int count = 0;
+	int rc;
+	int i;
+
+	old_cred = override_creds(super->pccs_cred);
+	for (i = 0; i < super->pccs_wb_count; i++) {
+		struct inode *inode = super->pccs_wb_inodes[i];
+
+		rc = pcc_writeback_check(inode);
+		if (rc == -EINPROGRESS) {
+			super->pccs_wb_inodes[pending++] = inode;
+			continue;
+		}
+
+		CDEBUG(D_CACHE, DFID" PCC writeback: rc = %d\n",
+		       PFID(ll_inode2fid(inode)), rc);
+		if (rc) {
+			/* retry it at the next scan */
+			pcc_inode_lock(inode);
+			pcci = ll_i2pcci(inode);
+			if (pcci && pcc_inode_has_layout(pcci))
+				pcci->pcci_dirty = true;
+			pcc_inode_unlock(inode);
+		} else {
+			ll_stats_ops_tally(ll_i2sbi(inode),
+					   LPROC_LL_PCC_WRITEBACK, 1);
+		}
+		iput(inode);
+	}
+	super->pccs_wb_count = pending;
+
+	if (!super->pccs_writeback_delay)
+		goto out_creds;
+
+	idle = ktime_get_seconds() - super->pccs_writeback_delay;
+	spin_lock(&super->pccs_lru_lock);
+	list_for_each_entry(pcci, &super->pccs_lru, pcci_lru) {
+		if (pending + count == PCC_FLUSH_BATCH)
+			break;
+
+		/* the rest of the list was used more recently */
+		if (pcci->pcci_atime > idle)
+			break;
+
+		if (!pcci->pcci_dirty ||
+		    pcci->pcci_type != LU_PCC_READWRITE ||
+		    atomic_read(&pcci->pcci_refcount) > 1)
+			continue;
+
+		inodes[count] = igrab(&pcci->pcci_lli->lli_vfs_inode);
+		if (!inodes[count])
+			continue;
+
+		pcci->pcci_dirty = false;
+		count++;
+	}
+	spin_unlock(&super->pccs_lru_lock);
+
+	for (i = 0; i < count; i++) {
+		struct inode *inode = inodes[i];
+
+		rc = ll_layout_restore(inode, 0, OBD_OBJECT_EOF);
+		if (rc == 0) {
+			super->pccs_wb_inodes[super->pccs_wb_count++] = inode;
+			continue;
+		}
+
+		CDEBUG(D_CACHE, DFID" PCC writeback restore: rc = %d\n",
+		       PFID(ll_inode2fid(inode)), rc);
+		pcc_inode_lock(inode);
+		pcci = ll_i2pcci(inode);
+		if (pcci && pcc_inode_has_layout(pcci))
+			pcci->pcci_dirty = true;
+		pcc_inode_unlock(inode);
+		iput(inode);
+	}
+out_creds:
+	revert_creds(old_cred);
+}
+
+/*
+ * Detach and uncache the least recently used RO-PCC copies which are not
+ * opened, until the attached copies fit in pccs_max_cached_mb again.
+ * RW-PCC copies may hold the only copy of the data, they are only removed
+ * by pcc_writeback_scan() once the data is restored into Lustre.
+ */
+static void pcc_evict_scan(struct pcc_super *super)
+{
+	u64 limit = super->pccs_max_cached_mb << 20;
+	struct inode *inodes[PCC_FLUSH_BATCH];
+	struct pcc_inode *pcci;
+	u64 cached = 0;
+	int count = 0;
+	int rc;
+	int i;
+
+	if (!limit)
+		return;
+
+	spin_lock(&super->pccs_lru_lock);
+	list_for_each_entry(pcci, &super->pccs_lru, pcci_lru)
+		cached += pcc_inode_bytes(pcci);
+
+	list_for_each_entry(pcci, &super->pccs_lru, pcci_lru) {
+		if (cached <= limit || count == PCC_FLUSH_BATCH)
+			break;
+
+		if (!pcc_inode_has_layout(pcci) ||
+		    pcci->pcci_type != LU_PCC_READONLY ||
+		    atomic_read(&pcci->pcci_refcount) > 1)
+			continue;
+
+		inodes[count] = igrab(&pcci->pcci_lli->lli_vfs_inode);
+		if (!inodes[count])
+			continue;
+
+		cached -= min(cached, pcc_inode_bytes(pcci));
+		count++;
+	}
+	spin_unlock(&super->pccs_lru_lock);
+
+	for (i = 0; i < count; i++) {
+		struct inode *inode = inodes[i];
+		__u32 flags = PCC_DETACH_FL_UNCACHE;
+
+		rc = pcc_ioctl_detach(inode, &flags);
+		CDEBUG(D_CACHE, DFID" PCC eviction: rc = %d, flags = %#x\n",
+		       PFID(ll_inode2fid(inode)), rc, flags);
+		if (!rc && flags & PCC_DETACH_FL_CACHE_REMOVED)
+			ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_PCC_EVICT,
+					   1);
+		iput(inode);
+	}
+}
+
+static void pcc_flush_work(struct work_struct *work)
+{
+	struct pcc_super *super = container_of(to_delayed_work(work),
+					       struct pcc_super,
+					       pccs_flush_work);
+
+	pcc_writeback_scan(super);
+	pcc_evict_scan(super);
+	pcc_flush_start(super);
+}
+
+/* (Re)arm the flusher if the writeback or the eviction is enabled, or
+ * writeback restores are still to be checked
+ */
+void pcc_flush_start(struct pcc_super *super)
+{
+	spin_lock(&super->pccs_lru_lock);
+	if (!super->pccs_flush_stopped &&
+	    (super->pccs_writeback_delay || super->pccs_max_cached_mb ||
+	     super->pccs_wb_count))
+		queue_delayed_work(system_long_wq, &super->pccs_flush_work,
+				   PCC_FLUSH_INTERVAL);
+	spin_unlock(&super->pccs_lru_lock);
+}
+
+/* Called at umount, before the inodes are evicted */
+void pcc_flush_stop(struct pcc_super *super)
+{
+	spin_lock(&super->pccs_lru_lock);
+	super->pccs_flush_stopped = true;
+	spin_unlock(&super->pccs_lru_lock);
+	cancel_delayed_work_sync(&super->pccs_flush_work);
+
+	/* the restores go on, their PCC copies are left to the admin */
+	while (super->pccs_wb_count > 0)
+		iput(super->pccs_wb_inodes[--super->pccs_wb_count]);
+}
+
 /*
  * Add HSMTOOL_POSIX_V2 support.
  * As Andreas suggested, we'd better use new layout to
@@ -1479,12 +1785,20 @@ static void pcc_inode_attach_init(struct pcc_dataset *dataset,
 				  struct dentry *dentry,
 				  enum lu_pcc_type type)
 {
+	struct pcc_super *super = ll_info2pccs(pcci->pcci_lli);
+
 	pcci->pcci_path.mnt = mntget(dataset->pccd_path.mnt);
 	pcci->pcci_path.dentry = dentry;
 	LASSERT(atomic_read(&pcci->pcci_refcount) == 0);
 	atomic_set(&pcci->pcci_refcount, 1);
 	pcci->pcci_type = type;
 	pcci->pcci_attr_valid = false;
+	/* RW-PCC data is only in the PCC copy until it is written back */
+	pcci->pcci_dirty = type == LU_PCC_READWRITE;
+	pcci->pcci_atime = ktime_get_seconds();
+	spin_lock(&super->pccs_lru_lock);
+	list_add_tail(&pcci->pcci_lru, &super->pccs_lru);
+	spin_unlock(&super->pccs_lru_lock);
 }
 
 static inline void pcc_inode_dsflags_set(struct ll_inode_info *lli,
@@ -2276,6 +2590,7 @@ static void pcc_io_init(struct inode *inode, enum pcc_io_type iot,
 			pcc_inode_detach_put(inode);
 		} else {
 			atomic_inc(&pcci->pcci_active_ios);
+			pcc_inode_touch(pcci, iot);
 			*cached = true;
 		}
 	} else {
@@ -2290,6 +2605,7 @@ static void pcc_io_init(struct inode *inode, enum pcc_io_type iot,
 				pcci = ll_i2pcci(inode);
 				LASSERT(atomic_read(&pcci->pcci_refcount) > 0);
 				atomic_inc(&pcci->pcci_active_ios);
+				pcc_inode_touch(pcci, iot);
 			}
 		}
 	}
@@ -2819,11 +3135,13 @@ static void pcc_mmap_io_init(struct inode *inode, enum pcc_io_type iot,
 					*cached = false;
 				} else {
 					atomic_inc(&pcci->pcci_active_ios);
+					pcc_inode_touch(pcci, iot);
 					*cached = true;
 				}
 			}
 		} else {
 			atomic_inc(&pcci->pcci_active_ios);
+			pcc_inode_touch(pcci, iot);
 			*cached = true;
 		}
 	} else {
@@ -4064,26 +4382,15 @@ int pcc_ioctl_attach(struct file *file, struct inode *inode,
 	RETURN(rc);
 }
 
-static int pcc_hsm_remove(struct inode *inode)
+/* ask the copytool to remove the archive copy, i.e. the PCC copy */
+static int pcc_hsm_remove_archive(struct inode *inode)
 {
 	struct hsm_user_request *hur;
-	__u32 gen;
 	int len;
 	int rc;
 
 	ENTRY;
 
-	rc = ll_layout_restore(inode, 0, OBD_OBJECT_EOF);
-	if (rc) {
-		CDEBUG(D_CACHE, DFID" RESTORE failure: %d\n",
-		       PFID(&ll_i2info(inode)->lli_fid), rc);
-		/* ignore the RESTORE failure.
-		 * i.e. the file is in exists dirty archived state.
-		 */
-	} else {
-		ll_layout_refresh(inode, &gen);
-	}
-
 	len = sizeof(struct hsm_user_request) +
 	      sizeof(struct hsm_user_item);
 	OBD_ALLOC(hur, len);
@@ -4108,6 +4415,27 @@ static int pcc_hsm_remove(struct inode *inode)
 	RETURN(rc);
 }
 
+static int pcc_hsm_remove(struct inode *inode)
+{
+	__u32 gen;
+	int rc;
+
+	ENTRY;
+
+	rc = ll_layout_restore(inode, 0, OBD_OBJECT_EOF);
+	if (rc) {
+		CDEBUG(D_CACHE, DFID" RESTORE failure: %d\n",
+		       PFID(&ll_i2info(inode)->lli_fid), rc);
+		/* ignore the RESTORE failure.
+		 * i.e. the file is in exists dirty archived state.
+		 */
+	} else {
+		ll_layout_refresh(inode, &gen);
+	}
+
+	RETURN(pcc_hsm_remove_archive(inode));
+}
+
 int pcc_ioctl_detach(struct inode *inode, __u32 *flags)
 {
 	struct ll_inode_info *lli = ll_i2info(inode);
@@ -37,6 +37,7 @@
 #include <linux/kref.h>
 #include <linux/types.h>
 #include <linux/seq_file.h>
+#include <linux/workqueue.h>
 #include <uapi/linux/lustre/lustre_user.h>
 
 extern struct kmem_cache *pcc_inode_slab;
@@ -155,6 +156,7 @@ struct pcc_dataset {
 };
 
 #define PCC_DEFAULT_ASYNC_THRESHOLD	(256 << 20)
+#define PCC_FLUSH_BATCH			32
 
 struct pcc_super {
 	/* Protect pccs_datasets */
@@ -173,6 +175,20 @@ struct pcc_super {
 	__u64			 pccs_async_threshold;
 	bool			 pccs_async_affinity;
 	umode_t			 pccs_mode;
+	/* Protect pccs_lru and pccs_flush_stopped */
+	spinlock_t		 pccs_lru_lock;
+	/* Attached PCC copies, the least recently used first */
+	struct list_head	 pccs_lru;
+	/* Space limit of the attached PCC copies in MiB, 0 for no limit */
+	__u64			 pccs_max_cached_mb;
+	/* Idle seconds before a RW-PCC file is written back, 0 to disable */
+	unsigned int		 pccs_writeback_delay;
+	/* Periodic writeback and eviction of the attached PCC copies */
+	struct delayed_work	 pccs_flush_work;
+	bool			 pccs_flush_stopped;
+	/* Files with a writeback restore in flight, only used by the flusher */
+	struct inode		*pccs_wb_inodes[PCC_FLUSH_BATCH];
+	int			 pccs_wb_count;
 };
 
 struct pcc_inode {
@@ -199,6 +215,12 @@ struct pcc_inode {
 	atomic_t		 pcci_active_ios;
 	/* Waitq - wait for PCC I/O completion. */
 	wait_queue_head_t	 pcci_waitq;
+	/* Linked to pccs_lru while attached */
+	struct list_head	 pcci_lru;
+	/* Time of the last I/O on the PCC copy, in seconds */
+	time64_t		 pcci_atime;
+	/* RW-PCC data which is not written back into Lustre yet */
+	bool			 pcci_dirty;
 };
 
 struct pcc_file {
@@ -274,6 +296,8 @@ struct pcc_create_attach {
 
 int pcc_super_init(struct pcc_super *super);
 void pcc_super_fini(struct pcc_super *super);
+void pcc_flush_start(struct pcc_super *super);
+void pcc_flush_stop(struct pcc_super *super);
 int pcc_cmd_handle(char *buffer, unsigned long count,
 		   struct pcc_super *super);
 int pcc_super_dump(struct pcc_super *super, struct seq_file *m);
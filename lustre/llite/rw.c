@@ -164,8 +164,9 @@ static void ll_ra_stats_add(struct inode *inode, enum ra_stat which, long count)
 
 #define RAS_CDEBUG(ras) \
 	CDEBUG(D_READA,							     \
-	       "lre %llu cr %lu cb %llu wsi %lu wp %lu nra %lu rpc %lu "     \
+	       "s %u lre %llu cr %lu cb %llu wsi %lu wp %lu nra %lu rpc %lu " \
 	       "r %lu csr %lu so %llu sb %llu sl %llu lr %lu\n",	     \
+	       ras->ras_stream,						     \
 	       ras->ras_last_read_end_bytes, ras->ras_consecutive_requests,  \
 	       ras->ras_consecutive_bytes, ras->ras_window_start_idx,	     \
 	       ras->ras_window_pages, ras->ras_next_readahead_idx,	     \
@@ -574,7 +575,10 @@ static void ll_readahead_locks_release(const struct lu_env *env,
 
 static void ll_readahead_work_free(struct ll_readahead_work *work)
 {
-	fput(work->lrw_file);
+	if (work->lrw_file)
+		fput(work->lrw_file);
+	else
+		iput(work->lrw_inode);
 	OBD_FREE_PTR(work);
 }
 
@@ -632,7 +636,7 @@ static void ll_readahead_handle_work(struct work_struct *wq)
 	work = container_of(wq, struct ll_readahead_work,
 			    lrw_readahead_work);
 	lfd = work->lrw_file->private_data;
-	ras = &lfd->fd_ras;
+	ras = work->lrw_ras;
 	file = work->lrw_file;
 	inode = file_inode(file);
 	sbi = ll_i2sbi(inode);
@@ -749,6 +753,192 @@ out_free_work:
 	ll_readahead_work_free(work);
 }
 
+/*
+ * Read the start of a file which is not open yet, see ll_readahead_inode().
+ * The pages are read under the lock cl_glimpse_size() leaves cached, if
+ * any, as ll_readahead_handle_work() does not lock either.
+ */
+static void ll_readahead_inode_handle_work(struct work_struct *wq)
+{
+	struct ll_readahead_work *work;
+	struct ll_readahead_state *ras;
+	struct inode *inode;
+	struct ll_sb_info *sbi;
+	struct ll_inode_info *lli;
+	struct lu_env *env;
+	struct cl_io *io;
+	struct cl_2queue *queue;
+	struct ra_io_arg *ria;
+	pgoff_t ra_end_idx = 0;
+	pgoff_t eof_index;
+	unsigned long budget;
+	unsigned long pages;
+	bool prefetched = false;
+	__u16 refcheck;
+	__u64 kms;
+	int rc;
+
+	work = container_of(wq, struct ll_readahead_work,
+			    lrw_readahead_work);
+	inode = work->lrw_inode;
+	sbi = ll_i2sbi(inode);
+	lli = ll_i2info(inode);
+	budget = work->lrw_end_idx + 1;
+
+	CDEBUG(D_READA, DFID": cross-file ra up to %lu\n",
+	       PFID(ll_inode2fid(inode)), work->lrw_end_idx);
+
+	OBD_ALLOC_PTR(ras);
+	if (!ras)
+		GOTO(out_free_work, rc = -ENOMEM);
+	ras->ras_rpc_pages = PTLRPC_MAX_BRW_PAGES;
+
+	/* file size, and a lock to read the data under */
+	rc = cl_glimpse_size(inode);
+	if (rc)
+		GOTO(out_free_ras, rc);
+
+	env = cl_env_alloc(&refcheck, LCT_NOREF);
+	if (IS_ERR(env))
+		GOTO(out_free_ras, rc = PTR_ERR(env));
+
+	io = vvp_env_thread_io(env);
+	io->ci_obj = lli->lli_clob;
+	io->ci_lockreq = CILR_MAYBE;
+	io->ci_ndelay = 1;
+
+	rc = ll_readahead_file_kms(env, io, &kms);
+	if (rc != 0)
+		GOTO(out_put_env, rc);
+
+	if (kms == 0) {
+		ll_ra_stats_inc(inode, RA_STAT_ZERO_LEN);
+		GOTO(out_put_env, rc = 0);
+	}
+
+	ria = &ll_env_info(env)->lti_ria;
+	memset(ria, 0, sizeof(*ria));
+	INIT_LIST_HEAD(&ria->ria_cl_ra_list);
+
+	eof_index = (pgoff_t)(kms - 1) >> PAGE_SHIFT;
+	if (eof_index <= work->lrw_end_idx) {
+		work->lrw_end_idx = eof_index;
+		ria->ria_eof = true;
+	}
+	ria->ria_start_idx = 0;
+	ria->ria_end_idx = work->lrw_end_idx;
+	pages = ria->ria_end_idx + 1;
+	ria->ria_reserved = ll_ra_count_get(sbi, ria, pages, 0);
+	if (ria->ria_reserved < pages) {
+		ll_ra_stats_inc(inode, RA_STAT_MAX_IN_FLIGHT);
+		if (ria->ria_reserved == 0)
+			GOTO(out_put_env, rc = 0);
+	}
+
+	rc = cl_io_rw_init(env, io, CIT_READ, 0, (loff_t)pages << PAGE_SHIFT);
+	if (rc) {
+		ll_ra_count_put(sbi, ria->ria_reserved);
+		GOTO(out_put_env, rc);
+	}
+
+	vvp_env_io(env)->vui_fd = NULL;
+	io->ci_state = CIS_LOCKED;
+	io->ci_async_readahead = true;
+	rc = cl_io_start(env, io);
+	if (rc) {
+		ll_ra_count_put(sbi, ria->ria_reserved);
+		GOTO(out_io_fini, rc);
+	}
+
+	queue = &io->ci_queue;
+	cl_2queue_init(queue);
+
+	rc = ll_read_ahead_pages(env, io, &queue->c2_qin, ras, ria,
+				 &ra_end_idx, 0);
+	if (ria->ria_reserved != 0)
+		ll_ra_count_put(sbi, ria->ria_reserved);
+	if (queue->c2_qin.pl_nr > 0) {
+		int count = queue->c2_qin.pl_nr;
+
+		rc = cl_io_submit_rw(env, io, CRT_READ, queue);
+		if (rc == 0) {
+			task_io_account_read(PAGE_SIZE * count);
+			ll_ra_stats_inc_sbi(sbi, RA_STAT_XFILE);
+			prefetched = true;
+		}
+	}
+
+	ll_readahead_locks_release(env, &ria->ria_cl_ra_list);
+
+	if (ra_end_idx != ria->ria_end_idx)
+		ll_ra_stats_inc(inode, RA_STAT_FAILED_REACH_END);
+
+	cl_page_list_discard(env, io, &queue->c2_qin);
+	cl_page_list_disown(env, &queue->c2_qin);
+	cl_2queue_fini(env, queue);
+out_io_fini:
+	cl_io_end(env, io);
+	cl_io_fini(env, io);
+out_put_env:
+	cl_env_put(env, &refcheck);
+out_free_ras:
+	OBD_FREE_PTR(ras);
+out_free_work:
+	if (!prefetched)
+		clear_bit(LLIF_XFILE_READAHEAD, &lli->lli_flags);
+	atomic_sub(budget, &sbi->ll_ra_info.ra_xfile_pages);
+	atomic_dec(&sbi->ll_ra_info.ra_async_inflight);
+	ll_readahead_work_free(work);
+}
+
+/**
+ * Prefetch the data of \a inode before it is even opened, because the
+ * process scanning its directory is expected to read it next. Only the
+ * first max_read_ahead_whole_mb of the file are read, within the
+ * read_ahead_cross_file_mb budget of the mount.
+ *
+ * Takes over the reference on \a inode.
+ */
+void ll_readahead_inode(struct inode *inode)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_ra_info *ra = &sbi->ll_ra_info;
+	struct ll_readahead_work *lrw;
+	unsigned long pages;
+
+	pages = min(ra->ra_max_read_ahead_whole_pages,
+		    ra->ra_max_pages_per_file);
+	if (pages == 0 || !ll_readahead_enabled(sbi) ||
+	    atomic_read(&ra->ra_async_inflight) > ra->ra_async_max_active)
+		GOTO(out, 0);
+
+	if (atomic_add_return(pages, &ra->ra_xfile_pages) >
+	    ra->ra_xfile_max_pages) {
+		atomic_sub(pages, &ra->ra_xfile_pages);
+		ll_ra_stats_inc_sbi(sbi, RA_STAT_MAX_IN_FLIGHT);
+		GOTO(out, 0);
+	}
+
+	/* ll_readahead_work_free() free it */
+	OBD_ALLOC_PTR(lrw);
+	if (!lrw) {
+		atomic_sub(pages, &ra->ra_xfile_pages);
+		GOTO(out, 0);
+	}
+
+	atomic_inc(&ra->ra_async_inflight);
+	lrw->lrw_inode = inode;
+	lrw->lrw_start_idx = 0;
+	lrw->lrw_end_idx = pages - 1;
+	lrw->lrw_user_pid = current->pid;
+	INIT_WORK(&lrw->lrw_readahead_work, ll_readahead_inode_handle_work);
+	queue_work(ra->ll_readahead_wq, &lrw->lrw_readahead_work);
+	return;
+out:
+	clear_bit(LLIF_XFILE_READAHEAD, &ll_i2info(inode)->lli_flags);
+	iput(inode);
+}
+
 static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 			struct cl_page_list *queue, struct ra_io_arg *ria,
 			struct ll_readahead_state *ras, bool hit,
@@ -790,7 +980,7 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 		RETURN(0);
 	}
 
-	spin_lock(&ras->ras_lock);
+	spin_lock(ras->ras_lock);
 
 	/*
 	 * Note: other thread might rollback the ras_next_readahead_idx,
@@ -834,7 +1024,7 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 		ria->ria_length = ras->ras_stride_length;
 		ria->ria_bytes = ras->ras_stride_bytes;
 	}
-	spin_unlock(&ras->ras_lock);
+	spin_unlock(ras->ras_lock);
 
 	pages = ria_page_count(ria);
 
@@ -906,9 +1096,9 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 		/* update the ras so that the next read-ahead tries from
 		 * where we left off.
 		 */
-		spin_lock(&ras->ras_lock);
+		spin_lock(ras->ras_lock);
 		ras->ras_next_readahead_idx = ra_end_idx + 1;
-		spin_unlock(&ras->ras_lock);
+		spin_unlock(ras->ras_lock);
 		RAS_CDEBUG(ras);
 	}
 
@@ -974,11 +1164,24 @@ static void ras_stride_reset(struct ll_readahead_state *ras)
 	RAS_CDEBUG(ras);
 }
 
-void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras)
+void ll_readahead_init(struct inode *inode, struct ll_readahead_streams *rss)
 {
-	spin_lock_init(&ras->ras_lock);
+	struct ll_readahead_state *ras = &rss->rss_streams[0];
+
+	spin_lock_init(&rss->rss_lock);
+	rss->rss_max = clamp_t(unsigned int,
+			       ll_i2sbi(inode)->ll_ra_info.ra_max_streams,
+			       1, LL_RA_STREAMS_MAX);
+	rss->rss_count = 1;
+	rss->rss_clock = 0;
+	rss->rss_last = ras;
+
+	ras->ras_lock = &rss->rss_lock;
+	ras->ras_stream = 0;
+	ras->ras_access = 0;
 	ras->ras_rpc_pages = PTLRPC_MAX_BRW_PAGES;
 	ras_reset(ras, 0);
+	ras->ras_last_read_start_bytes = 0;
 	ras->ras_last_read_end_bytes = 0;
 	ras->ras_requests = 0;
 	ras->ras_range_min_start_idx = 0;
@@ -1261,18 +1464,122 @@ static void ras_detect_read_pattern(struct ll_readahead_state *ras,
 		ras->ras_need_increase_window = true;
 	}
 
+	ras->ras_last_read_start_bytes = pos;
 	ras->ras_last_read_end_bytes = pos + bytes - 1;
 	RAS_CDEBUG(ras);
 }
 
+/*
+ * Whether an access at \a pos belongs to stream \a ras: it is close to
+ * what the stream read last, or is the next chunk of its stride.
+ */
+static bool ras_stream_match(struct ll_sb_info *sbi,
+			     struct ll_readahead_state *ras,
+			     loff_t pos, loff_t bytes, bool mmap)
+{
+	unsigned long slack = mmap ?
+		sbi->ll_ra_info.ra_range_pages << PAGE_SHIFT : 8UL << PAGE_SHIFT;
+
+	/* never accessed yet */
+	if (ras->ras_access == 0)
+		return true;
+
+	if (pos_in_window(pos, ras->ras_last_read_end_bytes,
+			  ras->ras_last_read_end_bytes -
+			  ras->ras_last_read_start_bytes + slack, slack))
+		return true;
+
+	return read_in_stride_window(ras, pos, bytes);
+}
+
+/*
+ * Find the read-ahead stream of \a lfd an access at [pos, pos + bytes)
+ * belongs to.
+ *
+ * An access which matches none of the streams forks the stream of the
+ * previous access into a free slot, or into the least recently used one.
+ * The fork sees the access as a seek, exactly like a single stream would
+ * and so can still detect a stride, while the stream it was forked from
+ * keeps its window for the reader that comes back to it.
+ */
+static struct ll_readahead_state *ras_stream_get(struct ll_sb_info *sbi,
+						 struct ll_file_data *lfd,
+						 loff_t pos, loff_t bytes,
+						 bool mmap)
+{
+	struct ll_readahead_streams *rss = &lfd->fd_ras_streams;
+	struct ll_readahead_state *ras = rss->rss_last;
+	struct ll_readahead_state *lru = NULL;
+	unsigned int i;
+
+	spin_lock(&rss->rss_lock);
+	rss->rss_clock++;
+	if (ras_stream_match(sbi, ras, pos, bytes, mmap))
+		goto out_unlock;
+
+	for (i = 0; i < rss->rss_count; i++) {
+		struct ll_readahead_state *cur = &rss->rss_streams[i];
+
+		if (cur == rss->rss_last)
+			continue;
+
+		if (ras_stream_match(sbi, cur, pos, bytes, mmap)) {
+			ll_ra_stats_inc_sbi(sbi, RA_STAT_STREAM_SWITCH);
+			ras = cur;
+			goto out_last;
+		}
+
+		if (!lru || cur->ras_access < lru->ras_access)
+			lru = cur;
+	}
+
+	if (rss->rss_count < rss->rss_max) {
+		lru = &rss->rss_streams[rss->rss_count];
+		lru->ras_stream = rss->rss_count++;
+	} else if (!lru) {
+		/* single stream, it is reset by the pattern detection */
+		goto out_unlock;
+	}
+
+	i = lru->ras_stream;
+	*lru = *ras;
+	lru->ras_stream = i;
+	ras = lru;
+	ll_ra_stats_inc_sbi(sbi, RA_STAT_STREAM_NEW);
+	CDEBUG(D_READA, "fork stream %u at %llu\n", i, pos);
+out_last:
+	rss->rss_last = ras;
+out_unlock:
+	ras->ras_access = rss->rss_clock;
+	spin_unlock(&rss->rss_lock);
+
+	return ras;
+}
+
 void ll_ras_enter(struct file *f, loff_t pos, size_t bytes)
 {
 	struct ll_file_data *lfd = f->private_data;
-	struct ll_readahead_state *ras = &lfd->fd_ras;
 	struct inode *inode = file_inode(f);
 	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_readahead_state *ras;
+
+	ras = ras_stream_get(sbi, lfd, pos, bytes, false);
 
-	spin_lock(&ras->ras_lock);
+	/*
+	 * The first read of a file a process looks up along a statahead
+	 * scan: it is likely to read the next files of the scan too. Only
+	 * look the parent up while some statahead is running on the mount.
+	 */
+	if (lfd->fd_ras_streams.rss_clock == 1 &&
+	    sbi->ll_ra_info.ra_xfile_count > 0 &&
+	    atomic_read(&sbi->ll_sa_running) > 0) {
+		struct dentry *parent = dget_parent(file_dentry(f));
+
+		ll_statahead_read_enter(parent->d_inode, inode);
+		dput(parent);
+	}
+
+	spin_lock(ras->ras_lock);
 	ras->ras_requests++;
 	ras->ras_consecutive_requests++;
 	ras->ras_need_increase_window = false;
@@ -1307,7 +1614,7 @@ void ll_ras_enter(struct file *f, loff_t pos, size_t bytes)
 	}
 	ras_detect_read_pattern(ras, sbi, pos, bytes, false);
 out_unlock:
-	spin_unlock(&ras->ras_lock);
+	spin_unlock(ras->ras_lock);
 }
 
 static bool index_in_stride_window(struct ll_readahead_state *ras,
@@ -1348,7 +1655,7 @@ static void ras_update(struct ll_sb_info *sbi, struct inode *inode,
 	bool hit = flags & LL_RAS_HIT;
 
 	ENTRY;
-	spin_lock(&ras->ras_lock);
+	spin_lock(ras->ras_lock);
 
 	RAS_CDEBUG(ras);
 
@@ -1356,6 +1663,13 @@ static void ras_update(struct ll_sb_info *sbi, struct inode *inode,
 		CDEBUG(D_READA|D_IOTRACE, DFID " pages at %lu miss.\n",
 		       PFID(ll_inode2fid(inode)), index);
 	ll_ra_stats_inc_sbi(sbi, hit ? RA_STAT_HIT : RA_STAT_MISS);
+	if (sbi->ll_ra_stream_stats)
+		lprocfs_counter_incr(sbi->ll_ra_stream_stats, hit ?
+				     RA_STREAM_STAT_HIT(ras->ras_stream) :
+				     RA_STREAM_STAT_MISS(ras->ras_stream));
+	if (test_bit(LLIF_XFILE_READAHEAD, &ll_i2info(inode)->lli_flags))
+		ll_ra_stats_inc_sbi(sbi, hit ? RA_STAT_XFILE_HIT :
+					       RA_STAT_XFILE_MISS);
 
 	/*
 	 * The readahead window has been expanded to cover whole
@@ -1475,7 +1789,7 @@ skip_miss_checking:
 	EXIT;
 out_unlock:
 	RAS_CDEBUG(ras);
-	spin_unlock(&ras->ras_lock);
+	spin_unlock(ras->ras_lock);
 }
 
 int ll_writepage(struct page *vmpage, struct writeback_control *wbc)
@@ -1719,7 +2033,9 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 
 	if (file) {
 		lfd = file->private_data;
-		ras = &lfd->fd_ras;
+		ras = ras_stream_get(sbi, lfd,
+				     (loff_t)cl_page_index(page) << PAGE_SHIFT,
+				     PAGE_SIZE, mmap);
 	}
 
 	/* PagePrivate2 is set in ll_io_zero_page() to tell us the vmpage
@@ -1837,13 +2153,13 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
  * 2 async readahead triggered and fast read could be used too.
  * < 0 on error.
  */
-static int kickoff_async_readahead(struct file *file, unsigned long pages)
+static int kickoff_async_readahead(struct file *file,
+				   struct ll_readahead_state *ras,
+				   unsigned long pages)
 {
 	struct ll_readahead_work *lrw;
 	struct inode *inode = file_inode(file);
 	struct ll_sb_info *sbi = ll_i2sbi(inode);
-	struct ll_file_data *lfd = file->private_data;
-	struct ll_readahead_state *ras = &lfd->fd_ras;
 	struct ll_ra_info *ra = &sbi->ll_ra_info;
 	unsigned long throttle;
 	pgoff_t start_idx = ras_align(ras, ras->ras_next_readahead_idx);
@@ -1884,10 +2200,11 @@ static int kickoff_async_readahead(struct file *file, unsigned long pages)
 		lrw->lrw_start_idx = start_idx;
 		lrw->lrw_end_idx = end_idx;
 		lrw->lrw_user_pid = current->pid;
-		spin_lock(&ras->ras_lock);
+		lrw->lrw_ras = ras;
+		spin_lock(ras->ras_lock);
 		ras->ras_next_readahead_idx = end_idx + 1;
 		ras->ras_async_last_readpage_idx = start_idx;
-		spin_unlock(&ras->ras_lock);
+		spin_unlock(ras->ras_lock);
 		lli_jobinfo_cpy(ll_i2info(inode), &lrw->lrw_jobinfo);
 
 		ll_readahead_work_add(inode, lrw);
@@ -1926,7 +2243,7 @@ static bool ll_use_fast_io(struct file *file,
 	if (ras->ras_whole_file_read ||
 	    ras->ras_window_start_idx + ras->ras_window_pages <
 	    ras->ras_next_readahead_idx + skip_pages ||
-	    kickoff_async_readahead(file, fast_read_pages) > 0) {
+	    kickoff_async_readahead(file, ras, fast_read_pages) > 0) {
 		return true;
 	}
 
@@ -2009,7 +2326,7 @@ int ll_readpage(struct file *file, struct page *vmpage)
 	if (io == NULL) { /* fast read */
 		struct inode *inode = file_inode(file);
 		struct ll_file_data *lfd = file->private_data;
-		struct ll_readahead_state *ras = &lfd->fd_ras;
+		struct ll_readahead_state *ras;
 		struct lu_env  *local_env = NULL;
 
 		CDEBUG(D_VFSTRACE, "fast read pgno: %ld\n", vmpage->index);
@@ -2034,6 +2351,10 @@ int ll_readpage(struct file *file, struct page *vmpage)
 			if (lcc && lcc->lcc_type == LCC_MMAP)
 				flags |= LL_RAS_MMAP;
 
+			ras = ras_stream_get(sbi, lfd,
+					     (loff_t)vmpage->index << PAGE_SHIFT,
+					     PAGE_SIZE, flags & LL_RAS_MMAP);
+
 			/* For fast read, it updates read ahead state only
 			 * if the page is hit in cache because non cache page
 			 * case will be handled by slow read later.
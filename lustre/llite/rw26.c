@@ -242,6 +242,51 @@ static int ll_releasepage(struct page *vmpage, RELEASEPAGE_ARG_TYPE gfp_mask)
 }
 #endif /* HAVE_AOPS_RELEASE_FOLIO */
 
+#if defined(HAVE_DIO_ITER)
+/*
+ * Pages of a bvec iterator (io_uring registered buffers, loop device...) stay
+ * pinned by the owner of the iterator until the I/O completes, which is what
+ * the block layer relies on too. Use them as they are instead of taking and
+ * dropping a reference on every page for every submission.
+ */
+static ssize_t ll_get_bvec_pages(struct iov_iter *iter,
+				 struct cl_dio_pages *cdp, size_t maxsize)
+{
+	const struct bio_vec *bvec = iter->bvec;
+	size_t skip = iter->iov_offset;
+	size_t npages;
+	size_t bytes = 0;
+	size_t i = 0;
+
+	maxsize = min(maxsize, iov_iter_count(iter));
+	npages = DIV_ROUND_UP(maxsize, PAGE_SIZE);
+	cdp->cdp_pages = kvmalloc_array(npages, sizeof(*cdp->cdp_pages),
+					GFP_NOFS);
+	if (!cdp->cdp_pages)
+		return -ENOMEM;
+
+	/* the caller checked that every segment is page aligned */
+	while (bytes < maxsize && i < npages) {
+		size_t off = bvec->bv_offset + skip;
+		size_t len = min_t(size_t, bvec->bv_len - skip,
+				   maxsize - bytes);
+		size_t done;
+
+		for (done = 0; done < len && i < npages; done += PAGE_SIZE)
+			cdp->cdp_pages[i++] = nth_page(bvec->bv_page,
+						       (off + done) >>
+						       PAGE_SHIFT);
+		bytes += len;
+		skip = 0;
+		bvec++;
+	}
+	cdp->cdp_count = i;
+	cdp->cdp_bvec = 1;
+
+	return bytes;
+}
+#endif
+
 static ssize_t ll_get_user_pages(int rw, struct iov_iter *iter,
 				struct cl_dio_pages *cdp,
 				size_t maxsize)
@@ -250,6 +295,9 @@ static ssize_t ll_get_user_pages(int rw, struct iov_iter *iter,
 	size_t start;
 	size_t result;
 
+	if (iov_iter_is_bvec(iter))
+		return ll_get_bvec_pages(iter, cdp, maxsize);
+
 	result = iov_iter_get_pages_alloc2(iter, &cdp->cdp_pages, maxsize,
 					  &start);
 	if (result > 0) {
@@ -611,6 +659,10 @@ ll_direct_IO_impl(struct kiocb *iocb, struct iov_iter *iter, int rw)
 			result = ll_get_user_pages(rw, iter, cdp, count);
 			/* ll_get_user_pages returns bytes in the IO or error*/
 			count = result;
+			if (cdp->cdp_bvec && result > 0)
+				ll_stats_ops_tally(ll_i2sbi(inode),
+						   LPROC_LL_DIO_BVEC_BYTES,
+						   result);
 		} else {
 			/* explictly handle the ubuf() case for el9.4 */
 			size_t len = iter_is_ubuf(iter) ? iov_iter_count(iter)
@@ -1250,6 +1250,7 @@ static int ll_statahead_by_list(struct ll_statahead_info *sai,
 			int namelen;
 			char *name;
 			struct lu_fid fid;
+			struct luda_attrs *lat;
 			struct llcrypt_str lltr = LLTR_INIT(NULL, 0);
 
 			hash = le64_to_cpu(ent->lde_hash);
@@ -1295,6 +1296,10 @@ static int ll_statahead_by_list(struct ll_statahead_info *sai,
 
 			fid_le_to_cpu(&fid, &ent->lde_fid);
 
+			lat = lu_dirent_attrs_get(ent);
+			if (lat)
+				ll_dirent_attrs_update(dir->i_sb, &fid, lat);
+
 			while (({set_current_state(TASK_IDLE);
 				 /* matches smp_store_release() in
 				  * ll_deauthorize_statahead()
@@ -2787,3 +2792,62 @@ void ll_statahead_enter(struct inode *dir, struct dentry *dchild)
 		lli->lli_sa_match_count = 0;
 	}
 }
+
+/*
+ * Cross-file read-ahead: @inode is read by a process which scans its
+ * parent directory @dir with statahead, i.e. whose lookups matched one of
+ * the statahead patterns. The process is then likely to read the next
+ * files of the scan as well, so prefetch the data of the next
+ * read_ahead_cross_files regular files statahead has instantiated already.
+ */
+void ll_statahead_read_enter(struct inode *dir, struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct inode *next[LL_RA_XFILE_MAX];
+	struct ll_statahead_info *sai;
+	struct sa_entry *entry;
+	unsigned int max;
+	unsigned int nr = 0;
+	unsigned int i = 0;
+
+	max = min_t(unsigned int, sbi->ll_ra_info.ra_xfile_count,
+		    LL_RA_XFILE_MAX);
+	if (max == 0 || !lli->lli_sax)
+		return;
+
+	spin_lock(&lli->lli_sa_lock);
+	if (!lli->lli_sax)
+		goto out_unlock;
+
+	sai = ll_find_sai_locked(lli->lli_sax, current->pid);
+	if (!sai)
+		goto out_unlock;
+
+	list_for_each_entry(entry, &sai->sai_entries, se_list) {
+		struct inode *child = entry->se_inode;
+
+		if (entry->se_state != SA_ENTRY_SUCC || !child ||
+		    child == inode || !S_ISREG(child->i_mode))
+			continue;
+
+		if (i++ >= max)
+			break;
+
+		if (test_and_set_bit(LLIF_XFILE_READAHEAD,
+				     &ll_i2info(child)->lli_flags))
+			continue;
+
+		next[nr] = igrab(child);
+		if (next[nr])
+			nr++;
+		else
+			clear_bit(LLIF_XFILE_READAHEAD,
+				  &ll_i2info(child)->lli_flags);
+	}
+out_unlock:
+	spin_unlock(&lli->lli_sa_lock);
+
+	for (i = 0; i < nr; i++)
+		ll_readahead_inode(next[i]);
+}
@@ -546,6 +546,27 @@ static void vvp_io_update_iov(const struct lu_env *env,
 	iov_iter_truncate(vio->vui_iter, size);
 }
 
+/*
+ * Buffered IO may ask the OST to refuse the lock on a contended extent
+ * instead of revoking it from other clients, if it can then be redone as
+ * hybrid direct IO, which is locked on the server side.
+ */
+static bool vvp_io_may_deny_on_contention(struct cl_io *io, int flags)
+{
+	struct inode *inode = vvp_object_inode(io->ci_obj);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+
+	if (!test_bit(LL_SBI_HYBRID_IO, sbi->ll_flags) ||
+	    sbi->ll_contention_seconds == 0)
+		return false;
+
+	if (io->ci_lockreq != CILR_MAYBE || io->ci_dio_lock ||
+	    io->ci_no_srvlock)
+		return false;
+
+	return !iocb_ki_flags_check(flags, DIRECT);
+}
+
 static int vvp_io_rw_lock(const struct lu_env *env, struct cl_io *io,
 			  enum cl_lock_mode mode, loff_t start, loff_t end)
 {
@@ -575,6 +596,8 @@ static int vvp_io_rw_lock(const struct lu_env *env, struct cl_io *io,
 		    (iocb_ki_flags_check(flags, DIRECT) &&
 		     !io->ci_dio_lock))
 			ast_flags |= CEF_NEVER;
+		else if (vvp_io_may_deny_on_contention(io, flags))
+			ast_flags |= CEF_DENY_ON_CONTENTION;
 	}
 
 	result = vvp_mmap_locks(env, vio, io);
@@ -818,7 +841,8 @@ static int vvp_io_read_start(const struct lu_env *env,
 	struct cl_object *obj = io->ci_obj;
 	struct inode *inode = vvp_object_inode(obj);
 	struct ll_inode_info *lli = ll_i2info(inode);
-	struct file *file = vio->vui_fd->fd_file;
+	/* cross-file read-ahead has no file */
+	struct file *file = vio->vui_fd ? vio->vui_fd->fd_file : NULL;
 	loff_t pos = io->u.ci_rd.rd.crw_pos;
 	size_t crw_bytes = io->u.ci_rd.rd.crw_bytes;
 	size_t tot_bytes = vio->vui_tot_bytes;
@@ -835,17 +859,18 @@ static int vvp_io_read_start(const struct lu_env *env,
 
 	CLOBINVRNT(env, obj, vvp_object_invariant(obj));
 
-	CDEBUG(D_VFSTRACE, "%s: read [%llu, %llu)\n",
-		file_dentry(file)->d_name.name,
-		pos, pos + crw_bytes);
-
 	trunc_sem_down_read(&lli->lli_trunc_sem);
 
 	if (io->ci_async_readahead) {
-		file_accessed(file);
+		if (file)
+			file_accessed(file);
 		RETURN(0);
 	}
 
+	CDEBUG(D_VFSTRACE, "%s: read [%llu, %llu)\n",
+		file_dentry(file)->d_name.name,
+		pos, pos + crw_bytes);
+
 	if (!can_populate_pages(env, io, inode))
 		RETURN(0);
 
@@ -1739,7 +1764,9 @@ static int vvp_io_read_ahead(const struct lu_env *env,
 	    ios->cis_io->ci_type == CIT_FAULT) {
 		struct vvp_io *vio = cl2vvp_io(env, ios);
 
-		if (unlikely(vio->vui_fd->fd_flags & LL_FILE_GROUP_LOCKED)) {
+		/* cross-file read-ahead has no file */
+		if (unlikely(vio->vui_fd &&
+			     vio->vui_fd->fd_flags & LL_FILE_GROUP_LOCKED)) {
 			ra->cra_end_idx = CL_PAGE_EOF;
 			result = 1; /* no need to call down */
 		}
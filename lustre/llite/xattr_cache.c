@@ -39,43 +39,229 @@
 #include <lustre_dlm.h>
 #include "llite_internal.h"
 
-/* If we ever have hundreds of extended attributes, we might want to consider
- * using a hash or a tree structure instead of list for faster lookups.
+/*
+ * All cached xattrs of an inode live in a single allocation: a header, an
+ * array of entries chained in hash buckets by name, the bucket heads, then
+ * the names and values. A blob is never modified in place, any change
+ * builds a new one. Changes are rare, they happen when the cache is
+ * refilled or when one xattr is inserted after a lookup.
+ *
+ * The blobs of a mount are kept on an LRU list and the memory they use is
+ * capped by ll_xattr_cache_max_bytes.
  */
 struct ll_xattr_entry {
-	struct list_head xe_list; /* protected by lli_xattrs_list_rwsem */
-	char *xe_name;            /* xattr name, \0-terminated */
-	char *xe_value;           /* xattr value */
-	unsigned int xe_namelen;  /* strlen(xe_name) + 1 */
-	unsigned int xe_vallen;   /* xattr value length */
+	u32			 xe_hash;	/* hash of the name */
+	u32			 xe_next;	/* next entry of the bucket */
+	u32			 xe_namelen;	/* strlen(name) + 1 */
+	u32			 xe_vallen;	/* xattr value length */
+	u32			 xe_offset;	/* name in xb_data, value follows */
 };
 
-static struct kmem_cache *xattr_kmem;
-static struct lu_kmem_descr xattr_caches[] = {
-	{
-		.ckd_cache = &xattr_kmem,
-		.ckd_name  = "xattr_kmem",
-		.ckd_size  = sizeof(struct ll_xattr_entry)
-	},
-	{
-		.ckd_cache = NULL
-	}
+#define XE_NONE		(~0U)
+
+struct ll_xattr_blob {
+	/* on ll_sb_info::ll_xattr_lru, protected by ll_xattr_lru_lock */
+	struct list_head	 xb_lru;
+	struct ll_inode_info	*xb_lli;
+	size_t			 xb_size;	/* bytes allocated */
+	unsigned int		 xb_count;	/* entries in use */
+	unsigned int		 xb_nbuckets;	/* power of two */
+	/* looked up since the last LRU scan */
+	unsigned int		 xb_referenced;
+	u32			*xb_buckets;
+	char			*xb_data;
+	struct ll_xattr_entry	 xb_entries[];
+};
+
+/* one xattr to put into a new blob */
+struct ll_xattr_src {
+	const char		*xs_name;
+	const char		*xs_value;
+	u32			 xs_namelen;
+	u32			 xs_vallen;
 };
 
-int ll_xattr_init(void)
+/* blobs looked at per ll_xattr_cache_shrink() call */
+#define LL_XATTR_SHRINK_SCAN	256
+
+static inline const char *xe_name(const struct ll_xattr_blob *xb,
+				  const struct ll_xattr_entry *xe)
+{
+	return xb->xb_data + xe->xe_offset;
+}
+
+static inline const char *xe_value(const struct ll_xattr_blob *xb,
+				   const struct ll_xattr_entry *xe)
+{
+	return xb->xb_data + xe->xe_offset + xe->xe_namelen;
+}
+
+static u32 ll_xattr_hash(const char *name, u32 namelen)
+{
+	return ll_full_name_hash(NULL, name, namelen - 1);
+}
+
+static struct ll_xattr_entry *
+ll_xattr_blob_lookup(const struct ll_xattr_blob *xb, const char *name,
+		     u32 namelen, u32 hash)
+{
+	struct ll_xattr_entry *xe;
+	u32 i;
+
+	for (i = xb->xb_buckets[hash & (xb->xb_nbuckets - 1)]; i != XE_NONE;
+	     i = xe->xe_next) {
+		xe = (struct ll_xattr_entry *)&xb->xb_entries[i];
+		if (xe->xe_hash == hash && xe->xe_namelen == namelen &&
+		    memcmp(xe_name(xb, xe), name, namelen) == 0)
+			return xe;
+	}
+
+	return NULL;
+}
+
+/**
+ * Build a blob holding the \a count xattrs of \a src.
+ *
+ * A name given twice is a protocol error, except for the encryption
+ * context which cannot change: the first copy is kept.
+ *
+ * \retval new blob
+ * \retval ERR_PTR(-EPROTO) duplicate xattr
+ * \retval ERR_PTR(-ENOMEM) no memory for the blob
+ */
+static struct ll_xattr_blob *ll_xattr_blob_build(const struct ll_xattr_src *src,
+						 unsigned int count)
+{
+	struct ll_xattr_blob *xb;
+	unsigned int nbuckets;
+	size_t datalen = 0;
+	size_t size;
+	u32 offset = 0;
+	unsigned int i;
+
+	ENTRY;
+
+	for (i = 0; i < count; i++)
+		datalen += src[i].xs_namelen + src[i].xs_vallen;
+
+	nbuckets = roundup_pow_of_two(max(count, 1U));
+	size = sizeof(*xb) + count * sizeof(xb->xb_entries[0]) +
+	       nbuckets * sizeof(xb->xb_buckets[0]) + datalen;
+
+	OBD_ALLOC_LARGE(xb, size);
+	if (!xb) {
+		CDEBUG(D_CACHE, "failed to allocate xattr blob %zu\n", size);
+		RETURN(ERR_PTR(-ENOMEM));
+	}
+
+	INIT_LIST_HEAD(&xb->xb_lru);
+	xb->xb_size = size;
+	xb->xb_nbuckets = nbuckets;
+	xb->xb_buckets = (u32 *)&xb->xb_entries[count];
+	xb->xb_data = (char *)&xb->xb_buckets[nbuckets];
+	memset(xb->xb_buckets, 0xff, nbuckets * sizeof(xb->xb_buckets[0]));
+
+	for (i = 0; i < count; i++) {
+		const struct ll_xattr_src *xs = &src[i];
+		struct ll_xattr_entry *xe;
+		u32 hash = ll_xattr_hash(xs->xs_name, xs->xs_namelen);
+		u32 bucket = hash & (nbuckets - 1);
+
+		if (ll_xattr_blob_lookup(xb, xs->xs_name, xs->xs_namelen,
+					 hash)) {
+			if (!strcmp(xs->xs_name,
+				    LL_XATTR_NAME_ENCRYPTION_CONTEXT) ||
+			    !strcmp(xs->xs_name,
+				    LL_XATTR_NAME_ENCRYPTION_CONTEXT_OLD))
+				/* it means enc ctx was already in cache,
+				 * ignore error as it cannot be modified
+				 */
+				continue;
+
+			CDEBUG(D_CACHE, "duplicate xattr: [%s]\n",
+			       xs->xs_name);
+			OBD_FREE_LARGE(xb, size);
+			RETURN(ERR_PTR(-EPROTO));
+		}
+
+		xe = &xb->xb_entries[xb->xb_count];
+		xe->xe_hash = hash;
+		xe->xe_namelen = xs->xs_namelen;
+		xe->xe_vallen = xs->xs_vallen;
+		xe->xe_offset = offset;
+		memcpy(xb->xb_data + offset, xs->xs_name, xs->xs_namelen);
+		offset += xs->xs_namelen;
+		memcpy(xb->xb_data + offset, xs->xs_value, xs->xs_vallen);
+		offset += xs->xs_vallen;
+
+		xe->xe_next = xb->xb_buckets[bucket];
+		xb->xb_buckets[bucket] = xb->xb_count++;
+
+		CDEBUG(D_CACHE, "set: [%s]=%.*s\n", xs->xs_name,
+		       xs->xs_vallen, xs->xs_value);
+	}
+
+	RETURN(xb);
+}
+
+/* describe the xattrs of \a xb, or only \a only, as sources of a new blob */
+static unsigned int ll_xattr_blob_src(const struct ll_xattr_blob *xb,
+				      const char *only,
+				      struct ll_xattr_src *src)
 {
-	return lu_kmem_init(xattr_caches);
+	unsigned int count = 0;
+	unsigned int i;
+
+	if (!xb)
+		return 0;
+
+	for (i = 0; i < xb->xb_count; i++) {
+		const struct ll_xattr_entry *xe = &xb->xb_entries[i];
+
+		if (only && strcmp(xe_name(xb, xe), only) != 0)
+			continue;
+
+		src[count].xs_name = xe_name(xb, xe);
+		src[count].xs_value = xe_value(xb, xe);
+		src[count].xs_namelen = xe->xe_namelen;
+		src[count].xs_vallen = xe->xe_vallen;
+		count++;
+	}
+
+	return count;
 }
 
-void ll_xattr_fini(void)
+/*
+ * Replace the blob of @lli with @xb, which may be NULL.
+ * Called with lli_xattrs_list_rwsem held for write.
+ */
+static void ll_xattr_blob_set(struct ll_inode_info *lli,
+			      struct ll_xattr_blob *xb)
 {
-	lu_kmem_fini(xattr_caches);
+	struct ll_sb_info *sbi = ll_i2sbi(ll_info2i(lli));
+	struct ll_xattr_blob *old = lli->lli_xattrs;
+
+	spin_lock(&sbi->ll_xattr_lru_lock);
+	if (old) {
+		list_del(&old->xb_lru);
+		sbi->ll_xattr_cache_bytes -= old->xb_size;
+	}
+	if (xb) {
+		xb->xb_lli = lli;
+		list_add_tail(&xb->xb_lru, &sbi->ll_xattr_lru);
+		sbi->ll_xattr_cache_bytes += xb->xb_size;
+	}
+	spin_unlock(&sbi->ll_xattr_lru_lock);
+
+	lli->lli_xattrs = xb;
+	if (old)
+		OBD_FREE_LARGE(old, old->xb_size);
 }
 
 /*
  * Initializes xattr cache for an inode.
  *
- * This initializes the xattr list and marks cache presence.
+ * This marks cache presence, the cache is empty.
  */
 static void ll_xattr_cache_init(struct ll_inode_info *lli)
 {
@@ -83,168 +269,119 @@ static void ll_xattr_cache_init(struct ll_inode_info *lli)
 
 	LASSERT(lli != NULL);
 
-	INIT_LIST_HEAD(&lli->lli_xattrs);
+	LASSERT(lli->lli_xattrs == NULL);
 	set_bit(LLIF_XATTR_CACHE, &lli->lli_flags);
 }
 
 /**
  *  This looks for a specific extended attribute.
  *
- *  Find in @cache and return @xattr_name attribute in @xattr,
- *  for the NULL @xattr_name return the first cached @xattr.
+ *  Find in @xb and return @xattr_name attribute in @xattr.
  *
  *  \retval 0        success
  *  \retval -ENODATA if not found
  */
-static int ll_xattr_cache_find(struct list_head *cache,
+static int ll_xattr_cache_find(struct ll_xattr_blob *xb,
 			       const char *xattr_name,
 			       struct ll_xattr_entry **xattr)
 {
 	struct ll_xattr_entry *entry;
+	u32 namelen;
 
 	ENTRY;
 
-	list_for_each_entry(entry, cache, xe_list) {
-		/* xattr_name == NULL means look for any entry */
-		if (xattr_name == NULL ||
-		    strcmp(xattr_name, entry->xe_name) == 0) {
-			*xattr = entry;
-			CDEBUG(D_CACHE, "find: [%s]=%.*s\n",
-			       entry->xe_name, entry->xe_vallen,
-			       entry->xe_value);
-			RETURN(0);
-		}
-	}
+	if (!xb)
+		RETURN(-ENODATA);
 
-	RETURN(-ENODATA);
+	namelen = strlen(xattr_name) + 1;
+	entry = ll_xattr_blob_lookup(xb, xattr_name, namelen,
+				     ll_xattr_hash(xattr_name, namelen));
+	if (!entry)
+		RETURN(-ENODATA);
+
+	*xattr = entry;
+	CDEBUG(D_CACHE, "find: [%s]=%.*s\n", xattr_name, entry->xe_vallen,
+	       xe_value(xb, entry));
+	RETURN(0);
 }
 
 /**
  * This adds an xattr.
  *
- * Add @xattr_name attr with @xattr_val value and @xattr_val_len length,
+ * Add @xattr_name attr with @xattr_val value and @xattr_val_len length
+ * to the cache of @lli.
  *
  * \retval 0       success
  * \retval -ENOMEM if no memory could be allocated for the cached attr
  * \retval -EPROTO if duplicate xattr is being added
  */
-static int ll_xattr_cache_add(struct list_head *cache,
+static int ll_xattr_cache_add(struct ll_inode_info *lli,
 			      const char *xattr_name,
 			      const char *xattr_val,
 			      unsigned int xattr_val_len)
 {
-	struct ll_xattr_entry *xattr;
+	struct ll_xattr_blob *old = lli->lli_xattrs;
+	struct ll_xattr_blob *xb;
+	struct ll_xattr_src *src;
+	unsigned int count;
 
 	ENTRY;
 
-	if (ll_xattr_cache_find(cache, xattr_name, &xattr) == 0) {
-		if (!strcmp(xattr_name, LL_XATTR_NAME_ENCRYPTION_CONTEXT) ||
-		    !strcmp(xattr_name, LL_XATTR_NAME_ENCRYPTION_CONTEXT_OLD))
-			/* it means enc ctx was already in cache,
-			 * ignore error as it cannot be modified
-			 */
-			RETURN(0);
-
-		CDEBUG(D_CACHE, "duplicate xattr: [%s]\n", xattr_name);
-		RETURN(-EPROTO);
-	}
-
-	OBD_SLAB_ALLOC_PTR_GFP(xattr, xattr_kmem, GFP_NOFS);
-	if (xattr == NULL) {
-		CDEBUG(D_CACHE, "failed to allocate xattr\n");
+	OBD_ALLOC_PTR_ARRAY_LARGE(src, (old ? old->xb_count : 0) + 1);
+	if (!src)
 		RETURN(-ENOMEM);
-	}
 
-	xattr->xe_namelen = strlen(xattr_name) + 1;
-
-	OBD_ALLOC(xattr->xe_name, xattr->xe_namelen);
-	if (!xattr->xe_name) {
-		CDEBUG(D_CACHE, "failed to alloc xattr name %u\n",
-		       xattr->xe_namelen);
-		goto err_name;
-	}
-	OBD_ALLOC(xattr->xe_value, xattr_val_len);
-	if (!xattr->xe_value) {
-		CDEBUG(D_CACHE, "failed to alloc xattr value %d\n",
-		       xattr_val_len);
-		goto err_value;
-	}
+	count = ll_xattr_blob_src(old, NULL, src);
+	src[count].xs_name = xattr_name;
+	src[count].xs_value = xattr_val;
+	src[count].xs_namelen = strlen(xattr_name) + 1;
+	src[count].xs_vallen = xattr_val_len;
 
-	memcpy(xattr->xe_name, xattr_name, xattr->xe_namelen);
-	memcpy(xattr->xe_value, xattr_val, xattr_val_len);
-	xattr->xe_vallen = xattr_val_len;
-	list_add(&xattr->xe_list, cache);
+	xb = ll_xattr_blob_build(src, count + 1);
+	OBD_FREE_PTR_ARRAY_LARGE(src, (old ? old->xb_count : 0) + 1);
+	if (IS_ERR(xb))
+		RETURN(PTR_ERR(xb));
 
-	CDEBUG(D_CACHE, "set: [%s]=%.*s\n", xattr_name,
-		xattr_val_len, xattr_val);
+	/* nothing new, the enc ctx was cached already */
+	if (xb->xb_count == count)
+		OBD_FREE_LARGE(xb, xb->xb_size);
+	else
+		ll_xattr_blob_set(lli, xb);
 
 	RETURN(0);
-err_value:
-	OBD_FREE(xattr->xe_name, xattr->xe_namelen);
-err_name:
-	OBD_SLAB_FREE_PTR(xattr, xattr_kmem);
-
-	RETURN(-ENOMEM);
-}
-
-/**
- * This removes an extended attribute from cache.
- *
- * Remove @xattr_name attribute from @cache.
- *
- * \retval 0        success
- * \retval -ENODATA if @xattr_name is not cached
- */
-static int ll_xattr_cache_del(struct list_head *cache,
-			      const char *xattr_name)
-{
-	struct ll_xattr_entry *xattr;
-
-	ENTRY;
-
-	CDEBUG(D_CACHE, "del xattr: %s\n", xattr_name);
-
-	if (ll_xattr_cache_find(cache, xattr_name, &xattr) == 0) {
-		list_del(&xattr->xe_list);
-		OBD_FREE(xattr->xe_name, xattr->xe_namelen);
-		OBD_FREE(xattr->xe_value, xattr->xe_vallen);
-		OBD_SLAB_FREE_PTR(xattr, xattr_kmem);
-
-		RETURN(0);
-	}
-
-	RETURN(-ENODATA);
 }
 
 /**
  * This iterates cached extended attributes.
  *
- * Walk over cached attributes in @cache and
+ * Walk over cached attributes in @xb and
  * fill in @xld_buffer or only calculate buffer
  * size if @xld_buffer is NULL.
  *
  * \retval >= 0     buffer list size
  * \retval -ENODATA if the list cannot fit @xld_size buffer
  */
-static int ll_xattr_cache_list(struct list_head *cache,
+static int ll_xattr_cache_list(struct ll_xattr_blob *xb,
 			       char *xld_buffer,
 			       int xld_size)
 {
-	struct ll_xattr_entry *xattr, *tmp;
 	int xld_tail = 0;
+	unsigned int i;
 
 	ENTRY;
 
-	list_for_each_entry_safe(xattr, tmp, cache, xe_list) {
+	for (i = 0; xb && i < xb->xb_count; i++) {
+		struct ll_xattr_entry *xattr = &xb->xb_entries[i];
+
 		CDEBUG(D_CACHE, "list: buffer=%p[%d] name=%s\n",
-			xld_buffer, xld_tail, xattr->xe_name);
+			xld_buffer, xld_tail, xe_name(xb, xattr));
 
 		if (xld_buffer) {
 			xld_size -= xattr->xe_namelen;
 			if (xld_size < 0)
 				break;
 			memcpy(&xld_buffer[xld_tail],
-			       xattr->xe_name, xattr->xe_namelen);
+			       xe_name(xb, xattr), xattr->xe_namelen);
 		}
 		xld_tail += xattr->xe_namelen;
 	}
@@ -291,8 +428,7 @@ static int ll_xattr_cache_destroy_locked(struct ll_inode_info *lli)
 	if (!ll_xattr_cache_valid(lli))
 		RETURN(0);
 
-	while (ll_xattr_cache_del(&lli->lli_xattrs, NULL) == 0)
-		; /* empty loop */
+	ll_xattr_blob_set(lli, NULL);
 
 	clear_bit(LLIF_XATTR_CACHE_FILLED, &lli->lli_flags);
 	clear_bit(LLIF_XATTR_CACHE, &lli->lli_flags);
@@ -314,6 +450,36 @@ int ll_xattr_cache_destroy(struct inode *inode)
 	RETURN(rc);
 }
 
+static void ll_xattr_cache_empty_locked(struct ll_inode_info *lli)
+{
+	struct inode *inode = ll_info2i(lli);
+	struct ll_xattr_blob *xb = NULL;
+	struct ll_xattr_src src;
+
+	ENTRY;
+
+	if (!ll_xattr_cache_valid(lli) ||
+	    !ll_xattr_cache_filled(lli))
+		RETURN_EXIT;
+
+	/* keep the encryption context, if it fails to fit into a new blob
+	 * it is fetched again from the MDT
+	 */
+	if (ll_xattr_blob_src(lli->lli_xattrs, xattr_for_enc(inode), &src)) {
+		xb = ll_xattr_blob_build(&src, 1);
+		if (IS_ERR(xb))
+			xb = NULL;
+	}
+
+	CDEBUG(D_CACHE, "delete: %u xattrs of "DFID"\n",
+	       lli->lli_xattrs ? lli->lli_xattrs->xb_count : 0,
+	       PFID(ll_inode2fid(inode)));
+	ll_xattr_blob_set(lli, xb);
+	clear_bit(LLIF_XATTR_CACHE_FILLED, &lli->lli_flags);
+
+	EXIT;
+}
+
 /*
  * ll_xattr_cache_empty - empty xattr cache for @ino
  *
@@ -323,30 +489,60 @@ int ll_xattr_cache_destroy(struct inode *inode)
 int ll_xattr_cache_empty(struct inode *inode)
 {
 	struct ll_inode_info *lli = ll_i2info(inode);
-	struct ll_xattr_entry *entry, *n;
 
 	ENTRY;
 
 	down_write(&lli->lli_xattrs_list_rwsem);
-	if (!ll_xattr_cache_valid(lli) ||
-	    !ll_xattr_cache_filled(lli))
-		GOTO(out_empty, 0);
+	ll_xattr_cache_empty_locked(lli);
+	up_write(&lli->lli_xattrs_list_rwsem);
 
-	list_for_each_entry_safe(entry, n, &lli->lli_xattrs, xe_list) {
-		if (strcmp(entry->xe_name, xattr_for_enc(inode)) == 0)
+	RETURN(0);
+}
+
+/*
+ * Empty the caches of the least recently used inodes of the mount until the
+ * memory cap is met. An inode which has been looked up since the last scan
+ * gets a second chance, and one busy with its cache is skipped.
+ */
+static void ll_xattr_cache_shrink(struct ll_sb_info *sbi)
+{
+	struct ll_xattr_blob *xb;
+	struct ll_inode_info *lli;
+	unsigned int scan;
+
+	spin_lock(&sbi->ll_xattr_lru_lock);
+	for (scan = 0; scan < LL_XATTR_SHRINK_SCAN &&
+	     sbi->ll_xattr_cache_bytes > sbi->ll_xattr_cache_max_bytes &&
+	     !list_empty(&sbi->ll_xattr_lru); scan++) {
+		xb = list_first_entry(&sbi->ll_xattr_lru, struct ll_xattr_blob,
+				      xb_lru);
+		lli = xb->xb_lli;
+		if (xb->xb_referenced) {
+			xb->xb_referenced = 0;
+			list_move_tail(&xb->xb_lru, &sbi->ll_xattr_lru);
 			continue;
+		}
 
-		CDEBUG(D_CACHE, "delete: %s\n", entry->xe_name);
-		list_del(&entry->xe_list);
-		OBD_FREE(entry->xe_name, entry->xe_namelen);
-		OBD_FREE(entry->xe_value, entry->xe_vallen);
-		OBD_SLAB_FREE_PTR(entry, xattr_kmem);
-	}
-	clear_bit(LLIF_XATTR_CACHE_FILLED, &lli->lli_flags);
+		/* the blob cannot be freed while it is on the LRU, nor the
+		 * inode while its cache is locked
+		 */
+		if (!down_write_trylock(&lli->lli_xattrs_list_rwsem)) {
+			list_move_tail(&xb->xb_lru, &sbi->ll_xattr_lru);
+			continue;
+		}
+		if (!ll_xattr_cache_filled(lli)) {
+			up_write(&lli->lli_xattrs_list_rwsem);
+			list_move_tail(&xb->xb_lru, &sbi->ll_xattr_lru);
+			continue;
+		}
+		spin_unlock(&sbi->ll_xattr_lru_lock);
 
-out_empty:
-	up_write(&lli->lli_xattrs_list_rwsem);
-	RETURN(0);
+		ll_xattr_cache_empty_locked(lli);
+		up_write(&lli->lli_xattrs_list_rwsem);
+
+		spin_lock(&sbi->ll_xattr_lru_lock);
+	}
+	spin_unlock(&sbi->ll_xattr_lru_lock);
 }
 
 /**
@@ -439,7 +635,11 @@ static int ll_xattr_cache_refill(struct inode *inode)
 	struct ptlrpc_request *req = NULL;
 	const char *xdata, *xval, *xtail, *xvtail;
 	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_xattr_src *src;
+	struct ll_xattr_blob *xb;
 	struct mdt_body *body;
+	unsigned int count;
+	unsigned int nsrc;
 	__u32 *xsizes;
 	int rc = 0, i;
 
@@ -491,6 +691,16 @@ static int ll_xattr_cache_refill(struct inode *inode)
 	if (!ll_xattr_cache_valid(lli))
 		ll_xattr_cache_init(lli);
 
+	/* the xattrs already cached come first, see ll_xattr_blob_build() */
+	nsrc = body->mbo_max_mdsize +
+	       (lli->lli_xattrs ? lli->lli_xattrs->xb_count : 0);
+	OBD_ALLOC_PTR_ARRAY_LARGE(src, nsrc);
+	if (!src) {
+		ll_xattr_cache_destroy_locked(lli);
+		GOTO(err_cancel, rc = -ENOMEM);
+	}
+	count = ll_xattr_blob_src(lli->lli_xattrs, NULL, src);
+
 	for (i = 0; i < body->mbo_max_mdsize; i++) {
 		CDEBUG(D_CACHE, "caching [%s]=%.*s\n", xdata, *xsizes, xval);
 		/* Perform consistency checks: attr names and vals in pill */
@@ -516,18 +726,33 @@ static int ll_xattr_cache_refill(struct inode *inode)
 			CDEBUG(D_CACHE, "not caching trusted.som\n");
 			rc = 0;
 		} else {
-			rc = ll_xattr_cache_add(&lli->lli_xattrs, xdata, xval,
-						*xsizes);
-		}
-		if (rc < 0) {
-			ll_xattr_cache_destroy_locked(lli);
-			GOTO(err_cancel, rc);
+			src[count].xs_name = xdata;
+			src[count].xs_value = xval;
+			src[count].xs_namelen = strlen(xdata) + 1;
+			src[count].xs_vallen = *xsizes;
+			count++;
+			rc = 0;
 		}
+		if (rc < 0)
+			break;
 		xdata += strlen(xdata) + 1;
 		xval  += *xsizes;
 		xsizes++;
 	}
 
+	if (rc == 0) {
+		xb = ll_xattr_blob_build(src, count);
+		if (IS_ERR(xb))
+			rc = PTR_ERR(xb);
+		else
+			ll_xattr_blob_set(lli, xb);
+	}
+	OBD_FREE_PTR_ARRAY_LARGE(src, nsrc);
+	if (rc < 0) {
+		ll_xattr_cache_destroy_locked(lli);
+		GOTO(err_cancel, rc);
+	}
+
 	if (xdata != xtail || xval != xvtail)
 		CERROR("a hole in xattr data\n");
 	else
@@ -574,6 +799,7 @@ int ll_xattr_cache_get(struct inode *inode,
 			__u64 valid)
 {
 	struct ll_inode_info *lli = ll_i2info(inode);
+	bool refilled = false;
 	int rc = 0;
 
 	ENTRY;
@@ -595,8 +821,11 @@ int ll_xattr_cache_get(struct inode *inode,
 		 * into a read lock.
 		 */
 		downgrade_write(&lli->lli_xattrs_list_rwsem);
+		refilled = true;
 	} else {
 		ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_GETXATTR_HITS, 1);
+		if (lli->lli_xattrs)
+			WRITE_ONCE(lli->lli_xattrs->xb_referenced, 1);
 	}
 
 	if (!ll_xattr_cache_valid(lli))
@@ -605,14 +834,15 @@ int ll_xattr_cache_get(struct inode *inode,
 	if (valid & OBD_MD_FLXATTR) {
 		struct ll_xattr_entry *xattr;
 
-		rc = ll_xattr_cache_find(&lli->lli_xattrs, name, &xattr);
+		rc = ll_xattr_cache_find(lli->lli_xattrs, name, &xattr);
 		if (rc == 0) {
 			rc = xattr->xe_vallen;
 			/* zero size means we are only requested size in rc */
 			if (size != 0) {
 				if (size >= xattr->xe_vallen)
-					memcpy(buffer, xattr->xe_value,
-						xattr->xe_vallen);
+					memcpy(buffer,
+					       xe_value(lli->lli_xattrs, xattr),
+					       xattr->xe_vallen);
 				else
 					rc = -ERANGE;
 			}
@@ -633,13 +863,15 @@ int ll_xattr_cache_get(struct inode *inode,
 			}
 		}
 	} else if (valid & OBD_MD_FLXATTRLS) {
-		rc = ll_xattr_cache_list(&lli->lli_xattrs,
+		rc = ll_xattr_cache_list(lli->lli_xattrs,
 					 size ? buffer : NULL, size);
 	}
 
 	GOTO(out, rc);
 out:
 	up_read(&lli->lli_xattrs_list_rwsem);
+	if (refilled)
+		ll_xattr_cache_shrink(ll_i2sbi(inode));
 
 	RETURN(rc);
 }
@@ -667,7 +899,9 @@ int ll_xattr_cache_insert(struct inode *inode,
 	down_write(&lli->lli_xattrs_list_rwsem);
 	if (!ll_xattr_cache_valid(lli))
 		ll_xattr_cache_init(lli);
-	rc = ll_xattr_cache_add(&lli->lli_xattrs, name, buffer, size);
+	rc = ll_xattr_cache_add(lli, name, buffer, size);
 	up_write(&lli->lli_xattrs_list_rwsem);
+	if (rc == 0)
+		ll_xattr_cache_shrink(ll_i2sbi(inode));
 	RETURN(rc);
 }
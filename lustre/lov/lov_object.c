@@ -2261,8 +2261,13 @@ static int lov_object_layout_get(const struct lu_env *env,
 	struct lov_stripe_md *lsm = lov_lsm_addref(lov);
 	struct lu_buf *buf = &cl->cl_buf;
 	ssize_t rc;
+	int i;
 	ENTRY;
 
+	cl->cl_stripe_end = 0;
+	cl->cl_stripe_size = 0;
+	cl->cl_stripe_count = 0;
+
 	if (lsm == NULL) {
 		cl->cl_size = 0;
 		cl->cl_layout_gen = CL_LAYOUT_GEN_EMPTY;
@@ -2276,6 +2281,25 @@ static int lov_object_layout_get(const struct lu_env *env,
 	cl->cl_is_released = lsm->lsm_is_released;
 	cl->cl_is_composite = lsm_is_composite(lsm->lsm_magic);
 
+	for (i = 0; i < lsm->lsm_entry_count; i++) {
+		struct lov_stripe_md_entry *lsme = lsm->lsm_entries[i];
+
+		if (lsme_is_foreign(lsme) || !lsme_inited(lsme) ||
+		    lsme->lsme_pattern & LOV_PATTERN_F_RELEASED ||
+		    cl->cl_stripe_pos < lsme->lsme_extent.e_start ||
+		    cl->cl_stripe_pos >= lsme->lsme_extent.e_end)
+			continue;
+
+		/* the first mirror will do, the split is only a hint */
+		cl->cl_stripe_end = lsme->lsme_extent.e_end;
+		/* DoM data is not striped, only its end is of use */
+		if (lov_pattern(lsme->lsme_pattern) & LOV_PATTERN_MDT)
+			break;
+		cl->cl_stripe_count = lsme->lsme_stripe_count;
+		cl->cl_stripe_size = lsme->lsme_stripe_size;
+		break;
+	}
+
 	rc = lov_lsm_pack(lsm, buf->lb_buf, buf->lb_len);
 	lov_lsm_put(lsm);
 
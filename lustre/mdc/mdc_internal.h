@@ -23,7 +23,7 @@ void mdc_pack_body(struct req_capsule *pill, const struct lu_fid *fid,
 void mdc_swap_layouts_pack(struct req_capsule *pill,
 			   struct md_op_data *op_data);
 void mdc_readdir_pack(struct req_capsule *pill, __u64 pgoff, size_t size,
-		      const struct lu_fid *fid);
+		      const struct lu_fid *fid, __u32 attrs);
 void mdc_getattr_pack(struct req_capsule *pill, __u64 valid, __u32 flags,
 		      struct md_op_data *data, size_t ea_size);
 void mdc_setattr_pack(struct req_capsule *pill, struct md_op_data *op_data,
@@ -161,7 +161,7 @@ void mdc_file_sepol_pack(struct req_capsule *pill, struct sptlrpc_sepol *p)
 }
 
 void mdc_readdir_pack(struct req_capsule *pill, __u64 pgoff, size_t size,
-		      const struct lu_fid *fid)
+		      const struct lu_fid *fid, __u32 attrs)
 {
 	struct mdt_body *b = req_capsule_client_get(pill, &RMF_MDT_BODY);
 
@@ -170,7 +170,7 @@ void mdc_readdir_pack(struct req_capsule *pill, __u64 pgoff, size_t size,
 	b->mbo_size = pgoff;			/* !! */
 	b->mbo_nlink = size;			/* !! */
 	__mdc_pack_body(b, -1);
-	b->mbo_mode = LUDA_FID | LUDA_TYPE;
+	b->mbo_mode = attrs;
 }
 
 /* packing of MDS records */
@@ -1006,7 +1006,7 @@ out:
 }
 
 static int mdc_getpage(struct obd_export *exp, const struct lu_fid *fid,
-		       u64 offset, struct page **pages, int npages,
+		       u64 offset, __u32 attrs, struct page **pages, int npages,
 		       struct ptlrpc_request **request)
 {
 	struct ptlrpc_request   *req;
@@ -1046,7 +1046,8 @@ restart_bulk:
 		desc->bd_frag_ops->add_kiov_frag(desc, pages[i], 0,
 						 PAGE_SIZE);
 
-	mdc_readdir_pack(&req->rq_pill, offset, PAGE_SIZE * npages, fid);
+	mdc_readdir_pack(&req->rq_pill, offset, PAGE_SIZE * npages, fid,
+			 attrs);
 
 	ptlrpc_request_set_replen(req);
 	rc = ptlrpc_queue_wait(req);
@@ -1308,6 +1309,7 @@ static int ll_mdc_read_page_remote(void *data, struct page *page0)
 	int max_pages;
 	struct inode *inode;
 	struct lu_fid *fid;
+	__u32 attrs = LUDA_FID | LUDA_TYPE;
 	int rd_pgs = 0; /* number of pages actually read */
 	int npages;
 	int i;
@@ -1337,7 +1339,13 @@ static int ll_mdc_read_page_remote(void *data, struct page *page0)
 		page_pool[npages] = page;
 	}
 
-	rc = mdc_getpage(rp->rp_exp, fid, rp->rp_off, page_pool, npages, &req);
+	/* readdir-plus: have the MDT describe the objects of the entries */
+	if (op_data->op_cli_flags & CLI_READDIR_PLUS &&
+	    exp_connect_flags2(rp->rp_exp) & OBD_CONNECT2_READDIR_PLUS)
+		attrs |= LUDA_ATTRS;
+
+	rc = mdc_getpage(rp->rp_exp, fid, rp->rp_off, attrs, page_pool,
+			 npages, &req);
 	if (rc < 0) {
 		/* page0 is special, which was added into page cache early */
 		cfs_delete_from_page_cache(page0);
@@ -2937,6 +2945,47 @@ static int mdc_cancel_weight(struct ldlm_lock *lock)
 	RETURN(1);
 }
 
+/* cached directory pages scoring a directory lock as half re-acquisition */
+#define MDC_DIR_COST_PAGES	8
+
+/**
+ * Score an unused lock for the namespace LRU. Directory lookup and update
+ * locks are expensive to lose in proportion to the directory pages cached
+ * under them, which have to be read again, while file attribute locks come
+ * back with a single getattr.
+ */
+static unsigned int mdc_lock_cost(struct ldlm_lock *lock)
+{
+	struct ldlm_resource *res = lock->l_resource;
+	unsigned long pages = 0;
+	struct inode *inode;
+
+	if (res->lr_type != LDLM_IBITS)
+		return 0;
+
+	if (ldlm_has_dom(lock))
+		return osc_ldlm_lock_cost(lock);
+
+	if (!(lock->l_policy_data.l_inodebits.bits &
+	      (MDS_INODELOCK_LOOKUP | MDS_INODELOCK_UPDATE)))
+		return 0;
+
+	lock_res(res);
+	inode = res->lr_lvb_inode;
+	if (inode && S_ISDIR(inode->i_mode))
+		pages = READ_ONCE(inode->i_mapping->nrpages);
+	unlock_res(res);
+
+	return pages * 100 / (pages + MDC_DIR_COST_PAGES);
+}
+
+/* only DoM locks have data pages which their cancel has to flush */
+static bool mdc_lock_has_pages(struct ldlm_lock *lock)
+{
+	return lock->l_resource->lr_type == LDLM_IBITS && ldlm_has_dom(lock) &&
+	       osc_ldlm_lock_has_pages(lock);
+}
+
 static int mdc_resource_inode_free(struct ldlm_resource *res)
 {
 	if (res->lr_lvb_inode)
@@ -3000,6 +3049,8 @@ int mdc_setup(struct obd_device *obd, struct lustre_cfg *cfg)
 	obd->u.cli.cl_lsom_update = true;
 
 	ns_register_cancel(obd->obd_namespace, mdc_cancel_weight);
+	ns_register_lock_cost(obd->obd_namespace, mdc_lock_cost);
+	ns_register_lock_has_pages(obd->obd_namespace, mdc_lock_has_pages);
 
 	obd->obd_namespace->ns_lvbo = &inode_lvbo;
 
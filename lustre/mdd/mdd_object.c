@@ -3992,6 +3992,88 @@ static int mdd_readpage_sanity_check(const struct lu_env *env,
 	return 0;
 }
 
+/**
+ * Append the attributes of the entry's object to a readdir-plus record.
+ *
+ * Remote or missing objects are not described, such entries go out without
+ * LUDA_ATTRS and the client falls back to a normal getattr for them.
+ */
+static bool mdd_dir_page_attrs(const struct lu_env *env,
+			       struct mdd_device *mdd, struct lu_dirent *ent)
+{
+	struct mdd_thread_info *info = mdd_env_info(env);
+	struct lu_attr *la = &info->mdi_tattr;
+	struct lu_fid *fid = &info->mdi_fid2;
+	struct lu_buf *som_buf = &info->mdi_buf[0];
+	struct lustre_som_attrs som;
+	struct luda_attrs *lat;
+	struct mdd_object *child;
+	bool packed = false;
+	__u64 valid;
+	int rc;
+
+	if (!(le32_to_cpu(ent->lde_attrs) & LUDA_FID))
+		return false;
+
+	fid_le_to_cpu(fid, &ent->lde_fid);
+	if (!fid_is_sane(fid))
+		return false;
+
+	child = mdd_object_find(env, mdd, fid);
+	if (IS_ERR_OR_NULL(child))
+		return false;
+
+	if (!mdd_object_exists(child) || mdd_object_remote(child))
+		goto out;
+
+	rc = mdd_la_get(env, child, la);
+	if (rc)
+		goto out;
+
+	lat = (void *)ent + le16_to_cpu(ent->lde_reclen);
+	memset(lat, 0, sizeof(*lat));
+	valid = OBD_MD_FLTYPE | OBD_MD_FLMODE | OBD_MD_FLUID | OBD_MD_FLGID |
+		OBD_MD_FLNLINK | OBD_MD_FLATIME | OBD_MD_FLCTIME;
+	lat->lat_mode = cpu_to_le32(la->la_mode);
+	lat->lat_uid = cpu_to_le32(la->la_uid);
+	lat->lat_gid = cpu_to_le32(la->la_gid);
+	lat->lat_nlink = cpu_to_le32(la->la_nlink);
+	lat->lat_atime = cpu_to_le64(la->la_atime);
+	lat->lat_ctime = cpu_to_le64(la->la_ctime);
+	lat->lat_mtime = cpu_to_le64(la->la_mtime);
+
+	if (S_ISREG(la->la_mode)) {
+		/* size and mtime of a file live on the OSTs, only the LSOM
+		 * copy is known here
+		 */
+		som_buf->lb_buf = &som;
+		som_buf->lb_len = sizeof(som);
+		rc = mdo_xattr_get(env, child, som_buf, XATTR_NAME_SOM);
+		if (rc == sizeof(som)) {
+			lustre_som_swab(&som);
+			if (som.lsa_valid & (SOM_FL_STRICT | SOM_FL_LAZY)) {
+				valid |= OBD_MD_FLLAZYSIZE |
+					 OBD_MD_FLLAZYBLOCKS;
+				lat->lat_size = cpu_to_le64(som.lsa_size);
+				lat->lat_blocks = cpu_to_le64(som.lsa_blocks);
+				lat->lat_flags = cpu_to_le32(som.lsa_valid);
+			}
+		}
+	} else {
+		valid |= OBD_MD_FLSIZE | OBD_MD_FLBLOCKS | OBD_MD_FLMTIME;
+		lat->lat_size = cpu_to_le64(la->la_size);
+		lat->lat_blocks = cpu_to_le64(la->la_blocks);
+	}
+	lat->lat_valid = cpu_to_le64(valid);
+
+	ent->lde_attrs |= cpu_to_le32(LUDA_ATTRS);
+	le16_add_cpu(&ent->lde_reclen, sizeof(*lat));
+	packed = true;
+out:
+	mdd_object_put(env, child);
+	return packed;
+}
+
 static int mdd_dir_page_build(const struct lu_env *env, struct dt_object *obj,
 			      union lu_page *lp, size_t bytes,
 			      const struct dt_it_ops *iops,
@@ -4035,7 +4117,11 @@ static int mdd_dir_page_build(const struct lu_env *env, struct dt_object *obj,
 
 		if (bytes >= recsize &&
 		    !CFS_FAIL_CHECK(OBD_FAIL_MDS_DIR_PAGE_WALK)) {
-			result = iops->rec(env, it, (struct dt_rec *)ent, attr);
+			/* OSD packs the name part, readdir-plus attributes
+			 * are appended here
+			 */
+			result = iops->rec(env, it, (struct dt_rec *)ent,
+					   attr & ~LUDA_ATTRS);
 			if (result == -ESTALE)
 				GOTO(next, result);
 			if (result != 0)
@@ -4051,6 +4137,10 @@ static int mdd_dir_page_build(const struct lu_env *env, struct dt_object *obj,
 				if (fid_is_dot_lustre(&fid))
 					GOTO(next, recsize);
 			}
+
+			if (attr & LUDA_ATTRS &&
+			    mdd_dir_page_attrs(env, arg, ent))
+				recsize = le16_to_cpu(ent->lde_reclen);
 		} else {
 			result = (last != NULL) ? 0 : -EBADSLT;
 			GOTO(out, result);
@@ -4137,7 +4227,7 @@ int mdd_readpage(const struct lu_env *env, struct md_object *obj,
 	}
 
 	rc = dt_index_walk(env, mdd_object_child(mdd_obj), rdpg,
-			   mdd_dir_page_build, NULL);
+			   mdd_dir_page_build, mdo2mdd(obj));
 	if (rc >= 0) {
 		struct lu_dirpage	*dp;
 
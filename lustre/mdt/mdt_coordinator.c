@@ -1466,11 +1466,13 @@ static int hsm_swap_layouts(struct mdt_thread_info *mti,
 		GOTO(out_dobj, rc);
 
 	rc = mdt_lsom_downgrade(mti, obj);
-	if (rc)
+	if (rc < 0)
 		CDEBUG(D_INODE,
 		       "%s: File fid="DFID" SOM downgrade failed, rc = %d\n",
 		       mdt_obd_name(mti->mti_mdt),
 		       PFID(mdt_object_fid(obj)), rc);
+	else
+		rc = 0;
 out_dobj:
 	mdt_object_unlock_put(mti, dobj, dlh, 1);
 out:
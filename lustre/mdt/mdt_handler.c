@@ -2968,6 +2968,82 @@ static int mdt_set_info(struct tgt_session_info *tsi)
 	RETURN(rc);
 }
 
+/**
+ * Check the client may see the attributes of the directory entries.
+ *
+ * Listing a directory only takes read permission, its entries' attributes
+ * are only returned with readdir-plus pages to who may search it.
+ */
+static bool mdt_readpage_attrs_allowed(struct tgt_session_info *tsi)
+{
+	struct mdt_thread_info *info = tsi2mdt_info(tsi);
+	int rc;
+
+	rc = mdt_init_ucred(info, (struct mdt_body *)tsi->tsi_mdt_body);
+	if (!rc) {
+		rc = mo_permission(info->mti_env, NULL,
+				   mdt_object_child(info->mti_object), NULL,
+				   MAY_EXEC);
+		mdt_exit_ucred(info);
+	}
+	mdt_thread_info_fini(info);
+
+	return rc == 0;
+}
+
+/**
+ * Map the owners in readdir-plus attributes to the ids of the client's
+ * nodemap, as mdt_pack_attr2body() does for getattr replies.
+ *
+ * \param[in] tsi	target session of the readpage request
+ * \param[in] rdpg	directory pages filled by the lower layers
+ * \param[in] nob	number of bytes filled
+ *
+ * \retval		0 on success, negative errno otherwise
+ */
+static int mdt_readpage_map_ids(struct tgt_session_info *tsi,
+				struct lu_rdpg *rdpg, int nob)
+{
+	struct lu_nodemap *nodemap;
+	int i, j;
+
+	nodemap = nodemap_get_from_exp(tsi->tsi_exp);
+	if (IS_ERR(nodemap))
+		return PTR_ERR(nodemap);
+
+	for (i = 0; i < rdpg->rp_npages && nob > 0; i++) {
+		void *addr = kmap(rdpg->rp_pages[i]);
+
+		for (j = 0; j < LU_PAGE_COUNT && nob > 0;
+		     j++, nob -= LU_PAGE_SIZE) {
+			struct lu_dirpage *dp = addr + j * LU_PAGE_SIZE;
+			struct lu_dirent *ent;
+
+			for (ent = lu_dirent_start(dp); ent != NULL;
+			     ent = lu_dirent_next(ent)) {
+				struct luda_attrs *lat;
+
+				lat = lu_dirent_attrs_get(ent);
+				if (!lat)
+					continue;
+
+				lat->lat_uid = cpu_to_le32(
+					nodemap_map_id(nodemap, NODEMAP_UID,
+						       NODEMAP_FS_TO_CLIENT,
+						       le32_to_cpu(lat->lat_uid)));
+				lat->lat_gid = cpu_to_le32(
+					nodemap_map_id(nodemap, NODEMAP_GID,
+						       NODEMAP_FS_TO_CLIENT,
+						       le32_to_cpu(lat->lat_gid)));
+			}
+		}
+		kunmap(rdpg->rp_pages[i]);
+	}
+	nodemap_putref(nodemap);
+
+	return 0;
+}
+
 static int mdt_readpage(struct tgt_session_info *tsi)
 {
 	struct mdt_thread_info	*info = mdt_th_info(tsi->tsi_env);
@@ -3002,6 +3078,10 @@ static int mdt_readpage(struct tgt_session_info *tsi)
 	rdpg->rp_attrs = reqbody->mbo_mode;
 	if (exp_connect_flags(tsi->tsi_exp) & OBD_CONNECT_64BITHASH)
 		rdpg->rp_attrs |= LUDA_64BITHASH;
+	if (rdpg->rp_attrs & LUDA_ATTRS &&
+	    (!exp_connect_readdir_plus(tsi->tsi_exp) ||
+	     !mdt_readpage_attrs_allowed(tsi)))
+		rdpg->rp_attrs &= ~LUDA_ATTRS;
 	rdpg->rp_count  = min_t(unsigned int, reqbody->mbo_nlink,
 				exp_max_brw_size(tsi->tsi_exp));
 	rdpg->rp_npages = (rdpg->rp_count + PAGE_SIZE - 1) >>
@@ -3021,6 +3101,13 @@ static int mdt_readpage(struct tgt_session_info *tsi)
 	if (rc < 0)
 		GOTO(free_rdpg, rc);
 
+	if (rdpg->rp_attrs & LUDA_ATTRS) {
+		int rc2 = mdt_readpage_map_ids(tsi, rdpg, rc);
+
+		if (rc2 < 0)
+			GOTO(free_rdpg, rc = rc2);
+	}
+
 	/* send pages to client */
 	rc = tgt_sendpage(tsi, rdpg, rc);
 
@@ -6794,6 +6881,8 @@ static struct lu_object *mdt_object_alloc(const struct lu_env *env,
 		mo->mot_lsom_size = 0;
 		mo->mot_lsom_blocks = 0;
 		mo->mot_lsom_inited = false;
+		mo->mot_som_strict_gen = 0;
+		mo->mot_som_nostrict = false;
 		RETURN(o);
 	}
 	RETURN(NULL);
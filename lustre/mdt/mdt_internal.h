@@ -77,6 +77,8 @@ struct mdt_file_data {
 	struct lustre_handle	mfd_open_handle_old;
 	/** point to opened object */
 	struct mdt_object	*mfd_object;
+	/** mot_write_gen of the object when opened for write */
+	__u64			mfd_write_gen;
 };
 
 #define CDT_NONBLOCKING_RESTORE		(1ULL << 0)
@@ -379,6 +381,12 @@ struct mdt_object {
 				mot_auto_split_disabled:1,
 				mot_lsom_inited:1; /* lsom was inited */
 	int			mot_write_count;
+	/* bumped by each open for write, protected by mot_write_lock */
+	__u64			mot_write_gen;
+	/* bumped by each strict SOM update, protected by mot_write_lock */
+	__u64			mot_som_strict_gen;
+	/* no strict SOM is stored, an open for write need not end it */
+	bool			mot_som_nostrict;
 	spinlock_t		mot_write_lock;
         /* Lock to protect create_data */
 	struct mutex		mot_lov_mutex;
@@ -952,7 +960,7 @@ int mdt_attr_get_pfid(struct mdt_thread_info *info, struct mdt_object *o,
 		      struct lu_fid *pfid);
 int mdt_attr_get_pfid_name(struct mdt_thread_info *info, struct mdt_object *o,
 			   struct lu_fid *pfid, struct lu_name *lname);
-int mdt_write_get(struct mdt_object *o);
+int mdt_write_get(struct mdt_object *o, __u64 *gen);
 void mdt_write_put(struct mdt_object *o);
 int mdt_write_read(struct mdt_object *o);
 struct mdt_file_data *mdt_mfd_new(const struct mdt_export_data *med);
@@ -1322,6 +1330,10 @@ int mdt_set_som(struct mdt_thread_info *info, struct mdt_object *obj,
 int mdt_get_som(struct mdt_thread_info *info, struct mdt_object *obj,
 		struct md_attr *ma);
 int mdt_lsom_downgrade(struct mdt_thread_info *info, struct mdt_object *obj);
+int mdt_som_open_write(struct mdt_thread_info *info, struct mdt_object *obj);
+void mdt_som_strict_mark(struct mdt_object *obj);
+int mdt_som_strict_close(struct mdt_thread_info *info, struct mdt_object *obj,
+			 struct md_attr *ma, __u64 write_gen);
 int mdt_lsom_update(struct mdt_thread_info *info, struct mdt_object *obj,
 		    bool truncate);
 
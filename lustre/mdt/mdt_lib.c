@@ -1284,7 +1284,8 @@ static int mdt_setattr_unpack_rec(struct mdt_thread_info *info)
 
 	ma->ma_attr_flags |= rec->sa_bias & (MDS_CLOSE_INTENT |
 				MDS_DATA_MODIFIED | MDS_TRUNC_KEEP_LEASE |
-				MDS_PCC_ATTACH | MDS_CLOSE_LAYOUT_SWAP_HSM);
+				MDS_PCC_ATTACH | MDS_CLOSE_LAYOUT_SWAP_HSM |
+				MDS_CLOSE_STRICT_SOM);
 	RETURN(0);
 }
 
@@ -147,16 +147,18 @@ int mdt_write_read(struct mdt_object *o)
 	RETURN(rc);
 }
 
-int mdt_write_get(struct mdt_object *o)
+int mdt_write_get(struct mdt_object *o, __u64 *gen)
 {
 	int rc = 0;
 
 	ENTRY;
 	spin_lock(&o->mot_write_lock);
-	if (o->mot_write_count < 0)
+	if (o->mot_write_count < 0) {
 		rc = -ETXTBSY;
-	else
+	} else {
 		o->mot_write_count++;
+		*gen = ++o->mot_write_gen;
+	}
 	spin_unlock(&o->mot_write_lock);
 
 	RETURN(rc);
@@ -360,6 +362,7 @@ static int mdt_mfd_open(struct mdt_thread_info *info, struct mdt_object *p,
 	struct md_attr *ma  = &info->mti_attr;
 	struct lu_attr *la  = &ma->ma_attr;
 	struct mdt_body *repbody;
+	__u64 write_gen = 0;
 	bool isdir, isreg;
 	int rc = 0;
 
@@ -413,7 +416,7 @@ static int mdt_mfd_open(struct mdt_thread_info *info, struct mdt_object *p,
 	}
 
 	if (open_flags & MDS_FMODE_WRITE)
-		rc = mdt_write_get(o);
+		rc = mdt_write_get(o, &write_gen);
 	else if (open_flags & MDS_FMODE_EXEC)
 		rc = mdt_write_deny(o);
 
@@ -447,6 +450,7 @@ static int mdt_mfd_open(struct mdt_thread_info *info, struct mdt_object *p,
 	mdt_object_get(info->mti_env, o);
 	mfd->mfd_object = o;
 	mfd->mfd_xid = req->rq_xid;
+	mfd->mfd_write_gen = write_gen;
 
 	/*
 	 * @open_flags is always not zero. At least it should be FMODE_READ,
@@ -804,6 +808,15 @@ static int mdt_object_open_lock(struct mdt_thread_info *info,
 	if (req_is_replay(mdt_info_req(info)))
 		RETURN(0);
 
+	/* end the strict SOM before taking the open lock, see LU-3601 */
+	if (S_ISREG(lu_object_attr(&obj->mot_obj)) &&
+	    open_flags & MDS_FMODE_WRITE && !(open_flags & MDS_OPEN_RELEASE)) {
+		rc = mdt_som_open_write(info, obj);
+		if (rc < 0)
+			RETURN(rc);
+		rc = 0;
+	}
+
 	if (S_ISREG(lu_object_attr(&obj->mot_obj))) {
 		if (ma->ma_need & MA_LOV && !(ma->ma_valid & MA_LOV) &&
 		    md_should_create(open_flags))
@@ -2480,8 +2493,12 @@ static int mdt_close_resync_done(struct mdt_thread_info *info,
 		layout.mlc_som.lsa_valid = SOM_FL_STRICT;
 		layout.mlc_som.lsa_size = ma->ma_attr.la_size;
 		layout.mlc_som.lsa_blocks = ma->ma_attr.la_blocks;
+		mdt_som_strict_mark(o);
 	}
 	rc = mdt_layout_change(info, o, lhc, &layout);
+	/* the SOM is written without mot_som_mutex */
+	if (layout.mlc_som.lsa_valid & SOM_FL_STRICT)
+		mdt_som_strict_mark(o);
 	if (rc)
 		GOTO(out_unlock, rc);
 
@@ -2585,7 +2602,23 @@ int mdt_mfd_close(struct mdt_thread_info *info, struct mdt_file_data *mfd)
 		break;
 	}
 
+	/* the last writer packs the size flushed from OSTs, keep it strict */
+	rc2 = 1;
 	if (S_ISREG(lu_object_attr(&o->mot_obj)) &&
+	    open_flags & MDS_FMODE_WRITE &&
+	    ma->ma_attr_flags & MDS_CLOSE_STRICT_SOM &&
+	    (ma->ma_attr.la_valid & (LA_SIZE | LA_BLOCKS)) ==
+	    (LA_SIZE | LA_BLOCKS)) {
+		rc2 = mdt_som_strict_close(info, o, ma,
+					   mfd->mfd_write_gen);
+		if (rc2 < 0)
+			CDEBUG(D_INODE,
+			       "%s: File " DFID " strict SOM failed: rc = %d\n",
+			       mdt_obd_name(info->mti_mdt),
+			       PFID(ofid), rc2);
+	}
+
+	if (rc2 != 0 && S_ISREG(lu_object_attr(&o->mot_obj)) &&
 	    ma->ma_attr.la_valid & (LA_LSIZE | LA_LBLOCKS)) {
 		rc2 = mdt_lsom_update(info, o, false);
 		if (rc2 < 0) {
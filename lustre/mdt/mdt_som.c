@@ -142,6 +142,9 @@ int mdt_set_som(struct mdt_thread_info *info, struct mdt_object *obj,
 	memset(&som->lsa_reserved, 0, sizeof(som->lsa_reserved));
 	lustre_som_swab(som);
 
+	if (flag & SOM_FL_STRICT)
+		mdt_som_strict_mark(obj);
+
 	/* update SOM attributes */
 	buf->lb_buf = som;
 	buf->lb_len = sizeof(*som);
@@ -154,17 +157,42 @@ int mdt_set_som(struct mdt_thread_info *info, struct mdt_object *obj,
 	RETURN(rc);
 }
 
+/**
+ * Note that a strict SOM may be stored for \a o from now on. Called before
+ * the SOM xattr is written, and after it too if that is not done under
+ * mot_som_mutex, see mdt_lsom_downgrade().
+ */
+void mdt_som_strict_mark(struct mdt_object *o)
+{
+	spin_lock(&o->mot_write_lock);
+	o->mot_som_strict_gen++;
+	o->mot_som_nostrict = false;
+	spin_unlock(&o->mot_write_lock);
+}
+
 /**
  * SOM state transition from STRICT to STALE,
+ *
+ * Once no strict SOM is left, and none was set meanwhile, the object is
+ * flagged so that opens for write skip this until the next strict SOM.
+ *
+ * \retval 1 if the SOM was strict
+ * \retval 0 if it was not
+ * \retval negative errno on failure
  */
 int mdt_lsom_downgrade(struct mdt_thread_info *info, struct mdt_object *o)
 {
 	struct md_attr *tmp_ma;
+	__u64 strict_gen;
 	int rc;
 
 	ENTRY;
 
 	mutex_lock(&o->mot_som_mutex);
+	spin_lock(&o->mot_write_lock);
+	strict_gen = o->mot_som_strict_gen;
+	spin_unlock(&o->mot_write_lock);
+
 	tmp_ma = &info->mti_u.som.attr;
 	tmp_ma->ma_need = MA_SOM;
 	tmp_ma->ma_valid = 0;
@@ -178,10 +206,114 @@ int mdt_lsom_downgrade(struct mdt_thread_info *info, struct mdt_object *o)
 
 		info->mti_som_strict = 0;
 		/* The size and blocks info should be still correct. */
-		if (som->ms_valid & SOM_FL_STRICT)
+		if (som->ms_valid & SOM_FL_STRICT) {
 			rc = mdt_set_som(info, o, SOM_FL_STALE,
 					 som->ms_size, som->ms_blocks);
+			if (rc == 0)
+				rc = 1;
+		}
 	}
+
+	if (rc >= 0) {
+		spin_lock(&o->mot_write_lock);
+		if (o->mot_som_strict_gen == strict_gen)
+			o->mot_som_nostrict = true;
+		spin_unlock(&o->mot_write_lock);
+	}
+out_lock:
+	mutex_unlock(&o->mot_som_mutex);
+	RETURN(rc);
+}
+
+/**
+ * An open for write ends the strict SOM of a file, as its data may change
+ * from now on. The UPDATE locks are revoked too, since clients skip the
+ * glimpse with a strict size cached under them.
+ *
+ * Called before the open lock is taken on \a o. The write generation is
+ * bumped here already, so a last writer closing before mdt_write_get() of
+ * this open either sees it or gets its strict SOM downgraded below.
+ *
+ * Most files never get a strict SOM, the SOM xattr is only read again once
+ * one may have been set, see mdt_som_strict_mark().
+ */
+int mdt_som_open_write(struct mdt_thread_info *info, struct mdt_object *o)
+{
+	struct mdt_lock_handle *lh = &info->mti_lh[MDT_LH_LOCAL];
+	bool nostrict;
+	int rc;
+
+	ENTRY;
+
+	spin_lock(&o->mot_write_lock);
+	o->mot_write_gen++;
+	nostrict = o->mot_som_nostrict;
+	spin_unlock(&o->mot_write_lock);
+	if (nostrict)
+		RETURN(0);
+
+	rc = mdt_lsom_downgrade(info, o);
+	if (rc <= 0)
+		RETURN(rc);
+
+	rc = mdt_object_lock(info, o, lh, MDS_INODELOCK_UPDATE, LCK_EX);
+	if (rc == 0)
+		mdt_object_unlock(info, o, lh, 1);
+
+	RETURN(rc);
+}
+
+/**
+ * Keep the size and blocks packed in the close of the last writer as
+ * strict SOM. The client got them after the dirty data of all clients was
+ * flushed by a server side lock on the OST objects, so they stay exact
+ * until the next open for write, see mdt_som_open_write().
+ *
+ * The size was sampled by the client before the close was sent, so a writer
+ * opening, writing and closing in between would leave it stale while this
+ * handle is the only one left. Hence \a write_gen, the write generation of
+ * the object when this handle was opened, must still be the current one.
+ *
+ * \retval 0 if the strict SOM is set
+ * \retval 1 if the file is still or was meanwhile opened for write by
+ *	    others, or it has no OST objects
+ * \retval negative errno on failure
+ */
+int mdt_som_strict_close(struct mdt_thread_info *info, struct mdt_object *o,
+			 struct md_attr *ma, __u64 write_gen)
+{
+	struct lu_attr *la = &ma->ma_attr;
+	bool last;
+	int rc;
+
+	ENTRY;
+
+	if (!info->mti_big_lov_used) {
+		rc = mdt_big_xattr_get(info, o, XATTR_NAME_LOV);
+		if (rc < 0)
+			RETURN(rc == -ENODATA ? 1 : rc);
+	}
+
+	/* the size of DoM-only files is known by the MDT already */
+	if (mdt_lmm_dom_only(info->mti_big_lov))
+		RETURN(1);
+
+	mutex_lock(&o->mot_som_mutex);
+	/* the handle being closed is still counted, see mdt_mfd_close().
+	 * An open for write seeing mot_som_nostrict still set must have
+	 * bumped mot_write_gen before this check.
+	 */
+	spin_lock(&o->mot_write_lock);
+	last = o->mot_write_count == 1 && o->mot_write_gen == write_gen;
+	if (last) {
+		o->mot_som_strict_gen++;
+		o->mot_som_nostrict = false;
+	}
+	spin_unlock(&o->mot_write_lock);
+	if (!last)
+		GOTO(out_lock, rc = 1);
+
+	rc = mdt_set_som(info, o, SOM_FL_STRICT, la->la_size, la->la_blocks);
 out_lock:
 	mutex_unlock(&o->mot_som_mutex);
 	RETURN(rc);
@@ -1226,6 +1226,9 @@ static void cl_sub_dio_end(const struct lu_env *env, struct cl_sync_io *anchor)
 		 * because we have the unmodified iovec pointer
 		 */
 		csd_dup_free(&sdio->csd_dup);
+	} else if (sdio->csd_dio_pages.cdp_bvec) {
+		/* the pages belong to the bvec owner, only the array is ours */
+		kvfree(sdio->csd_dio_pages.cdp_pages);
 	} else {
 		/* unaligned DIO does not get user pages, so it doesn't have to
 		 * release them, but aligned I/O must
@@ -976,7 +976,6 @@ static struct obd_export *__class_new_export(struct obd_device *obd,
 
 	export->exp_conn_cnt = 0;
 	export->exp_lock_hash = NULL;
-	export->exp_flock_hash = NULL;
 	/* 2 = class_handle_hash + last */
 	refcount_set(&export->exp_handle.h_ref, 2);
 	atomic_set(&export->exp_rpc_count, 0);
@@ -1002,6 +1001,9 @@ static struct obd_export *__class_new_export(struct obd_device *obd,
 	INIT_HLIST_NODE(&export->exp_gen_hash);
 	spin_lock_init(&export->exp_bl_list_lock);
 	INIT_LIST_HEAD(&export->exp_bl_list);
+	spin_lock_init(&export->exp_prolong_lock);
+	atomic_set(&export->exp_prolong_gen, 0);
+	spin_lock_init(&export->exp_stride_lock);
 	INIT_LIST_HEAD(&export->exp_stale_list);
 	INIT_WORK(&export->exp_zombie_work, obd_zombie_exp_cull);
 
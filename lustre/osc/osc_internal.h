@@ -69,6 +69,8 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		  struct list_head *ext_list, int cmd);
 void osc_send_empty_rpc(struct osc_object *osc, pgoff_t start);
 unsigned long osc_lru_reserve(struct client_obd *cli, unsigned long npages);
+unsigned long osc_lru_try_reserve(struct client_obd *cli,
+				  unsigned long npages);
 void osc_lru_unreserve(struct client_obd *cli, unsigned long npages);
 
 extern struct lu_kmem_descr osc_caches[];
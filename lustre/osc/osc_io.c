@@ -38,6 +38,16 @@
 
 static void osc_io_fini(const struct lu_env *env, const struct cl_io_slice *io)
 {
+	struct osc_io *oio = cl2osc_io(env, io);
+
+	/* read-ahead reserves LRU slots outside of the io iterations too,
+	 * for the async read-ahead works and lov sub-ios
+	 */
+	if (oio->oi_lru_reserved > 0) {
+		osc_lru_unreserve(osc_cli(cl2osc(io->cis_obj)),
+				  oio->oi_lru_reserved);
+		oio->oi_lru_reserved = 0;
+	}
 }
 
 void osc_read_ahead_release(const struct lu_env *env, struct cl_read_ahead *ra)
@@ -88,6 +98,14 @@ static int osc_io_read_ahead(const struct lu_env *env,
 		ra->cra_end_idx = min_t(pgoff_t,
 					ra->cra_end_idx,
 					(oinfo->loi_kms - 1) >> PAGE_SHIFT);
+		/* take LRU slots for one RPC of read-ahead pages at once,
+		 * leftovers are returned in osc_io_fini()
+		 */
+		if (ios->cis_io->ci_type == CIT_READ &&
+		    ra->cra_end_idx >= start)
+			oio->oi_lru_reserved += osc_lru_try_reserve(osc_cli(osc),
+				min_t(pgoff_t, ra->cra_end_idx - start + 1,
+				      ra->cra_rpc_pages));
 		result = 0;
 	}
 
@@ -277,6 +277,13 @@ static int osc_lock_upcall(void *cookie, struct lustre_handle *lockh,
 				    NULL, &oscl->ols_lvb);
 		/* Hide the error. */
 		rc = 0;
+	} else if (rc == -EUSERS &&
+		   oscl->ols_flags & LDLM_FL_DENY_ON_CONTENTION) {
+		/* the OST found the extent contended, pass -EUSERS up so
+		 * the IO is redone without a client lock
+		 */
+		osc_object_set_contended(cl2osc(slice->cls_obj));
+		LDLM_DEBUG_NOLOCK("osc lock %p: extent contended", oscl);
 	} else if (rc < 0 && oscl->ols_flags & LDLM_FL_NDELAY) {
 		rc = -EAGAIN;
 	}
@@ -741,6 +748,67 @@ out:
 }
 EXPORT_SYMBOL(osc_ldlm_weigh_ast);
 
+/* pages cached on the object of \a dlmlock, which its cancel drops */
+static unsigned long osc_ldlm_lock_pages(struct ldlm_lock *dlmlock)
+{
+	struct osc_object *obj;
+	unsigned long pages = 0;
+
+	lock_res_and_lock(dlmlock);
+	obj = dlmlock->l_ast_data;
+	if (obj)
+		pages = READ_ONCE(obj->oo_npages);
+	unlock_res_and_lock(dlmlock);
+
+	return pages;
+}
+
+/**
+ * Check if an unused extent or DoM lock has pages cached under it, so its
+ * cancel has to flush or drop them.
+ */
+bool osc_ldlm_lock_has_pages(struct ldlm_lock *dlmlock)
+{
+	return osc_ldlm_lock_pages(dlmlock) > 0;
+}
+EXPORT_SYMBOL(osc_ldlm_lock_has_pages);
+
+/**
+ * Score an unused extent or DoM lock for the namespace LRU.
+ *
+ * Cancelling the lock drops the pages cached for its object, which then have
+ * to be read back, but those pages are charged to the cache budget shared by
+ * the whole mount. That budget is only under pressure once the LRU starts
+ * to shrink, see osc_cache_too_much(), and the closer it is to running out
+ * from there, the cheaper the lock is to let go.
+ */
+unsigned int osc_ldlm_lock_cost(struct ldlm_lock *dlmlock)
+{
+	struct client_obd *cli = &dlmlock->l_conn_export->exp_obd->u.cli;
+	struct cl_client_cache *cache = cli->cl_cache;
+	unsigned long pages = osc_ldlm_lock_pages(dlmlock);
+	unsigned int pressure = 0;
+	unsigned long chunks;
+
+	/* nothing cached, a single enqueue brings the lock back */
+	if (pages == 0)
+		return 0;
+
+	if (cache && cache->ccc_lru_max >> 2) {
+		unsigned long low = cache->ccc_lru_max >> 2;
+		long left = atomic_long_read(&cache->ccc_lru_left);
+
+		left = clamp_t(long, left, 0, cache->ccc_lru_max);
+		if (left < low)
+			pressure = (low - left) * 100 / low;
+	}
+
+	chunks = DIV_ROUND_UP(pages, cli->cl_max_pages_per_rpc);
+
+	return ldlm_lock_cost_score(1 + chunks, chunks, pressure);
+}
+EXPORT_SYMBOL(osc_ldlm_lock_cost);
+
 static void osc_lock_build_einfo(const struct lu_env *env,
 				 const struct cl_lock *lock,
 				 struct osc_object *osc,
@@ -462,7 +462,12 @@ static void osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 			CDEBUG(D_CACHE, "%s: queue LRU work\n", cli_name(cli));
 			(void)ptlrpcd_queue_work(cli->cl_lru_work);
 		}
-		wake_up(&osc_lru_waitq);
+		/* called for every page freed, don't take the global
+		 * waitqueue lock unless somebody waits for a slot
+		 */
+		smp_mb();
+		if (waitqueue_active(&osc_lru_waitq))
+			wake_up(&osc_lru_waitq);
 	} else {
 		LASSERT(list_empty(&opg->ops_lru));
 	}
@@ -1084,6 +1089,31 @@ again:
 	return reserved;
 }
 
+/**
+ * osc_lru_try_reserve() takes up to \a npages LRU slots without waiting.
+ *
+ * Used by read-ahead, which would rather read fewer pages than block on the
+ * cache, to get the slots of a whole RPC at once instead of page by page.
+ */
+unsigned long osc_lru_try_reserve(struct client_obd *cli, unsigned long npages)
+{
+	long c;
+	long n;
+
+	if (cli->cl_cache == NULL)
+		return 0;
+
+	c = atomic_long_read(cli->cl_lru_left);
+	while (c > 0) {
+		n = min_t(long, c, npages);
+		if (c == atomic_long_cmpxchg(cli->cl_lru_left, c, c - n))
+			return n;
+		c = atomic_long_read(cli->cl_lru_left);
+	}
+
+	return 0;
+}
+
 /**
  * osc_lru_unreserve() is called to unreserve LRU slots.
  *
@@ -1094,7 +1124,9 @@ again:
 void osc_lru_unreserve(struct client_obd *cli, unsigned long npages)
 {
 	atomic_long_add(npages, cli->cl_lru_left);
-	wake_up(&osc_lru_waitq);
+	smp_mb__after_atomic();
+	if (waitqueue_active(&osc_lru_waitq))
+		wake_up(&osc_lru_waitq);
 }
 
 long osc_unevict_cache_shrink(const struct lu_env *env, struct client_obd *cli)
@@ -3940,6 +3940,8 @@ int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 	}
 
 	ns_register_cancel(obd->obd_namespace, osc_cancel_weight);
+	ns_register_lock_cost(obd->obd_namespace, osc_ldlm_lock_cost);
+	ns_register_lock_has_pages(obd->obd_namespace, osc_ldlm_lock_has_pages);
 
 	spin_lock(&osc_shrink_lock);
 	list_add_tail(&cli->cl_shrink_list, &osc_shrink_list);
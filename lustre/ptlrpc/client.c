@@ -1249,6 +1249,7 @@ void ptlrpc_set_add_new_req(struct ptlrpcd_ctl *pc,
 	req->rq_queued_time = ktime_get_seconds();
 	list_add_tail(&req->rq_set_chain, &set->set_new_requests);
 	count = atomic_inc_return(&set->set_new_count);
+	pc->pc_nadded++;
 	spin_unlock(&set->set_new_req_lock);
 
 	/* Only need to call wakeup once for the first entry. */
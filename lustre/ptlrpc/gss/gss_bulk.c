@@ -41,6 +41,8 @@
 #include <linux/fs.h>
 #include <linux/mutex.h>
 #include <linux/crypto.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
 
 #include <obd.h>
 #include <obd_class.h>
@@ -514,3 +516,169 @@ int gss_svc_wrap_bulk(struct ptlrpc_request *req,
 
         RETURN(0);
 }
+
+/*
+ * Parallel bulk crypto.
+ *
+ * A bulk descriptor may carry up to PTLRPC_MAX_BRW_PAGES pages, and a
+ * mechanism whose cipher is not chained between pages (e.g. the CTR mode
+ * used by SK) can process disjoint page ranges independently.  Such
+ * descriptors are split into chunks of gss_bulk_chunk_pages pages, all but
+ * the first chunk are queued to the crypto workqueue of the local CPU
+ * partition, and the calling thread handles the first chunk itself before
+ * waiting for the others to complete.
+ */
+unsigned int gss_bulk_chunk_pages = 64;
+
+static struct workqueue_struct **gss_bulk_wqs;
+static int gss_bulk_nwqs;
+
+static struct {
+	atomic64_t	gbs_serial;	/* descriptors handled inline */
+	atomic64_t	gbs_parallel;	/* descriptors split into chunks */
+	atomic64_t	gbs_chunks;	/* chunks queued to workers */
+} gss_bulk_stats;
+
+struct gss_bulk_work {
+	struct work_struct	 gbw_work;
+	gss_bulk_chunk_fn_t	 gbw_fn;
+	void			*gbw_arg;
+	int			 gbw_start;
+	int			 gbw_count;
+	int			 gbw_rc;
+	atomic_t		*gbw_pending;
+	struct completion	*gbw_done;
+};
+
+static void gss_bulk_work_handler(struct work_struct *work)
+{
+	struct gss_bulk_work *gbw = container_of(work, struct gss_bulk_work,
+						 gbw_work);
+
+	gbw->gbw_rc = gbw->gbw_fn(gbw->gbw_arg, gbw->gbw_start,
+				  gbw->gbw_count);
+	if (atomic_dec_and_test(gbw->gbw_pending))
+		complete(gbw->gbw_done);
+}
+
+/**
+ * Run \a fn over page range [0, \a npages) of a bulk descriptor, possibly
+ * in parallel.
+ *
+ * \a fn must only touch pages within the range it is given, and must be
+ * able to derive all per-range state (e.g. the cipher IV) from \a arg and
+ * the range start.
+ *
+ * \retval 0		all chunks succeeded
+ * \retval negative	error returned by the first failing chunk
+ */
+int gss_bulk_parallel(int npages, gss_bulk_chunk_fn_t fn, void *arg)
+{
+	struct completion done;
+	struct gss_bulk_work *works;
+	struct workqueue_struct *wq;
+	unsigned int chunk = READ_ONCE(gss_bulk_chunk_pages);
+	atomic_t pending;
+	int nchunks;
+	int rc;
+	int i;
+
+	if (chunk == 0 || npages <= chunk || !gss_bulk_wqs)
+		goto serial;
+
+	nchunks = DIV_ROUND_UP(npages, chunk);
+	OBD_ALLOC_PTR_ARRAY(works, nchunks - 1);
+	if (!works)
+		goto serial;
+
+	atomic64_inc(&gss_bulk_stats.gbs_parallel);
+	atomic64_add(nchunks - 1, &gss_bulk_stats.gbs_chunks);
+
+	init_completion(&done);
+	atomic_set(&pending, nchunks - 1);
+	wq = gss_bulk_wqs[cfs_cpt_current(cfs_cpt_tab, 1) % gss_bulk_nwqs];
+
+	for (i = 0; i < nchunks - 1; i++) {
+		struct gss_bulk_work *gbw = &works[i];
+
+		INIT_WORK(&gbw->gbw_work, gss_bulk_work_handler);
+		gbw->gbw_fn = fn;
+		gbw->gbw_arg = arg;
+		gbw->gbw_start = (i + 1) * chunk;
+		gbw->gbw_count = min_t(int, chunk, npages - gbw->gbw_start);
+		gbw->gbw_pending = &pending;
+		gbw->gbw_done = &done;
+		queue_work(wq, &gbw->gbw_work);
+	}
+
+	rc = fn(arg, 0, chunk);
+	wait_for_completion(&done);
+
+	for (i = 0; i < nchunks - 1 && rc == 0; i++)
+		rc = works[i].gbw_rc;
+
+	OBD_FREE_PTR_ARRAY(works, nchunks - 1);
+	return rc;
+
+serial:
+	atomic64_inc(&gss_bulk_stats.gbs_serial);
+	return fn(arg, 0, npages);
+}
+
+int gss_bulk_stats_seq_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "chunk_pages: %u\n"
+		   "serial: %lld\n"
+		   "parallel: %lld\n"
+		   "queued_chunks: %lld\n",
+		   READ_ONCE(gss_bulk_chunk_pages),
+		   (long long)atomic64_read(&gss_bulk_stats.gbs_serial),
+		   (long long)atomic64_read(&gss_bulk_stats.gbs_parallel),
+		   (long long)atomic64_read(&gss_bulk_stats.gbs_chunks));
+	return 0;
+}
+
+int __init gss_init_bulk_crypt(void)
+{
+	int i;
+
+	gss_bulk_nwqs = cfs_cpt_number(cfs_cpt_tab);
+	OBD_ALLOC_PTR_ARRAY(gss_bulk_wqs, gss_bulk_nwqs);
+	if (!gss_bulk_wqs)
+		return -ENOMEM;
+
+	for (i = 0; i < gss_bulk_nwqs; i++) {
+		struct workqueue_struct *wq;
+
+		/* writeback waits for the chunks, keep a rescuer thread */
+		wq = cfs_cpt_bind_workqueue("gss_bulk", cfs_cpt_tab,
+					    WQ_MEM_RECLAIM, i,
+					    cfs_cpt_weight(cfs_cpt_tab, i));
+		if (IS_ERR(wq)) {
+			int rc = PTR_ERR(wq);
+
+			CERROR("failed to create gss_bulk workqueue for CPT %d: rc = %d\n",
+			       i, rc);
+			gss_exit_bulk_crypt();
+			return rc;
+		}
+		gss_bulk_wqs[i] = wq;
+	}
+
+	return 0;
+}
+
+void gss_exit_bulk_crypt(void)
+{
+	int i;
+
+	if (!gss_bulk_wqs)
+		return;
+
+	for (i = 0; i < gss_bulk_nwqs; i++)
+		if (gss_bulk_wqs[i])
+			destroy_workqueue(gss_bulk_wqs[i]);
+
+	OBD_FREE_PTR_ARRAY(gss_bulk_wqs, gss_bulk_nwqs);
+	gss_bulk_wqs = NULL;
+}
@@ -343,6 +343,14 @@ int gss_svc_unwrap_bulk(struct ptlrpc_request *req,
 int gss_svc_wrap_bulk(struct ptlrpc_request *req,
                       struct ptlrpc_bulk_desc *desc);
 
+typedef int (*gss_bulk_chunk_fn_t)(void *arg, int start, int count);
+
+extern unsigned int gss_bulk_chunk_pages;
+int gss_bulk_parallel(int npages, gss_bulk_chunk_fn_t fn, void *arg);
+int gss_bulk_stats_seq_show(struct seq_file *m, void *v);
+int  __init gss_init_bulk_crypt(void);
+void gss_exit_bulk_crypt(void);
+
 /* gss_generic_token.c */
 int g_token_size(rawobj_t *mech, unsigned int body_size);
 void g_make_token_header(rawobj_t *mech, int body_size, unsigned char **buf);
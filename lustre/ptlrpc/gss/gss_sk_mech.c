@@ -627,70 +627,188 @@ __u32 gss_prep_bulk_sk(struct gss_ctx *gss_context,
 	return GSS_S_COMPLETE;
 }
 
-static __u32 sk_encrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
-			     struct ptlrpc_bulk_desc *desc, rawobj_t *cipher,
-			     int adj_nob)
+/* Bulk pages are encrypted in CTR mode with the counter carried over from
+ * one page to the next, so the counter for any page can be computed from
+ * the cipher text length of the pages before it.  This allows page ranges
+ * to be processed independently by gss_bulk_parallel(). */
+struct sk_bulk_crypt {
+	struct crypto_sync_skcipher	*sbc_tfm;
+	struct ptlrpc_bulk_desc		*sbc_desc;
+	__u8				*sbc_iv;
+};
+
+/* advance big-endian counter block \a iv by \a nblocks */
+static void sk_ctr_iv_add(__u8 *iv, int ivsize, __u64 nblocks)
+{
+	int i;
+
+	for (i = ivsize - 1; i >= 0 && nblocks != 0; i--) {
+		nblocks += iv[i];
+		iv[i] = nblocks & 0xff;
+		nblocks >>= 8;
+	}
+}
+
+static void sk_bulk_range_iv(struct sk_bulk_crypt *sbc, int start, __u8 *iv)
+{
+	int ivsize = crypto_sync_skcipher_ivsize(sbc->sbc_tfm);
+	__u64 nblocks = 0;
+	int i;
+
+	for (i = 0; i < start; i++)
+		nblocks += DIV_ROUND_UP(sbc->sbc_desc->bd_enc_vec[i].bv_len,
+					ivsize);
+
+	memcpy(iv, sbc->sbc_iv, ivsize);
+	sk_ctr_iv_add(iv, ivsize, nblocks);
+}
+
+static int sk_encrypt_bulk_range(void *arg, int start, int count)
 {
+	struct sk_bulk_crypt *sbc = arg;
+	struct ptlrpc_bulk_desc *desc = sbc->sbc_desc;
 	struct scatterlist ptxt;
 	struct scatterlist ctxt;
-	int blocksize;
+	__u8 iv[SK_IV_SIZE];
 	int i;
-	int rc;
-	int nob = 0;
-	SYNC_SKCIPHER_REQUEST_ON_STACK(req, tfm);
+	int rc = 0;
+	SYNC_SKCIPHER_REQUEST_ON_STACK(req, sbc->sbc_tfm);
 
-	blocksize = crypto_sync_skcipher_blocksize(tfm);
+	sk_bulk_range_iv(sbc, start, iv);
 
 	sg_init_table(&ptxt, 1);
 	sg_init_table(&ctxt, 1);
 
-	skcipher_request_set_sync_tfm(req, tfm);
+	skcipher_request_set_sync_tfm(req, sbc->sbc_tfm);
 	skcipher_request_set_callback(req, 0, NULL, NULL);
 
-	for (i = 0; i < desc->bd_iov_count; i++) {
+	for (i = start; i < start + count; i++) {
 		sg_set_page(&ptxt, desc->bd_vec[i].bv_page,
-			    sk_block_mask(desc->bd_vec[i].bv_len,
-					  blocksize),
+			    desc->bd_enc_vec[i].bv_len,
 			    desc->bd_vec[i].bv_offset);
-		nob += ptxt.length;
-
 		sg_set_page(&ctxt, desc->bd_enc_vec[i].bv_page,
-			    ptxt.length, ptxt.offset);
-
-		desc->bd_enc_vec[i].bv_offset = ctxt.offset;
-		desc->bd_enc_vec[i].bv_len = ctxt.length;
+			    desc->bd_enc_vec[i].bv_len,
+			    desc->bd_enc_vec[i].bv_offset);
 
 		skcipher_request_set_crypt(req, &ptxt, &ctxt, ptxt.length, iv);
 		rc = crypto_skcipher_encrypt_iv(req, &ctxt, &ptxt, ptxt.length);
 		if (rc) {
 			CERROR("failed to encrypt page: %d\n", rc);
-			skcipher_request_zero(req);
-			return rc;
+			break;
 		}
 	}
 	skcipher_request_zero(req);
 
+	return rc;
+}
+
+static __u32 sk_encrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
+			     struct ptlrpc_bulk_desc *desc, rawobj_t *cipher,
+			     int adj_nob)
+{
+	struct sk_bulk_crypt sbc = {
+		.sbc_tfm	= tfm,
+		.sbc_desc	= desc,
+		.sbc_iv		= iv,
+	};
+	int blocksize;
+	int i;
+	int rc;
+	int nob = 0;
+
+	blocksize = crypto_sync_skcipher_blocksize(tfm);
+
+	/* lay out the cipher pages first so each range can find its IV */
+	for (i = 0; i < desc->bd_iov_count; i++) {
+		desc->bd_enc_vec[i].bv_offset = desc->bd_vec[i].bv_offset;
+		desc->bd_enc_vec[i].bv_len =
+			sk_block_mask(desc->bd_vec[i].bv_len, blocksize);
+		nob += desc->bd_enc_vec[i].bv_len;
+	}
+
+	rc = gss_bulk_parallel(desc->bd_iov_count, sk_encrypt_bulk_range,
+			       &sbc);
+	if (rc)
+		return rc;
+
 	if (adj_nob)
 		desc->bd_nob = nob;
 
 	return 0;
 }
 
+static int sk_decrypt_bulk_range(void *arg, int start, int count)
+{
+	struct sk_bulk_crypt *sbc = arg;
+	struct ptlrpc_bulk_desc *desc = sbc->sbc_desc;
+	struct scatterlist ptxt;
+	struct scatterlist ctxt;
+	__u8 iv[SK_IV_SIZE];
+	int blocksize;
+	int i;
+	int rc = 0;
+	SYNC_SKCIPHER_REQUEST_ON_STACK(req, sbc->sbc_tfm);
+
+	blocksize = crypto_sync_skcipher_blocksize(sbc->sbc_tfm);
+	sk_bulk_range_iv(sbc, start, iv);
+
+	skcipher_request_set_sync_tfm(req, sbc->sbc_tfm);
+	skcipher_request_set_callback(req, 0, NULL, NULL);
+
+	for (i = start; i < start + count; i++) {
+		struct bio_vec *piov = &desc->bd_vec[i];
+		struct bio_vec *ciov = &desc->bd_enc_vec[i];
+
+		if (ciov->bv_len == 0)
+			continue;
+
+		sg_init_table(&ctxt, 1);
+		sg_set_page(&ctxt, ciov->bv_page, ciov->bv_len,
+			    ciov->bv_offset);
+		ptxt = ctxt;
+
+		/* In the event the plain text size is not a multiple
+		 * of blocksize we decrypt in place and copy the result
+		 * after the decryption */
+		if (piov->bv_len % blocksize == 0)
+			sg_assign_page(&ptxt, piov->bv_page);
+
+		skcipher_request_set_crypt(req, &ctxt, &ptxt, ptxt.length, iv);
+		rc = crypto_skcipher_decrypt_iv(req, &ptxt, &ctxt, ptxt.length);
+		if (rc) {
+			CERROR("Decryption failed for page: %d\n", rc);
+			rc = GSS_S_FAILURE;
+			break;
+		}
+
+		if (piov->bv_len % blocksize != 0) {
+			memcpy(page_address(piov->bv_page) +
+			       piov->bv_offset,
+			       page_address(ciov->bv_page) +
+			       ciov->bv_offset,
+			       piov->bv_len);
+		}
+	}
+	skcipher_request_zero(req);
+
+	return rc;
+}
+
 static __u32 sk_decrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
 			     struct ptlrpc_bulk_desc *desc, rawobj_t *cipher,
 			     int adj_nob)
 {
-	struct scatterlist ptxt;
-	struct scatterlist ctxt;
+	struct sk_bulk_crypt sbc = {
+		.sbc_tfm	= tfm,
+		.sbc_desc	= desc,
+		.sbc_iv		= iv,
+	};
 	int blocksize;
+	int npages;
 	int i;
 	int rc;
 	int pnob = 0;
 	int cnob = 0;
-	SYNC_SKCIPHER_REQUEST_ON_STACK(req, tfm);
-
-	sg_init_table(&ptxt, 1);
-	sg_init_table(&ctxt, 1);
 
 	blocksize = crypto_sync_skcipher_blocksize(tfm);
 	if (desc->bd_nob_transferred % blocksize != 0) {
@@ -699,9 +817,7 @@ static __u32 sk_decrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
 		return GSS_S_DEFECTIVE_TOKEN;
 	}
 
-	skcipher_request_set_sync_tfm(req, tfm);
-	skcipher_request_set_callback(req, 0, NULL, NULL);
-
+	/* validate and size all pages before any decryption is started */
 	for (i = 0; i < desc->bd_iov_count && cnob < desc->bd_nob_transferred;
 	     i++) {
 		struct bio_vec *piov = &desc->bd_vec[i];
@@ -710,7 +826,6 @@ static __u32 sk_decrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
 		if (ciov->bv_offset % blocksize != 0 ||
 		    ciov->bv_len % blocksize != 0) {
 			CERROR("Invalid bulk descriptor vector\n");
-			skcipher_request_zero(req);
 			return GSS_S_DEFECTIVE_TOKEN;
 		}
 
@@ -734,45 +849,14 @@ static __u32 sk_decrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
 			if (ciov->bv_len + cnob > desc->bd_nob_transferred ||
 			    piov->bv_len > ciov->bv_len) {
 				CERROR("Invalid decrypted length\n");
-				skcipher_request_zero(req);
 				return GSS_S_FAILURE;
 			}
 		}
 
-		if (ciov->bv_len == 0)
-			continue;
-
-		sg_init_table(&ctxt, 1);
-		sg_set_page(&ctxt, ciov->bv_page, ciov->bv_len,
-			    ciov->bv_offset);
-		ptxt = ctxt;
-
-		/* In the event the plain text size is not a multiple
-		 * of blocksize we decrypt in place and copy the result
-		 * after the decryption */
-		if (piov->bv_len % blocksize == 0)
-			sg_assign_page(&ptxt, piov->bv_page);
-
-		skcipher_request_set_crypt(req, &ctxt, &ptxt, ptxt.length, iv);
-		rc = crypto_skcipher_decrypt_iv(req, &ptxt, &ctxt, ptxt.length);
-		if (rc) {
-			CERROR("Decryption failed for page: %d\n", rc);
-			skcipher_request_zero(req);
-			return GSS_S_FAILURE;
-		}
-
-		if (piov->bv_len % blocksize != 0) {
-			memcpy(page_address(piov->bv_page) +
-			       piov->bv_offset,
-			       page_address(ciov->bv_page) +
-			       ciov->bv_offset,
-			       piov->bv_len);
-		}
-
 		cnob += ciov->bv_len;
 		pnob += piov->bv_len;
 	}
-	skcipher_request_zero(req);
+	npages = i;
 
 	/* if needed, clear up the rest unused iovs */
 	if (adj_nob)
@@ -791,6 +875,10 @@ static __u32 sk_decrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
 		return GSS_S_FAILURE;
 	}
 
+	rc = gss_bulk_parallel(npages, sk_decrypt_bulk_range, &sbc);
+	if (rc)
+		return rc;
+
 	return 0;
 }
 
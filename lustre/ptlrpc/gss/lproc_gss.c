@@ -157,6 +157,39 @@ sptlrpc_krb5_allow_old_client_csum_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(sptlrpc_krb5_allow_old_client_csum);
 
+static int sptlrpc_bulk_chunk_pages_seq_show(struct seq_file *m, void *data)
+{
+	seq_printf(m, "%u\n", READ_ONCE(gss_bulk_chunk_pages));
+	return 0;
+}
+
+static ssize_t
+sptlrpc_bulk_chunk_pages_seq_write(struct file *file,
+				   const char __user *buffer,
+				   size_t count, loff_t *off)
+{
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint_from_user(buffer, count, 0, &val);
+	if (rc)
+		return rc;
+
+	/* 0 disables splitting, bulk crypto is then done inline */
+	if (val > PTLRPC_MAX_BRW_PAGES)
+		return -ERANGE;
+
+	WRITE_ONCE(gss_bulk_chunk_pages, val);
+	return count;
+}
+LPROC_SEQ_FOPS(sptlrpc_bulk_chunk_pages);
+
+static int gss_proc_bulk_stats_seq_show(struct seq_file *m, void *v)
+{
+	return gss_bulk_stats_seq_show(m, v);
+}
+LDEBUGFS_SEQ_FOPS_RO(gss_proc_bulk_stats);
+
 #ifdef HAVE_GSS_KEYRING
 static int sptlrpc_gss_check_upcall_ns_seq_show(struct seq_file *m, void *data)
 {
@@ -431,6 +464,8 @@ LPROC_SEQ_FOPS_WR_ONLY(gss, rsc_info);
 static struct ldebugfs_vars gss_debugfs_vars[] = {
 	{ .name	=	"replays",
 	  .fops	=	&gss_proc_oos_fops	},
+	{ .name	=	"bulk_crypt_stats",
+	  .fops	=	&gss_proc_bulk_stats_fops	},
 	{ .name	=	"init_channel",
 	  .fops	=	&gss_proc_secinit,
 	  .proc_mode =	0200			},
@@ -440,6 +475,8 @@ static struct ldebugfs_vars gss_debugfs_vars[] = {
 static struct lprocfs_vars gss_lprocfs_vars[] = {
 	{ .name	=	"krb5_allow_old_client_csum",
 	  .fops	=	&sptlrpc_krb5_allow_old_client_csum_fops },
+	{ .name	=	"bulk_crypt_chunk_pages",
+	  .fops	=	&sptlrpc_bulk_chunk_pages_fops },
 #ifdef HAVE_GSS_KEYRING
 	{ .name	=	"gss_check_upcall_ns",
 	  .fops	=	&sptlrpc_gss_check_upcall_ns_fops },
@@ -2871,10 +2871,14 @@ static int __init sptlrpc_gss_init(void)
 	if (rc)
 		return rc;
 
-	rc = gss_init_cli_upcall();
+	rc = gss_init_bulk_crypt();
 	if (rc)
 		goto out_tunables;
 
+	rc = gss_init_cli_upcall();
+	if (rc)
+		goto out_bulk_crypt;
+
 	rc = gss_init_svc_upcall();
 	if (rc)
 		goto out_cli_upcall;
@@ -2912,6 +2916,8 @@ out_svc_upcall:
 	gss_exit_svc_upcall();
 out_cli_upcall:
 	gss_exit_cli_upcall();
+out_bulk_crypt:
+	gss_exit_bulk_crypt();
 out_tunables:
 	gss_exit_tunables();
 	return rc;
@@ -2923,6 +2929,7 @@ static void __exit sptlrpc_gss_exit(void)
 	cleanup_kerberos_module();
 	gss_exit_svc_upcall();
 	gss_exit_cli_upcall();
+	gss_exit_bulk_crypt();
 	gss_exit_tunables();
 }
 
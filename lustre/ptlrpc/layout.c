@@ -1953,6 +1953,8 @@ void req_capsule_init(struct req_capsule *pill, struct ptlrpc_request *req,
 	pill->rc_fmt = NULL;
 	pill->rc_req = req;
 	pill->rc_loc = location;
+	pill->rc_valid_req = NULL;
+	pill->rc_valid_fmt = NULL;
 	req_capsule_init_area(pill);
 
 	if (req != NULL && pill == &req->rq_pill)
@@ -2274,6 +2276,70 @@ swabber_dumper_helper(struct req_capsule *pill,
 	return rc;
 }
 
+/**
+ * Check all fixed-size request fields of \a pill's format against the
+ * request message in a single pass over its buffers.
+ *
+ * Each field that is present and large enough gets its buffer offset
+ * recorded, so that subsequent lookups of it are plain pointer arithmetic
+ * instead of a walk over lm_buflens[] per access. Fields that fail the
+ * check are left to the regular lookup path which reports the error.
+ * The result is keyed on the request, its message, XID and message length
+ * and on the format, so a request message replaced by e.g. sptlrpc unwrapping, a
+ * new request reusing the capsule or a format change is revalidated.
+ */
+static void req_capsule_validate_req(struct req_capsule *pill,
+				     const struct req_format *fmt,
+				     struct lustre_msg *msg)
+{
+	__u32 bufcount = lustre_msg_bufcount(msg);
+	__u32 offset;
+	__u32 i;
+
+	pill->rc_valid_mask = 0;
+	offset = lustre_msg_hdr_size(msg->lm_magic, bufcount);
+	for (i = 0; i < fmt->rf_fields[RCL_CLIENT].nr && i < bufcount; i++) {
+		const struct req_msg_field *field = FMT_FIELD(fmt, RCL_CLIENT,
+							      i);
+		__u32 buflen = lustre_msg_buflen(msg, i);
+		__u32 len;
+
+		pill->rc_valid_off[i] = offset;
+		offset += round_up(buflen, 8);
+
+		if (field->rmf_flags & (RMF_F_STRING | RMF_F_STRUCT_ARRAY |
+					RMF_F_NO_SIZE_CHECK))
+			continue;
+
+		if (pill->rc_area[RCL_CLIENT][i] != -1)
+			len = pill->rc_area[RCL_CLIENT][i];
+		else
+			len = max_t(typeof(field->rmf_size),
+				    field->rmf_size, 0);
+		if (buflen < len)
+			continue;
+
+		pill->rc_valid_mask |= BIT(i);
+	}
+
+	pill->rc_valid_req = pill->rc_req;
+	pill->rc_valid_msg = msg;
+	pill->rc_valid_xid = pill->rc_req->rq_xid;
+	pill->rc_valid_len = pill->rc_req->rq_reqlen;
+	pill->rc_valid_fmt = fmt;
+}
+
+static bool req_capsule_req_validated(const struct req_capsule *pill,
+				      const struct req_format *fmt)
+{
+	const struct ptlrpc_request *req = pill->rc_req;
+
+	return pill->rc_valid_req == req && pill->rc_valid_fmt == fmt &&
+	       pill->rc_valid_msg == req->rq_reqmsg &&
+	       pill->rc_valid_xid == req->rq_xid &&
+	       pill->rc_valid_len == req->rq_reqlen;
+}
+
 /**
  * Returns the pointer to a PTLRPC request or reply (\a loc) buffer of a \a pill
  * corresponding to the given RMF (\a field).
@@ -2315,6 +2381,26 @@ static void *__req_capsule_get(struct req_capsule *pill,
 	msg = __req_msg(pill, loc);
 	LASSERT(msg != NULL);
 
+	/* request on the server side is immutable, see
+	 * req_capsule_validate_req()
+	 */
+	if (loc == RCL_CLIENT && pill->rc_loc == RCL_SERVER &&
+	    pill->rc_req != NULL && msg->lm_magic == LUSTRE_MSG_MAGIC_V2) {
+		if (!req_capsule_req_validated(pill, fmt))
+			req_capsule_validate_req(pill, fmt, msg);
+
+		if (pill->rc_valid_mask & BIT(offset)) {
+			value = (char *)msg + pill->rc_valid_off[offset];
+			len = pill->rc_area[loc][offset] != -1 ?
+			      pill->rc_area[loc][offset] :
+			      max_t(typeof(field->rmf_size),
+				    field->rmf_size, 0);
+			swabber_dumper_helper(pill, field, loc, offset, value,
+					      len, dump, swabber);
+			return value;
+		}
+	}
+
 	getter = (field->rmf_flags & RMF_F_STRING) ?
 		(typeof(getter))lustre_msg_string : lustre_msg_buf;
 
@@ -2538,6 +2624,8 @@ void req_capsule_set_size(struct req_capsule *pill,
 	}
 
 	pill->rc_area[loc][__req_capsule_offset(pill, field, loc)] = size;
+	if (loc == RCL_CLIENT)
+		pill->rc_valid_fmt = NULL;
 }
 EXPORT_SYMBOL(req_capsule_set_size);
 
@@ -379,6 +379,31 @@ ptlrpc_lprocfs_req_buffers_max_seq_write(struct file *file,
 
 LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_req_buffers_max);
 
+static int
+ptlrpc_lprocfs_req_buffer_stats_seq_show(struct seq_file *m, void *n)
+{
+	struct ptlrpc_service *svc = m->private;
+	struct ptlrpc_service_part *svcpt;
+	int i;
+
+	seq_printf(m, "%-4s %8s %8s %8s %12s %12s %12s\n",
+		   "cpt", "total", "posted", "spare",
+		   "allocated", "reused", "freed");
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		spin_lock(&svcpt->scp_lock);
+		seq_printf(m, "%-4d %8d %8d %8d %12llu %12llu %12llu\n",
+			   svcpt->scp_cpt, svcpt->scp_nrqbds_total,
+			   svcpt->scp_nrqbds_posted, svcpt->scp_nrqbds_spare,
+			   svcpt->scp_rqbd_nalloc, svcpt->scp_rqbd_nreuse,
+			   svcpt->scp_rqbd_nfree);
+		spin_unlock(&svcpt->scp_lock);
+	}
+
+	return 0;
+}
+
+LDEBUGFS_SEQ_FOPS_RO(ptlrpc_lprocfs_req_buffer_stats);
+
 static ssize_t threads_min_show(struct kobject *kobj, struct attribute *attr,
 				char *buf)
 {
@@ -1137,6 +1162,35 @@ static int ptlrpc_lprocfs_timeouts_seq_show(struct seq_file *m, void *n)
 
 LDEBUGFS_SEQ_FOPS_RO(ptlrpc_lprocfs_timeouts);
 
+static int ptlrpc_lprocfs_service_time_seq_show(struct seq_file *m, void *n)
+{
+	struct ptlrpc_service *svc = m->private;
+	struct ptlrpc_service_part *svcpt;
+	timeout_t p50, p99, p999;
+	__u32 count;
+	int i;
+	int opc;
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		seq_printf(m, "cpt %d: early_replies_skipped %llu\n",
+			   svcpt->scp_cpt, svcpt->scp_at_early_skipped);
+		for (opc = 0; opc < LUSTRE_MAX_OPCODES; opc++) {
+			p50 = ptlrpc_at_opc_quantile(svcpt, opc, 500, &count);
+			if (p50 < 0)
+				continue;
+			p99 = ptlrpc_at_opc_quantile(svcpt, opc, 990, NULL);
+			p999 = ptlrpc_at_opc_quantile(svcpt, opc, 999, NULL);
+			seq_printf(m, "  %-24s samples %6u p50 %3ds p99 %3ds p99.9 %3ds\n",
+				   ll_rpc_opcode_table[opc].opname, count,
+				   p50, p99, p999);
+		}
+	}
+
+	return 0;
+}
+
+LDEBUGFS_SEQ_FOPS_RO(ptlrpc_lprocfs_service_time);
+
 static ssize_t high_priority_ratio_show(struct kobject *kobj,
 					struct attribute *attr,
 					char *buf)
@@ -1224,12 +1278,18 @@ void ptlrpc_ldebugfs_register_service(struct dentry *entry,
 		{ .name = "timeouts",
 		  .fops = &ptlrpc_lprocfs_timeouts_fops,
 		  .data = svc },
+		{ .name = "service_time",
+		  .fops = &ptlrpc_lprocfs_service_time_fops,
+		  .data = svc },
 		{ .name = "nrs_policies",
 		  .fops = &ptlrpc_lprocfs_nrs_policies_fops,
 		  .data = svc },
 		{ .name = "req_buffers_max",
 		  .fops = &ptlrpc_lprocfs_req_buffers_max_fops,
 		  .data = svc },
+		{ .name = "req_buffer_stats",
+		  .fops = &ptlrpc_lprocfs_req_buffer_stats_fops,
+		  .data = svc },
 		{ NULL }
 	};
 	static const struct file_operations req_history_fops = {
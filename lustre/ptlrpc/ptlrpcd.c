@@ -165,10 +165,25 @@ void ptlrpcd_wake(struct ptlrpc_request *req)
 }
 EXPORT_SYMBOL(ptlrpcd_wake);
 
+static struct dentry *ptlrpcd_debugfs_entry;
+
+/* # requests queued or in flight on a ptlrpcd thread */
+static inline int ptlrpcd_queue_depth(struct ptlrpcd_ctl *pc)
+{
+	struct ptlrpc_request_set *set = READ_ONCE(pc->pc_set);
+
+	if (set == NULL)
+		return INT_MAX;
+
+	return atomic_read(&set->set_new_count) +
+	       atomic_read(&set->set_remaining);
+}
+
 static struct ptlrpcd_ctl *
 ptlrpcd_select_pc(struct ptlrpc_request *req)
 {
 	struct ptlrpcd	*pd;
+	struct ptlrpcd_ctl *pc;
 	int		cpt;
 	int		idx;
 
@@ -187,8 +202,23 @@ ptlrpcd_select_pc(struct ptlrpc_request *req)
 	if (++idx == pd->pd_nthreads)
 		idx = 0;
 	pd->pd_cursor = idx;
+	pc = &pd->pd_threads[idx];
 
-	return &pd->pd_threads[idx];
+	/*
+	 * Check one partner as well and queue to the shorter of the two,
+	 * so that a thread stuck in a long interpret callback does not keep
+	 * collecting its share of new requests.
+	 */
+	if (pc->pc_npartners > 0) {
+		struct ptlrpcd_ctl *partner;
+
+		partner = pc->pc_partners[idx % pc->pc_npartners];
+		if (partner != NULL &&
+		    ptlrpcd_queue_depth(partner) < ptlrpcd_queue_depth(pc))
+			pc = partner;
+	}
+
+	return pc;
 }
 
 /**
@@ -235,24 +265,41 @@ void ptlrpcd_add_rqset(struct ptlrpc_request_set *set)
 }
 
 /**
+ * Move requests that \a partner has not started processing yet to \a pc.
+ *
+ * Only the newer half of the partner's queue is taken, one request at a
+ * time, so the partner still has work when it comes back and the two
+ * threads converge to an even load instead of trading the whole queue.
+ *
  * Return transferred RPCs count.
  */
-static int ptlrpcd_steal_rqset(struct ptlrpc_request_set *des,
+static int ptlrpcd_steal_rqset(struct ptlrpcd_ctl *pc,
+			       struct ptlrpcd_ctl *partner,
 			       struct ptlrpc_request_set *src)
 {
+	struct ptlrpc_request_set *des = pc->pc_set;
 	struct ptlrpc_request *req;
+	struct ptlrpc_request *tmp;
+	int count;
 	int rc = 0;
 
 	spin_lock(&src->set_new_req_lock);
-	if (likely(!list_empty(&src->set_new_requests))) {
-		list_for_each_entry(req, &src->set_new_requests, rq_set_chain)
-			req->rq_set = des;
+	count = DIV_ROUND_UP(atomic_read(&src->set_new_count), 2);
+	list_for_each_entry_safe_reverse(req, tmp, &src->set_new_requests,
+					 rq_set_chain) {
+		if (rc == count)
+			break;
 
-		list_splice_init(&src->set_new_requests,
-				 &des->set_requests);
-		rc = atomic_read(&src->set_new_count);
+		req->rq_set = des;
+		/* moving to the head keeps the stolen requests in order */
+		list_move(&req->rq_set_chain, &des->set_requests);
+		rc++;
+	}
+	if (rc > 0) {
+		atomic_sub(rc, &src->set_new_count);
 		atomic_add(rc, &des->set_remaining);
-		atomic_set(&src->set_new_count, 0);
+		partner->pc_nlost += rc;
+		pc->pc_nstolen += rc;
 	}
 	spin_unlock(&src->set_new_req_lock);
 	return rc;
@@ -407,7 +454,8 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 				spin_unlock(&partner->pc_lock);
 
 				if (atomic_read(&ps->set_new_count)) {
-					rc = ptlrpcd_steal_rqset(set, ps);
+					rc = ptlrpcd_steal_rqset(pc, partner,
+								 ps);
 					if (rc > 0)
 						CDEBUG(D_RPCTRACE,
 						       "transfer %d async RPCs [%d->%d]\n",
@@ -708,6 +756,32 @@ out:
 	EXIT;
 }
 
+static int ptlrpcd_stats_seq_show(struct seq_file *m, void *v)
+{
+	struct ptlrpcd_ctl *pc;
+	int i;
+	int j;
+
+	seq_printf(m, "%-16s %8s %12s %12s %12s\n",
+		   "thread", "depth", "added", "stolen", "lost");
+	for (i = 0; ptlrpcds != NULL && i < ptlrpcds_num; i++) {
+		if (ptlrpcds[i] == NULL)
+			break;
+		for (j = 0; j < ptlrpcds[i]->pd_nthreads; j++) {
+			pc = &ptlrpcds[i]->pd_threads[j];
+			if (!test_bit(LIOD_START, &pc->pc_flags))
+				continue;
+			seq_printf(m, "%-16s %8d %12llu %12llu %12llu\n",
+				   pc->pc_name, ptlrpcd_queue_depth(pc),
+				   pc->pc_nadded, pc->pc_nstolen,
+				   pc->pc_nlost);
+		}
+	}
+
+	return 0;
+}
+LDEBUGFS_SEQ_FOPS_RO(ptlrpcd_stats);
+
 static void ptlrpcd_fini(void)
 {
 	int	i;
@@ -716,6 +790,10 @@ static void ptlrpcd_fini(void)
 
 	ENTRY;
 
+	/* debugfs_remove() waits for readers of the stats to finish */
+	debugfs_remove(ptlrpcd_debugfs_entry);
+	ptlrpcd_debugfs_entry = NULL;
+
 	if (ptlrpcds != NULL) {
 		for (i = 0; i < ptlrpcds_num; i++) {
 			if (ptlrpcds[i] == NULL)
@@ -958,6 +1036,10 @@ static int ptlrpcd_init(void)
 				GOTO(out, rc);
 		}
 	}
+
+	ptlrpcd_debugfs_entry = debugfs_create_file("ptlrpcd_stats", 0444,
+						    debugfs_lustre_root, NULL,
+						    &ptlrpcd_stats_fops);
 out:
 	if (rc != 0)
 		ptlrpcd_fini();
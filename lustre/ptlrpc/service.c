@@ -62,6 +62,20 @@ MODULE_PARM_DESC(at_early_margin, "How soon before an RPC deadline to send an ea
 module_param(at_extra, int, 0644);
 MODULE_PARM_DESC(at_extra, "How much extra time to give with each early reply");
 
+/*
+ * Early replies are skipped for requests already being handled if this
+ * quantile (in 1/1000) of the service time of their opcode says they will
+ * complete before their deadline. 0 always sends early replies.
+ */
+static unsigned int at_early_quantile = 999;
+module_param(at_early_quantile, uint, 0644);
+MODULE_PARM_DESC(at_early_quantile, "Service time quantile (per mille) used to predict if an early reply is needed, 0 to always send");
+
+/* minimal # samples per opcode before its history is trusted */
+#define AT_OPC_MIN_SAMPLES	64
+/* halve the per opcode history when it reaches this many samples */
+#define AT_OPC_MAX_SAMPLES	4096
+
 /* forward ref */
 static int ptlrpc_server_post_idle_rqbds(struct ptlrpc_service_part *svcpt);
 static void ptlrpc_server_hpreq_fini(struct ptlrpc_request *req);
@@ -80,6 +94,21 @@ ptlrpc_alloc_rqbd(struct ptlrpc_service_part *svcpt)
 	struct ptlrpc_service		  *svc = svcpt->scp_service;
 	struct ptlrpc_request_buffer_desc *rqbd;
 
+	/* recycle a previously drained buffer before allocating a new one */
+	spin_lock(&svcpt->scp_lock);
+	rqbd = list_first_entry_or_null(&svcpt->scp_rqbd_spare,
+					struct ptlrpc_request_buffer_desc,
+					rqbd_list);
+	if (rqbd != NULL) {
+		list_move(&rqbd->rqbd_list, &svcpt->scp_rqbd_idle);
+		svcpt->scp_nrqbds_spare--;
+		svcpt->scp_nrqbds_total++;
+		svcpt->scp_rqbd_nreuse++;
+		spin_unlock(&svcpt->scp_lock);
+		return rqbd;
+	}
+	spin_unlock(&svcpt->scp_lock);
+
 	OBD_CPT_ALLOC_PTR(rqbd, svc->srv_cptable, svcpt->scp_cpt);
 	if (rqbd == NULL)
 		return NULL;
@@ -99,6 +128,7 @@ ptlrpc_alloc_rqbd(struct ptlrpc_service_part *svcpt)
 	spin_lock(&svcpt->scp_lock);
 	list_add(&rqbd->rqbd_list, &svcpt->scp_rqbd_idle);
 	svcpt->scp_nrqbds_total++;
+	svcpt->scp_rqbd_nalloc++;
 	spin_unlock(&svcpt->scp_lock);
 
 	return rqbd;
@@ -145,7 +175,8 @@ static int ptlrpc_grow_req_bufs(struct ptlrpc_service_part *svcpt, int post)
 		 */
 		if (svcpt->scp_nrqbds_posted >= svc->srv_nbuf_per_group ||
 		    (svc->srv_nrqbds_max != 0 &&
-		     svcpt->scp_nrqbds_total > svc->srv_nrqbds_max))
+		     svcpt->scp_nrqbds_total + svcpt->scp_nrqbds_spare >
+		     svc->srv_nrqbds_max))
 			break;
 
 		rqbd = ptlrpc_alloc_rqbd(svcpt);
@@ -620,6 +651,7 @@ static int ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	mutex_init(&svcpt->scp_mutex);
 	INIT_LIST_HEAD(&svcpt->scp_rqbd_idle);
 	INIT_LIST_HEAD(&svcpt->scp_rqbd_posted);
+	INIT_LIST_HEAD(&svcpt->scp_rqbd_spare);
 	INIT_LIST_HEAD(&svcpt->scp_req_incoming);
 	init_waitqueue_head(&svcpt->scp_waitq);
 	/* history request & rqbd list */
@@ -659,6 +691,11 @@ static int ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	if (array->paa_reqs_count == NULL)
 		goto failed;
 
+	OBD_CPT_ALLOC(svcpt->scp_at_opc_hist, svc->srv_cptable, cpt,
+		      sizeof(*svcpt->scp_at_opc_hist) * LUSTRE_MAX_OPCODES);
+	if (svcpt->scp_at_opc_hist == NULL)
+		goto failed;
+
 	cfs_timer_setup(&svcpt->scp_at_timer, ptlrpc_at_timer,
 			(unsigned long)svcpt, 0);
 
@@ -682,6 +719,11 @@ static int ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	return 0;
 
  failed:
+	if (svcpt->scp_at_opc_hist != NULL) {
+		OBD_FREE_PTR_ARRAY(svcpt->scp_at_opc_hist, LUSTRE_MAX_OPCODES);
+		svcpt->scp_at_opc_hist = NULL;
+	}
+
 	if (array->paa_reqs_count != NULL) {
 		OBD_FREE_PTR_ARRAY(array->paa_reqs_count, size);
 		array->paa_reqs_count = NULL;
@@ -987,11 +1029,29 @@ void ptlrpc_server_drop_request(struct ptlrpc_request *req)
 			    (svc->srv_nrqbds_max != 0 &&
 			     svcpt->scp_nrqbds_total > svc->srv_nrqbds_max) ||
 			    test_req_buffer_pressure) {
-				/* like in ptlrpc_free_rqbd() */
 				svcpt->scp_nrqbds_total--;
-				OBD_FREE_LARGE(rqbd->rqbd_buffer,
-					       svc->srv_buf_size);
-				OBD_FREE_PTR(rqbd);
+				/* spare buffers count against req_buffers_max */
+				if (!test_req_buffer_pressure &&
+				    svcpt->scp_nrqbds_spare <
+				    svc->srv_nbuf_per_group &&
+				    (svc->srv_nrqbds_max == 0 ||
+				     svcpt->scp_nrqbds_total +
+				     svcpt->scp_nrqbds_spare <
+				     svc->srv_nrqbds_max)) {
+					/*
+					 * keep it aside so the next burst
+					 * does not have to allocate again
+					 */
+					list_add(&rqbd->rqbd_list,
+						 &svcpt->scp_rqbd_spare);
+					svcpt->scp_nrqbds_spare++;
+				} else {
+					/* like in ptlrpc_free_rqbd() */
+					svcpt->scp_rqbd_nfree++;
+					OBD_FREE_LARGE(rqbd->rqbd_buffer,
+						       svc->srv_buf_size);
+					OBD_FREE_PTR(rqbd);
+				}
 			} else {
 				list_add_tail(&rqbd->rqbd_list,
 					      &svcpt->scp_rqbd_idle);
@@ -1353,6 +1413,122 @@ static void ptlrpc_at_remove_timed(struct ptlrpc_request *req)
 	array->paa_count--;
 }
 
+/**
+ * Account the service time of a request in the history of its opcode.
+ */
+static void ptlrpc_at_opc_record(struct ptlrpc_service_part *svcpt,
+				 __u32 op, s64 usecs)
+{
+	struct ptlrpc_at_opc_hist *hist;
+	int opc = opcode_offset(op);
+	int bin;
+	int i;
+
+	if (opc < 0 || opc >= LUSTRE_MAX_OPCODES)
+		return;
+
+	bin = min_t(int, fls64(div_u64(usecs, USEC_PER_MSEC)),
+		    AT_OPC_BINS - 1);
+
+	spin_lock(&svcpt->scp_at_lock);
+	hist = &svcpt->scp_at_opc_hist[opc];
+	hist->aoh_bins[bin]++;
+	if (++hist->aoh_count >= AT_OPC_MAX_SAMPLES) {
+		/* age the history so it follows changes in server load */
+		hist->aoh_count = 0;
+		for (i = 0; i < AT_OPC_BINS; i++) {
+			hist->aoh_bins[i] >>= 1;
+			hist->aoh_count += hist->aoh_bins[i];
+		}
+	}
+	spin_unlock(&svcpt->scp_at_lock);
+}
+
+/**
+ * Return the \a permille quantile of the service time of opcode index
+ * \a opc in seconds, rounded up, or -1 if there are too few samples to
+ * tell. The number of samples is returned in \a count if not NULL.
+ */
+timeout_t ptlrpc_at_opc_quantile(struct ptlrpc_service_part *svcpt,
+				 int opc, unsigned int permille, __u32 *count)
+{
+	struct ptlrpc_at_opc_hist *hist = &svcpt->scp_at_opc_hist[opc];
+	__u64 target;
+	__u64 sum = 0;
+	int bin;
+
+	spin_lock(&svcpt->scp_at_lock);
+	if (count)
+		*count = hist->aoh_count;
+	if (hist->aoh_count < AT_OPC_MIN_SAMPLES) {
+		spin_unlock(&svcpt->scp_at_lock);
+		return -1;
+	}
+
+	target = DIV_ROUND_UP((__u64)hist->aoh_count * permille, 1000);
+	for (bin = 0; bin < AT_OPC_BINS - 1; bin++) {
+		sum += hist->aoh_bins[bin];
+		if (sum >= target)
+			break;
+	}
+	spin_unlock(&svcpt->scp_at_lock);
+
+	/* upper bound of the bin, the last bin is open ended */
+	if (bin == AT_OPC_BINS - 1)
+		return obd_get_at_max(NULL);
+
+	return DIV_ROUND_UP(1U << bin, MSEC_PER_SEC);
+}
+
+/**
+ * Decide whether \a req is at risk of missing its deadline.
+ *
+ * Requests that are still queued are always at risk as the queue wait is
+ * unknown. For requests being handled, the configured quantile of the
+ * service time of that opcode is used as an upper bound of their total
+ * service time. A request already handled for longer than that is stuck
+ * and at risk too. Otherwise \a req is rechecked when it is expected to
+ * complete, see ptlrpc_at_check_timed().
+ */
+static bool ptlrpc_at_need_early_reply(struct ptlrpc_request *req)
+{
+	struct ptlrpc_service_part *svcpt = req->rq_rqbd->rqbd_svcpt;
+	unsigned int permille = READ_ONCE(at_early_quantile);
+	time64_t now = ktime_get_real_seconds();
+	time64_t start = req->rq_srv.sr_work_start;
+	timeout_t est;
+	int opc;
+
+	req->rq_srv.sr_at_recheck = 0;
+	if (permille == 0 || permille > 1000)
+		return true;
+
+	if (req->rq_phase != RQ_PHASE_INTERPRET)
+		return true;
+
+	if (lustre_msg_get_flags(req->rq_reqmsg) &
+	    (MSG_REPLAY | MSG_REQ_REPLAY_DONE | MSG_LOCK_REPLAY_DONE))
+		return true;
+
+	opc = opcode_offset(lustre_msg_get_opc(req->rq_reqmsg));
+	if (opc < 0 || opc >= LUSTRE_MAX_OPCODES)
+		return true;
+
+	est = ptlrpc_at_opc_quantile(svcpt, opc, permille, NULL);
+	if (est < 0 || now - start >= est || start + est >= req->rq_deadline)
+		return true;
+
+	req->rq_srv.sr_at_recheck = max(start + est, now + 1);
+
+	DEBUG_REQ(D_ADAPTTO, req,
+		  "expected to complete within %ds, skip early reply", est);
+	spin_lock(&svcpt->scp_at_lock);
+	svcpt->scp_at_early_skipped++;
+	spin_unlock(&svcpt->scp_at_lock);
+
+	return false;
+}
+
 /*
  * Attempt to extend the request deadline by sending an early reply to the
  * client.
@@ -1546,6 +1722,9 @@ static int ptlrpc_at_check_timed(struct ptlrpc_service_part *svcpt)
 	LIST_HEAD(work_list);
 	__u32 index, count;
 	time64_t deadline;
+	time64_t next_due;
+	time64_t recheck;
+	time64_t wake;
 	time64_t now = ktime_get_real_seconds();
 	s64 delay_ms;
 	int first, counter = 0;
@@ -1578,6 +1757,8 @@ static int ptlrpc_at_check_timed(struct ptlrpc_service_part *svcpt)
 	 * server will take. Send early replies to everyone expiring soon.
 	 */
 	deadline = -1;
+	next_due = -1;
+	recheck = -1;
 	div_u64_rem(array->paa_deadline, array->paa_size, &index);
 	count = array->paa_count;
 	while (count > 0) {
@@ -1590,9 +1771,23 @@ static int ptlrpc_at_check_timed(struct ptlrpc_service_part *svcpt)
 				if (deadline == -1 ||
 				    rq->rq_deadline < deadline)
 					deadline = rq->rq_deadline;
+				if (next_due == -1 ||
+				    rq->rq_deadline < next_due)
+					next_due = rq->rq_deadline;
 				break;
 			}
 
+			/* expected to complete in time, leave it till then */
+			if (rq->rq_srv.sr_at_recheck > now) {
+				if (deadline == -1 ||
+				    rq->rq_deadline < deadline)
+					deadline = rq->rq_deadline;
+				if (recheck == -1 ||
+				    rq->rq_srv.sr_at_recheck < recheck)
+					recheck = rq->rq_srv.sr_at_recheck;
+				continue;
+			}
+
 			/**
 			 * ptlrpc_server_drop_request() may drop
 			 * refcount to 0 already. Let's check this and
@@ -1612,8 +1807,23 @@ static int ptlrpc_at_check_timed(struct ptlrpc_service_part *svcpt)
 			index = 0;
 	}
 	array->paa_deadline = deadline;
-	/* we have a new earliest deadline, restart the timer */
-	ptlrpc_at_set_timer(svcpt);
+	/*
+	 * We have a new earliest deadline, restart the timer. Skipped
+	 * requests are still counted in paa_deadline, so it may be due
+	 * already, never arm the timer before their recheck time then.
+	 */
+	wake = next_due == -1 ? -1 : next_due - at_early_margin;
+	if (recheck != -1 && (wake == -1 || recheck < wake))
+		wake = recheck;
+	if (array->paa_count == 0 || wake == -1) {
+		ptlrpc_at_set_timer(svcpt);
+	} else {
+		wake = max(wake, now + 1);
+		mod_timer(&svcpt->scp_at_timer, jiffies +
+			  nsecs_to_jiffies((wake - now) * NSEC_PER_SEC));
+		CDEBUG(D_INFO, "armed %s at %+llds\n",
+		       svcpt->scp_service->srv_name, wake - now);
+	}
 
 	spin_unlock(&svcpt->scp_at_lock);
 
@@ -1644,7 +1854,9 @@ static int ptlrpc_at_check_timed(struct ptlrpc_service_part *svcpt)
 					      rq_timed_list)) != NULL) {
 		list_del_init(&rq->rq_timed_list);
 
-		if (ptlrpc_at_send_early_reply(rq) == 0)
+		/* a skipped request stays timed to be checked again later */
+		if (!ptlrpc_at_need_early_reply(rq) ||
+		    ptlrpc_at_send_early_reply(rq) == 0)
 			ptlrpc_at_add_timed(rq);
 
 		ptlrpc_server_drop_request(rq);
@@ -2294,6 +2506,7 @@ static int ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 		libcfs_debug_dumplog();
 
 	work_start = ktime_get_real();
+	request->rq_srv.sr_work_start = ktime_divns(work_start, NSEC_PER_SEC);
 	arrived = timespec64_to_ktime(request->rq_arrival_time);
 	timediff_usecs = ktime_us_delta(work_start, arrived);
 	if (unlikely(timediff_usecs < 0))
@@ -2394,6 +2607,8 @@ put_conn:
 	       request->rq_status,
 	       (request->rq_repmsg ?
 	       lustre_msg_get_status(request->rq_repmsg) : -999));
+	if (likely(request->rq_reqmsg != NULL))
+		ptlrpc_at_opc_record(svcpt, op, timediff_usecs);
 	if (likely(svc->srv_stats != NULL && request->rq_reqmsg != NULL)) {
 		int opc = opcode_offset(op);
 
@@ -3595,6 +3810,17 @@ ptlrpc_service_purge_all(struct ptlrpc_service *svc)
 			ptlrpc_free_rqbd(rqbd);
 			spin_lock(&svcpt->scp_lock);
 		}
+		while ((rqbd = list_first_entry_or_null(&svcpt->scp_rqbd_spare,
+							struct ptlrpc_request_buffer_desc,
+							rqbd_list)) != NULL) {
+			list_del(&rqbd->rqbd_list);
+			svcpt->scp_nrqbds_spare--;
+			spin_unlock(&svcpt->scp_lock);
+
+			ptlrpc_free_rqbd(rqbd);
+			spin_lock(&svcpt->scp_lock);
+		}
+		LASSERT(svcpt->scp_nrqbds_spare == 0);
 		spin_unlock(&svcpt->scp_lock);
 
 		ptlrpc_wait_replies(svcpt);
@@ -3634,6 +3860,12 @@ ptlrpc_service_free(struct ptlrpc_service *svc)
 					   array->paa_size);
 			array->paa_reqs_count = NULL;
 		}
+
+		if (svcpt->scp_at_opc_hist != NULL) {
+			OBD_FREE_PTR_ARRAY(svcpt->scp_at_opc_hist,
+					   LUSTRE_MAX_OPCODES);
+			svcpt->scp_at_opc_hist = NULL;
+		}
 	}
 
 	ptlrpc_service_for_each_part(svcpt, i, svc)
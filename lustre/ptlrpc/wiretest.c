@@ -703,6 +703,8 @@ void lustre_assert_wire_constants(void)
 		(unsigned)LUDA_TYPE);
 	LASSERTF(LUDA_64BITHASH == 0x00000004UL, "found 0x%.8xUL\n",
 		(unsigned)LUDA_64BITHASH);
+	LASSERTF(LUDA_ATTRS == 0x00000008UL, "found 0x%.8xUL\n",
+		(unsigned)LUDA_ATTRS);
 
 	/* Checks for struct luda_type */
 	LASSERTF((int)sizeof(struct luda_type) == 2, "found %lld\n",
@@ -712,6 +714,58 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct luda_type *)0)->lt_type) == 2, "found %lld\n",
 		 (long long)(int)sizeof(((struct luda_type *)0)->lt_type));
 
+	/* Checks for struct luda_attrs */
+	LASSERTF((int)sizeof(struct luda_attrs) == 72, "found %lld\n",
+		 (long long)(int)sizeof(struct luda_attrs));
+	LASSERTF((int)offsetof(struct luda_attrs, lat_valid) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lat_valid));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lat_valid) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lat_valid));
+	LASSERTF((int)offsetof(struct luda_attrs, lat_size) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lat_size));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lat_size) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lat_size));
+	LASSERTF((int)offsetof(struct luda_attrs, lat_blocks) == 16, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lat_blocks));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lat_blocks) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lat_blocks));
+	LASSERTF((int)offsetof(struct luda_attrs, lat_mtime) == 24, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lat_mtime));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lat_mtime) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lat_mtime));
+	LASSERTF((int)offsetof(struct luda_attrs, lat_atime) == 32, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lat_atime));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lat_atime) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lat_atime));
+	LASSERTF((int)offsetof(struct luda_attrs, lat_ctime) == 40, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lat_ctime));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lat_ctime) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lat_ctime));
+	LASSERTF((int)offsetof(struct luda_attrs, lat_mode) == 48, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lat_mode));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lat_mode) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lat_mode));
+	LASSERTF((int)offsetof(struct luda_attrs, lat_uid) == 52, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lat_uid));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lat_uid) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lat_uid));
+	LASSERTF((int)offsetof(struct luda_attrs, lat_gid) == 56, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lat_gid));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lat_gid) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lat_gid));
+	LASSERTF((int)offsetof(struct luda_attrs, lat_nlink) == 60, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lat_nlink));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lat_nlink) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lat_nlink));
+	LASSERTF((int)offsetof(struct luda_attrs, lat_flags) == 64, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lat_flags));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lat_flags) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lat_flags));
+	LASSERTF((int)offsetof(struct luda_attrs, lat_padding) == 68, "found %lld\n",
+		 (long long)(int)offsetof(struct luda_attrs, lat_padding));
+	LASSERTF((int)sizeof(((struct luda_attrs *)0)->lat_padding) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct luda_attrs *)0)->lat_padding));
+
 	/* Checks for struct lu_dirpage */
 	LASSERTF((int)sizeof(struct lu_dirpage) == 24, "found %lld\n",
 		 (long long)(int)sizeof(struct lu_dirpage));
@@ -1471,6 +1525,8 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT2_MIRROR_ID_FIX);
 	LASSERTF(OBD_CONNECT2_UPDATE_LAYOUT == 0x4000000000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT2_UPDATE_LAYOUT);
+	LASSERTF(OBD_CONNECT2_READDIR_PLUS == 0x8000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_READDIR_PLUS);
 
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
@@ -81,6 +81,33 @@ static char *get_file_name(const char *dirpath, const char *basename, long n)
 	return filename;
 }
 
+static int ll_read_file(const char *filename)
+{
+	char buf[65536];
+	ssize_t bytes;
+	int rc = 0;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		rc = -errno;
+		fprintf(stderr, "%s: open(%s) failed: rc = %d\n",
+			progname, filename, rc);
+		return rc;
+	}
+
+	while ((bytes = read(fd, buf, sizeof(buf))) > 0)
+		;
+	if (bytes < 0) {
+		rc = -errno;
+		fprintf(stderr, "%s: read(%s) failed: rc = %d\n",
+			progname, filename, rc);
+	}
+
+	close(fd);
+	return rc;
+}
+
 static int ll_batch_io_by_name(const char *dirpath, const char *fname,
 			       enum lu_access_flags flags, __u64 start,
 			       __u64 end)
@@ -103,6 +130,11 @@ static int ll_batch_io_by_name(const char *dirpath, const char *fname,
 				break;
 			}
 		}
+		if (flags & ACCESS_FL_READ) {
+			rc = ll_read_file(filename);
+			if (rc < 0)
+				break;
+		}
 	}
 
 	return rc;
@@ -255,7 +287,10 @@ int main(int argc, char **argv)
 			return -EINVAL;
 		}
 
-		if (flags != ACCESS_FL_STAT) {
+		/* the files may be read as well, after their stat() */
+		if (!(flags & ACCESS_FL_STAT) ||
+		    (flags & ~(ACCESS_FL_STAT | ACCESS_FL_READ)) ||
+		    ((flags & ACCESS_FL_READ) && has_advise)) {
 			fprintf(stderr, "%s: only support stat-ahead\n",
 				progname);
 			return -EINVAL;
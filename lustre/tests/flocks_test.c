@@ -853,10 +853,136 @@ static int t6(int argc, char *argv[])
 	return rc;
 }
 
+/*
+ * test number 7
+ * lock ring: every process holds byte i and then asks for byte i + 1, so
+ * each round builds a wait-for cycle through all of them that the server
+ * has to resolve with EDEADLK
+ */
+static int t7_child(const char *path, int idx, int nprocs, int iters,
+		    int *deadlocks)
+{
+	struct flock lock = {
+		.l_whence = SEEK_SET,
+		.l_len = 1,
+	};
+	int fd, i, rc = 0;
+
+	fd = open(path, O_RDWR);
+	if (fd < 0) {
+		fprintf(stderr, "%d: couldn't open file %s: %s\n",
+			getpid(), path, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < iters; i++) {
+		lock.l_type = F_WRLCK;
+		lock.l_start = idx;
+		if (fcntl(fd, F_SETLKW, &lock) < 0) {
+			fprintf(stderr, "%d: lock %d: %s\n",
+				getpid(), idx, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+
+		lock.l_start = (idx + 1) % nprocs;
+		if (fcntl(fd, F_SETLKW, &lock) < 0) {
+			if (errno != EDEADLK) {
+				fprintf(stderr, "%d: lock %d: %s\n",
+					getpid(), (idx + 1) % nprocs,
+					strerror(errno));
+				rc = EXIT_FAILURE;
+				break;
+			}
+			(*deadlocks)++;
+		}
+
+		lock.l_type = F_UNLCK;
+		lock.l_start = 0;
+		lock.l_len = 0;
+		fcntl(fd, F_SETLK, &lock);
+		lock.l_len = 1;
+	}
+	close(fd);
+
+	return rc;
+}
+
+static int t7(int argc, char *argv[])
+{
+	int nprocs, iters, i, status;
+	int rc = EXIT_SUCCESS;
+	double stime, elapsed;
+	pid_t *pids;
+	int fd;
+
+	if (argc != 5) {
+		fprintf(stderr,
+			"usage: flocks_test 7 nprocs iterations file\n");
+		return EXIT_FAILURE;
+	}
+
+	nprocs = atoi(argv[2]);
+	iters = atoi(argv[3]);
+	if (nprocs < 2 || iters < 1) {
+		fprintf(stderr, "need at least 2 processes and 1 iteration\n");
+		return EXIT_FAILURE;
+	}
+
+	fd = open(argv[4], O_RDWR | O_CREAT, 0666);
+	if (fd < 0) {
+		fprintf(stderr, "couldn't open file %s: %s\n",
+			argv[4], strerror(errno));
+		return EXIT_FAILURE;
+	}
+	close(fd);
+
+	pids = calloc(nprocs, sizeof(*pids));
+	if (!pids)
+		return EXIT_FAILURE;
+
+	stime = now();
+	for (i = 0; i < nprocs; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			perror("fork");
+			rc = EXIT_FAILURE;
+			break;
+		}
+		if (pids[i] == 0) {
+			int deadlocks = 0;
+
+			rc = t7_child(argv[4], i, nprocs, iters, &deadlocks);
+			printf("%d: %d deadlocks in %d rounds\n",
+			       getpid(), deadlocks, iters);
+			exit(rc);
+		}
+	}
+
+	while (--i >= 0) {
+		if (waitpid(pids[i], &status, 0) < 0 ||
+		    !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			rc = EXIT_FAILURE;
+	}
+	elapsed = now() - stime;
+	free(pids);
+
+	printf("%d processes, %d rounds: %.03lfs, %.0lf locks/s\n",
+	       nprocs, iters, elapsed, 2.0 * nprocs * iters / elapsed);
+	return rc;
+}
+
 static void usage(void)
 {
 	fprintf(stderr,
-		"usage: flocks_test test# [corresponding arguments]\n");
+		"usage: flocks_test test# [corresponding arguments]\n"
+		"       1 {on|off} {-c|-f|-l} file: flock mount option\n"
+		"       2 dir: 2 threads flock ops interweave\n"
+		"       3 file: conflicting flocks from one process\n"
+		"       4 file1 file2: fcntl deadlock detection\n"
+		"       5 {set|get|unlock} [read|write] [sleep N] file\n"
+		"       6 file: locks read as commands from stdin\n"
+		"       7 nprocs iterations file: deadlock detection ring\n");
 }
 
 /* program entry */
@@ -888,6 +1014,9 @@ int main(int argc, char *argv[])
 	case 6:
 		rc = t6(argc, argv);
 		break;
+	case 7:
+		rc = t7(argc, argv);
+		break;
 	default:
 		fprintf(stderr, "unknown test number '%s'\n", argv[1]);
 		break;
@@ -110,6 +110,12 @@ test_5d() {
 }
 run_test 5d "Enqueue 20k same range flocks, then expand them"
 
+test_5e() {
+	flocks_test 7 64 200 $DIR/$tfile || error "flock ring failed"
+	rm -f $DIR/$tfile
+}
+run_test 5e "resolve flock deadlock rings of 64 processes"
+
 complete_test $SECONDS
 check_and_cleanup_lustre
 exit_status
@@ -4388,6 +4388,106 @@ test_203() {
 }
 run_test 203 "Verify attach/hit bytes statistics data"
 
+test_204() {
+	local loopfile="$TMP/$tfile"
+	local mntpt="/mnt/pcc.$tdir"
+	local hsm_root="$mntpt/$tdir"
+	local file=$DIR/$tdir/$tfile
+	local -a lpcc_path
+
+	$LCTL get_param -n llite.*.pcc_max_cached_mb > /dev/null 2>&1 ||
+		skip "client does not support pcc_max_cached_mb"
+
+	setup_loopdev $SINGLEAGT $loopfile $mntpt 60
+	do_facet $SINGLEAGT mkdir $hsm_root || error "mkdir $hsm_root failed"
+	setup_pcc_mapping $SINGLEAGT \
+		"projid={0}\ roid=$HSM_ARCHIVE_NUMBER\ pccro=1"
+	$LCTL pcc list $MOUNT
+	mkdir_on_mdt0 $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+
+	local i
+
+	for i in {1..4}; do
+		do_facet $SINGLEAGT dd if=/dev/zero of=$file.$i bs=1M count=8 ||
+			error "write $file.$i failed"
+		do_facet $SINGLEAGT $LFS pcc attach -r -i $HSM_ARCHIVE_NUMBER \
+			$file.$i || error "attach $file.$i failed"
+		check_lpcc_state $file.$i "readonly"
+		lpcc_path[$i]=$(lpcc_fid2path $hsm_root $file.$i)
+	done
+
+	# keep the last file hot
+	do_facet $SINGLEAGT cat $file.4 > /dev/null
+	clear_stats llite.*.stats
+	stack_trap "do_facet $SINGLEAGT $LCTL set_param llite.*.pcc_max_cached_mb=0"
+	do_facet $SINGLEAGT $LCTL set_param llite.*.pcc_max_cached_mb=20
+	sleep 3
+
+	local evicted=$(calc_stats llite.*.stats pcc_evict)
+
+	echo "evicted: $evicted"
+	(( evicted >= 2 )) || error "evicted $evicted files, expected 2"
+	check_lpcc_state $file.1 "none"
+	check_lpcc_state $file.2 "none"
+	check_lpcc_state $file.4 "readonly"
+	do_facet $SINGLEAGT "[[ ! -e ${lpcc_path[1]} ]]" ||
+		error "PCC copy ${lpcc_path[1]} is not removed"
+}
+run_test 204 "Evict the least recently used PCC copies over pcc_max_cached_mb"
+
+test_205() {
+	local loopfile="$TMP/$tfile"
+	local mntpt="/mnt/pcc.$tdir"
+	local hsm_root="$mntpt/$tdir"
+	local file=$DIR/$tdir/$tfile
+	local lpcc_path
+
+	$LCTL get_param -n llite.*.pcc_writeback_delay > /dev/null 2>&1 ||
+		skip "client does not support pcc_writeback_delay"
+
+	setup_loopdev $SINGLEAGT $loopfile $mntpt 50
+	copytool setup -m "$MOUNT" -a "$HSM_ARCHIVE_NUMBER"
+	setup_pcc_mapping $SINGLEAGT \
+		"projid={100}\ rwid=$HSM_ARCHIVE_NUMBER\ pccrw=1"
+	do_facet $SINGLEAGT $LFS mkdir -i0 -c1 $DIR/$tdir
+
+	do_facet $SINGLEAGT "echo -n attach_origin > $file"
+	do_facet $SINGLEAGT $LFS pcc attach -w -i $HSM_ARCHIVE_NUMBER $file ||
+		error "pcc attach $file failed"
+	lpcc_path=$(lpcc_fid2path $hsm_root $file)
+
+	# the PCC-RW copy holds the only data, it must not be evicted
+	do_facet $SINGLEAGT dd if=/dev/zero of=$file bs=1M count=4 ||
+		error "write $file failed"
+	stack_trap "do_facet $SINGLEAGT $LCTL set_param llite.*.pcc_max_cached_mb=0"
+	do_facet $SINGLEAGT $LCTL set_param llite.*.pcc_max_cached_mb=1
+	sleep 3
+	check_lpcc_state $file "readwrite"
+	do_facet $SINGLEAGT $LCTL set_param llite.*.pcc_max_cached_mb=0
+
+	do_facet $SINGLEAGT "echo -n writeback_data > $file"
+	check_lpcc_state $file "readwrite"
+	# HSM released exists archived status
+	check_hsm_flags $file "0x0000000d"
+
+	clear_stats llite.*.stats
+	stack_trap "do_facet $SINGLEAGT $LCTL set_param llite.*.pcc_writeback_delay=0"
+	do_facet $SINGLEAGT $LCTL set_param llite.*.pcc_writeback_delay=2
+	wait_request_state $(path2fid $file) RESTORE SUCCEED
+	check_lpcc_state $file "none"
+	# a later flusher pass sees the restore done and removes the PCC copy
+	wait_request_state $(path2fid $file) REMOVE SUCCEED
+
+	local writebacks=$(calc_stats llite.*.stats pcc_writeback)
+
+	(( writebacks == 1 )) || error "wrong writeback number: $writebacks"
+	check_hsm_flags $file "0x00000001"
+	do_facet $SINGLEAGT "[[ ! -e $lpcc_path ]]" ||
+		error "PCC copy $lpcc_path is not removed"
+	check_file_data $SINGLEAGT $file "writeback_data"
+}
+run_test 205 "Write back idle PCC-RW files into Lustre"
+
 complete_test $SECONDS
 check_and_cleanup_lustre
 exit_status
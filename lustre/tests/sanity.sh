@@ -11535,6 +11535,43 @@ test_76b() {
 }
 run_test 76b "confirm clients recycle directory inodes properly ===="
 
+test_76c() {
+	$LCTL get_param -n llite.*.dir_miss_lock >/dev/null 2>&1 ||
+		skip "client does not support dir_miss_lock"
+
+	local miss_lock=$($LCTL get_param -n llite.*.dir_miss_lock | head -n1)
+
+	stack_trap "$LCTL set_param llite.*.dir_miss_lock=$miss_lock"
+	$LCTL set_param llite.*.dir_miss_lock=1
+
+	test_mkdir -i 0 -c 1 $DIR/$tdir || error "mkdir $tdir failed"
+	cancel_lru_locks mdc
+
+	# the first miss is remembered, the second one locks the directory
+	stat $DIR/$tdir/missing 2>/dev/null && error "missing name found"
+	stat $DIR/$tdir/missing 2>/dev/null && error "missing name found"
+
+	local locks=$(calc_stats llite.*.stats dir_miss_lock)
+
+	(( locks > 0 )) || error "directory not locked on repeated miss"
+
+	$LCTL set_param mdc.*.stats=clear
+	for i in {1..10}; do
+		stat $DIR/$tdir/missing 2>/dev/null &&
+			error "missing name found"
+	done
+
+	local rpcs=$(calc_stats mdc.*.stats ldlm_ibits_enqueue)
+
+	echo "lookup RPCs for cached misses: $rpcs"
+	(( rpcs == 0 )) || error "$rpcs lookup RPCs for a cached miss"
+
+	# the negative dentry goes away with the directory lock
+	touch $DIR/$tdir/missing || error "create missing failed"
+	stat $DIR/$tdir/missing || error "created name not found"
+}
+run_test 76c "cache negative dentries of repeatedly missed names"
+
 export ORIG_CSUM=""
 set_checksums()
 {
@@ -12685,6 +12722,100 @@ test_101m()
 }
 run_test 101m "read ahead for small file and last stripe of the file"
 
+ra_misses_101n() {
+	local file=$1
+	local streams=$2
+	local half=$((32 * 1048576))
+	local cmd="o"
+	local i
+
+	for ((i = 0; i < 32; i++)); do
+		cmd+="z$((i * 1048576))r1048576z$((half + i * 1048576))r1048576"
+	done
+	cmd+="c"
+
+	$LCTL set_param -n llite.*.read_ahead_streams=$streams
+	$LCTL set_param -n llite.*.read_ahead_stats=0
+	$LCTL set_param -n llite.*.read_ahead_stream_stats=0
+	cancel_lru_locks osc
+	$MULTIOP $file $cmd > /dev/null || error "failed to read $file"
+
+	$LCTL get_param llite.*.read_ahead_stats \
+		llite.*.read_ahead_stream_stats >&2
+	$LCTL get_param -n llite.*.read_ahead_stats |
+		get_named_value 'misses' | calc_sum
+}
+
+test_101n() {
+	local file=$DIR/$tfile
+	local streams
+	local single
+	local multi
+	local hits
+
+	streams=$($LCTL get_param -n llite.*.read_ahead_streams | head -n1)
+	[[ -n "$streams" ]] || skip "no read_ahead_streams on client"
+	stack_trap "$LCTL set_param -n llite.*.read_ahead_streams=$streams"
+
+	$LFS setstripe -c 1 -S 4M $file || error "setstripe $file failed"
+	dd if=/dev/zero of=$file bs=1M count=64 || error "dd $file failed"
+
+	single=$(ra_misses_101n $file 1)
+	multi=$(ra_misses_101n $file 2)
+	hits=$($LCTL get_param -n llite.*.read_ahead_stream_stats |
+	       get_named_value 'stream1_hits' | calc_sum)
+	echo "misses single stream: $single, two streams: $multi"
+
+	(( ${hits:-0} > 0 )) || error "second stream had no read-ahead hit"
+	(( multi < single )) ||
+		error "two streams missed $multi pages, single stream $single"
+}
+run_test 101n "interleaved sequential readers of one fd use own streams"
+
+test_101o() {
+	local file=$DIR/$tfile
+	local cache_limit=32
+	local max_cached_mb
+	local used_mb
+	local hits
+	local sum
+
+	max_cached_mb=$($LCTL get_param llite.*.max_cached_mb |
+			awk '/^max_cached_mb/ { print $2 }' | head -n1)
+	stack_trap "$LCTL set_param -n llite.*.max_cached_mb=$max_cached_mb"
+
+	$LFS setstripe -c 1 -S 4M $file || error "setstripe $file failed"
+	dd if=/dev/urandom of=$file bs=1M count=128 ||
+		error "dd $file failed"
+	sum=$(md5sum < $file)
+
+	# read-ahead takes the LRU slots of a whole RPC at once, make the
+	# cache small enough that it runs out of slots during the read
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.max_cached_mb=$cache_limit
+	$LCTL set_param -n llite.*.read_ahead_stats=0
+	[[ "$(dd if=$file bs=4k 2>/dev/null | md5sum)" == "$sum" ]] ||
+		error "$file read through read-ahead differs"
+
+	$LCTL get_param llite.*.read_ahead_stats llite.*.max_cached_mb
+	hits=$($LCTL get_param -n llite.*.read_ahead_stats |
+	       get_named_value 'hits' | calc_sum)
+	(( ${hits:-0} > 0 )) || error "no read-ahead hits"
+
+	used_mb=$($LCTL get_param llite.*.max_cached_mb |
+		  awk '/^used_mb/ { print $2 }' | head -n1)
+	(( used_mb <= cache_limit )) ||
+		error "used $used_mb MiB of cache, limit $cache_limit MiB"
+
+	# the slots read-ahead reserved but did not use must be returned
+	cancel_lru_locks osc
+	used_mb=$($LCTL get_param llite.*.max_cached_mb |
+		  awk '/^used_mb/ { print $2 }' | head -n1)
+	(( used_mb == 0 )) ||
+		error "$used_mb MiB of LRU slots leaked by read-ahead"
+}
+run_test 101o "read-ahead returns unused LRU slots with a small cache"
+
 setup_test102() {
 	test_mkdir $DIR/$tdir
 	chown $RUNAS_ID $DIR/$tdir
@@ -13275,6 +13406,41 @@ test_102t() {
 }
 run_test 102t "zero length xattr values handled correctly"
 
+test_102u() {
+	$LCTL get_param -n llite.*.xattr_cache_max_mb > /dev/null ||
+		skip "client does not cap the xattr cache"
+
+	local save="$TMP/$TESTSUITE-$TESTNAME.parameters"
+	local file=$DIR/$tdir/$tfile
+	local i
+
+	save_lustre_params client "llite.*.xattr_cache" > $save
+	save_lustre_params client "llite.*.xattr_cache_max_mb" >> $save
+	stack_trap "restore_lustre_params < $save; rm -f $save"
+	$LCTL set_param llite.*.xattr_cache=1
+
+	test_mkdir $DIR/$tdir
+	touch $file || error "touch $file failed"
+	# enough names to share hash buckets
+	for ((i = 0; i < 100; i++)); do
+		setfattr -n user.n102u.$i -v value$i $file ||
+			error "setfattr user.n102u.$i failed"
+	done
+
+	for max_mb in 64 0; do
+		$LCTL set_param llite.*.xattr_cache_max_mb=$max_mb
+		cancel_lru_locks mdc
+		for ((i = 0; i < 100; i++)); do
+			[[ "$(getfattr --only-values -n user.n102u.$i $file)" == \
+			   "value$i" ]] ||
+				error "bad user.n102u.$i with max_mb=$max_mb"
+		done
+		(( $(getfattr -d -m user.n102u $file | grep -c n102u) == 100 )) ||
+			error "wrong xattr list with max_mb=$max_mb"
+	done
+}
+run_test 102u "xattr cache with many names and a memory cap"
+
 run_acl_subtest()
 {
 	local test=$LUSTRE/tests/acl/$1.test
@@ -15323,6 +15489,75 @@ test_120g() {
 }
 run_test 120g "Early Lock Cancel: performance test"
 
+# write every other 64KiB block of $2 from $1, in $3 rounds
+stride_write() {
+	local file=$1
+	local first=$2
+	local nr=$3
+	local i
+
+	for ((i = first; i < 2 * nr; i += 2)); do
+		dd if=/dev/zero of=$file bs=64k count=1 seek=$i conv=notrunc \
+			status=none || return 1
+	done
+}
+
+# count blocking callbacks while two clients write interleaved blocks
+stride_write_callbacks() {
+	local nr=$1
+	local before
+	local after
+	local pid
+
+	rm -f $DIR/$tfile
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || return 1
+	cancel_lru_locks osc
+
+	before=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+		 awk '/ldlm_bl_callback/ { print $2 }')
+	stride_write $DIR/$tfile 0 $nr &
+	pid=$!
+	stride_write $DIR2/$tfile 1 $nr || return 1
+	wait $pid || return 1
+	after=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+		awk '/ldlm_bl_callback/ { print $2 }')
+
+	echo $((${after:-0} - ${before:-0}))
+}
+
+test_120h() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	remote_ost_nodsh && skip "remote OST with nodsh"
+	do_facet ost1 $LCTL get_param -n \
+		ldlm.namespaces.filter-$FSNAME-OST0000*.stride_hits ||
+		skip "OST does not detect strided writers"
+
+	local param="ldlm.namespaces.filter-$FSNAME-OST0000*.stride_hits"
+	local hits=$(do_facet ost1 $LCTL get_param -n $param)
+	local nr=64
+	local expanded
+	local strided
+
+	mount_client $MOUNT2 || error "mount_client on $MOUNT2 failed"
+	stack_trap "umount_client $MOUNT2"
+	stack_trap "do_facet ost1 $LCTL set_param -n $param=$hits"
+
+	do_facet ost1 $LCTL set_param -n $param=0
+	expanded=$(stride_write_callbacks $nr) ||
+		error "interleaved writes with expanded locks failed"
+	do_facet ost1 $LCTL set_param -n $param=2
+	strided=$(stride_write_callbacks $nr) ||
+		error "interleaved writes with strided locks failed"
+	echo "blocking callbacks: $expanded expanded, $strided strided"
+
+	# only the first locks of each writer are expanded and called back
+	(( strided < expanded )) ||
+		error "strided writers revoked each other's locks $strided times"
+	(( strided <= nr / 4 )) ||
+		error "$strided blocking callbacks between strided writers"
+}
+run_test 120h "interleaved strided writers keep their locks"
+
 test_121() { #bug #10589
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 
@@ -15955,6 +16190,102 @@ test_123l() {
 }
 run_test 123l "Avoid panic when revalidate a local cached entry"
 
+test_123m() {
+	local dir=$DIR/$tdir
+	local cnt=200
+	local xfiles
+	local enabled
+	local hits
+	local i
+
+	xfiles=$($LCTL get_param -n llite.*.read_ahead_cross_files | head -n1)
+	[[ -n "$xfiles" ]] || skip "no cross-file read-ahead on client"
+	enabled=$($LCTL get_param -n llite.*.enable_statahead_fname | head -n 1)
+	stack_trap "$LCTL set_param llite.*.read_ahead_cross_files=$xfiles"
+	stack_trap "$LCTL set_param llite.*.enable_statahead_fname=$enabled"
+	$LCTL set_param llite.*.read_ahead_cross_files=8
+	$LCTL set_param llite.*.enable_statahead_fname=1
+
+	mkdir -p $dir || error "failed to mkdir $dir"
+	for ((i = 0; i < cnt; i++)); do
+		dd if=/dev/zero of=$dir/$tfile$i bs=64K count=1 2>/dev/null ||
+			error "failed to write $dir/$tfile$i"
+	done
+
+	cancel_lru_locks mdc
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats=0
+	aheadmany -c stat -c read -N -s 0 -e $cnt -b $tfile -d $dir ||
+		error "failed to stat and read files in $dir"
+
+	$LCTL get_param llite.*.read_ahead_stats
+	$LCTL get_param llite.*.statahead_stats
+	hits=$($LCTL get_param -n llite.*.read_ahead_stats |
+	       get_named_value 'cross_file_hits' | calc_sum)
+	(( ${hits:-0} > 0 )) || error "no cross-file read-ahead hit"
+}
+run_test 123m "Verify cross-file read-ahead along a statahead scan"
+
+# getattr and glimpse RPCs sent for one "ls -l" of the given directory
+test_123n_rpcs() {
+	local dir=$1
+
+	cancel_lru_locks mdc
+	cancel_lru_locks $OSC
+	$LCTL set_param -n mdc.*.stats=clear $OSC.*.stats=clear
+	ls -l --time-style=+%s $dir | sort > $TMP/$tfile.$2
+	echo $(( $(calc_stats mdc.*.stats ldlm_ibits_enqueue) +
+		 $(calc_stats mdc.*.stats mds_getattr) +
+		 $(calc_stats $OSC.*.stats ldlm_glimpse_enqueue) ))
+}
+
+test_123n() {
+	local dir=$DIR/$tdir
+	local cnt=500
+	local plus
+	local rpcs_plus
+	local rpcs_base
+	local size
+
+	$LCTL get_param -n mdc.*.connect_flags | grep -q readdir_plus ||
+		skip "MDS does not support readdir-plus"
+	plus=$($LCTL get_param -n llite.*.readdir_plus | head -n1)
+	stack_trap "$LCTL set_param llite.*.readdir_plus=$plus"
+	stack_trap "rm -f $TMP/$tfile.*"
+
+	test_mkdir $dir
+	createmany -o $dir/$tfile $cnt || error "createmany failed"
+	mkdir $dir/subdir || error "mkdir subdir failed"
+	ln -s $tfile $dir/link || error "symlink failed"
+	dd if=/dev/zero of=$dir/${tfile}0 bs=64K count=4 2>/dev/null ||
+		error "write ${tfile}0 failed"
+
+	$LCTL set_param llite.*.readdir_plus=0
+	rpcs_base=$(test_123n_rpcs $dir base)
+
+	$LCTL set_param llite.*.readdir_plus=1
+	rpcs_plus=$(test_123n_rpcs $dir plus)
+	(( $(ls $dir | wc -l) == cnt + 2 )) ||
+		error "wrong entry count with readdir-plus"
+	diff $TMP/$tfile.base $TMP/$tfile.plus ||
+		error "listing differs with readdir-plus"
+
+	echo "getattr+glimpse RPCs: readdir_plus=0 $rpcs_base, =1 $rpcs_plus"
+	(( rpcs_plus <= rpcs_base )) ||
+		error "readdir-plus sent $rpcs_plus RPCs, more than $rpcs_base"
+
+	# the readdir-plus pages leave the lazy size of cached files behind,
+	# stat(AT_STATX_DONT_SYNC) must return it without any RPC
+	statx_supported || return 0
+	$LCTL set_param -n mdc.*.stats=clear $OSC.*.stats=clear
+	size=$($STATX --cached=always -c %s $dir/${tfile}0)
+	(( size == 262144 )) ||
+		error "lazy size of ${tfile}0 is $size, expected 262144"
+	(( $(calc_stats $OSC.*.stats ldlm_glimpse_enqueue) == 0 )) ||
+		error "stat(AT_STATX_DONT_SYNC) sent glimpse RPCs"
+}
+run_test 123n "Verify directory listing with readdir-plus pages"
+
 test_124a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	$LCTL get_param -n mdc.*.connect_flags | grep -q lru_resize ||
@@ -16204,6 +16535,56 @@ test_124d() {
 }
 run_test 124d "cancel very aged locks if lru-resize disabled"
 
+test_124e() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+
+	local nsdir="ldlm.namespaces.$FSNAME-OST0000-osc-[^mM]*"
+	local osc="osc.$FSNAME-OST0000-osc-[^mM]*"
+	local keep
+	local before
+	local after
+
+	keep=$($LCTL get_param -n $nsdir.lru_cost_keep 2>/dev/null) ||
+		skip "client does not support lru_cost_keep"
+	(( keep > 0 )) || skip "lru_cost_keep is disabled"
+
+	$LFS setstripe -i 0 -c 1 $DIR/$tfile.cached ||
+		error "setstripe $tfile.cached failed"
+	$LFS setstripe -i 0 -c 1 $DIR/$tfile.empty ||
+		error "setstripe $tfile.empty failed"
+	dd if=/dev/zero of=$DIR/$tfile.cached bs=1M count=4 conv=fsync ||
+		error "write $tfile.cached failed"
+
+	lru_resize_disable osc 100
+	cancel_lru_locks osc
+
+	# the lock with cached pages is the older one in the LRU
+	cat $DIR/$tfile.cached > /dev/null || error "read $tfile.cached failed"
+	sleep 1
+	stat $DIR/$tfile.empty > /dev/null || error "stat $tfile.empty failed"
+	(( $($LCTL get_param -n $nsdir.lock_unused_count) == 2 )) ||
+		error "expected 2 unused locks, got" \
+		      "$($LCTL get_param -n $nsdir.lock_unused_count)"
+
+	$LCTL set_param $nsdir.lru_size=1
+	wait_update_cond $HOSTNAME \
+		"$LCTL get_param -n $nsdir.lock_unused_count" "-le" 1 10 ||
+		error "LRU did not shrink to 1 lock"
+
+	# the empty lock went, the pages stayed cached under the other one
+	before=$(calc_stats $osc.stats ost_read)
+	cat $DIR/$tfile.cached > /dev/null || error "read $tfile.cached failed"
+	after=$(calc_stats $osc.stats ost_read)
+	(( before == after )) ||
+		error "$tfile.cached lock cancelled, $((after - before)) reads"
+
+	before=$(calc_stats $osc.stats ldlm_glimpse_enqueue)
+	stat $DIR/$tfile.empty > /dev/null || error "stat $tfile.empty failed"
+	after=$(calc_stats $osc.stats ldlm_glimpse_enqueue)
+	(( after > before )) || error "$tfile.empty lock was kept"
+}
+run_test 124e "LRU passes over locks with cached pages"
+
 test_125() { # 13358
 	$LCTL get_param -n llite.*.client_type | grep -q local ||
 		skip "must run as local client"
@@ -17492,6 +17873,83 @@ test_134b() {
 }
 run_test 134b "Server rejects lock request when reaching lock_limit_mb"
 
+# locks held on MDT0000 by the client with the given UUID
+client_mdt0_locks() {
+	do_facet mds1 $LCTL get_param -n ldlm.lock_top_holders |
+		awk -v uuid=$1 '/-MDT0000/ { mdt = 1; next }
+			/^- namespace/ { mdt = 0 }
+			mdt && $0 ~ "client: "uuid"," {
+				sub(/.*locks: /, ""); print $1 + 0 }'
+}
+
+# UUID the client mounted at $1 connects to MDT0000 with
+client_mdt0_uuid() {
+	local inst=$($LFS getname $1 | awk '{ print $1 }')
+
+	$LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-${inst##*-}.uuid
+}
+
+test_134c() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+	[[ $MDS1_VERSION -lt $(version_code 2.16.51) ]] &&
+		skip "Need MDS version at least 2.16.51"
+
+	local nr=1000
+	local mnt3=$TMP/$tdir.mnt3
+	local uuid
+	local heavy
+
+	# an export is only "heavy" above twice the average of all holders,
+	# which one of two exports can never be, so add two light holders
+	mount_client $MOUNT2 || error "mount $MOUNT2 failed"
+	stack_trap "umount_client $MOUNT2"
+	mkdir -p $mnt3
+	stack_trap "rmdir $mnt3"
+	mount_client $mnt3 || error "mount $mnt3 failed"
+	stack_trap "umount_client $mnt3"
+
+	mkdir_on_mdt0 $DIR/$tdir || error "failed to create $DIR/$tdir"
+	cancel_lru_locks mdc
+	createmany -o $DIR/$tdir/f $nr || error "createmany failed"
+	ls -l $DIR/$tdir > /dev/null
+	stat $MOUNT2/$tdir $mnt3/$tdir > /dev/null || error "stat failed"
+
+	uuid=$(client_mdt0_uuid $MOUNT)
+	do_facet mds1 $LCTL get_param -n ldlm.lock_top_holders
+	local locks=$(client_mdt0_locks $uuid)
+
+	(( ${locks:-0} >= nr )) ||
+		error "$uuid holds ${locks:-0} locks on MDT0000, expected >= $nr"
+
+	local old_debug=$(do_facet mds1 $LCTL get_param -n debug)
+
+	stack_trap "do_facet mds1 $LCTL set_param -n debug=${old_debug// /+}"
+	do_facet mds1 $LCTL set_param debug=+dlmtrace
+	do_facet mds1 $LCTL clear
+
+	#define OBD_FAIL_LDLM_WATERMARK_LOW     0x327
+	do_facet mds1 $LCTL set_param fail_loc=0x327
+	do_facet mds1 $LCTL set_param fail_val=500
+	touch $DIR/$tdir/m
+
+	echo "sleep 10 seconds ..."
+	sleep 10
+	local after=$(client_mdt0_locks $uuid)
+
+	do_facet mds1 $LCTL set_param fail_loc=0
+	do_facet mds1 $LCTL set_param fail_val=0
+	do_facet mds1 $LCTL get_param -n ldlm.lock_top_holders
+	heavy=$(do_facet mds1 $LCTL dk |
+		grep -cE "holds [0-9]+ locks, average [0-9]+, reclaiming [1-9]")
+	(( heavy > 0 )) || error "no locks revoked from a heavy lock holder"
+	(( ${after:-0} < locks )) ||
+		error "No locks reclaimed from $uuid, before:$locks, after:$after"
+
+	rm $DIR/$tdir/m
+	unlinkmany $DIR/$tdir/f $nr
+}
+run_test 134c "reclaim revokes locks of the top lock holder"
+
 test_135() {
 	remote_mds_nodsh && skip "remote MDS with nodsh"
 	[[ $MDS1_VERSION -lt $(version_code 2.13.50) ]] &&
@@ -22594,6 +23052,68 @@ test_216() { # bug 20317
 }
 run_test 216 "check lockless direct write updates file size and kms correctly"
 
+test_216b() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	remote_ost_nodsh && skip "remote OST with nodsh"
+	(( OSTCOUNT >= 2 )) || skip_env "needs >= 2 OSTs"
+	$LCTL get_param -n llite.*.contention_seconds > /dev/null ||
+		skip "client does not switch contended I/O to DIO"
+
+	local facets=$(get_facets OST)
+	local p="$TMP/$TESTSUITE-$TESTNAME.parameters"
+	local hybrid=$($LCTL get_param -n llite.*.hybrid_io | head -n1)
+	local rthresh=$($LCTL get_param -n \
+			llite.*.hybrid_io_read_threshold_bytes | head -n1)
+	local before
+	local after
+
+	save_lustre_params $facets \
+		"ldlm.namespaces.filter-*.max_nolock_bytes" > $p
+	save_lustre_params $facets \
+		"ldlm.namespaces.filter-*.contended_locks" >> $p
+	save_lustre_params $facets \
+		"ldlm.namespaces.filter-*.contention_seconds" >> $p
+	stack_trap "restore_lustre_params < $p; rm -f $p"
+
+	$LCTL set_param llite.*.hybrid_io=1 \
+		llite.*.hybrid_io_read_threshold_bytes=$((64 * 1048576))
+	stack_trap "$LCTL set_param -n llite.*.hybrid_io=$hybrid \
+		llite.*.hybrid_io_read_threshold_bytes=$rthresh"
+
+	mount_client $MOUNT2 || error "mount_client on $MOUNT2 failed"
+	stack_trap "umount_client $MOUNT2"
+
+	$LFS setstripe -S 1M -c 2 -i 0 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/urandom of=$TMP/$tfile bs=1M count=2 ||
+		error "dd to $TMP/$tfile failed"
+	stack_trap "rm -f $TMP/$tfile"
+	dd if=$TMP/$tfile of=$DIR/$tfile bs=1M count=2 conv=fsync ||
+		error "write $tfile failed"
+	cancel_lru_locks osc
+
+	# the second mount holds a lock on the second stripe only
+	dd if=$TMP/$tfile of=$DIR2/$tfile bs=1M count=1 skip=1 seek=1 \
+		conv=notrunc,fsync || error "write $DIR2/$tfile failed"
+
+	# any conflict makes the OST refuse the lock as contended
+	do_nodes $(comma_list $(osts_nodes)) \
+		"lctl set_param -n ldlm.namespaces.*.max_nolock_bytes=4194304 \
+			ldlm.namespaces.filter-*.contended_locks=0 \
+			ldlm.namespaces.filter-*.contention_seconds=60"
+
+	# the first stripe is read with a lock, the rest is redone as DIO,
+	# a short read would leave $tfile.out short
+	before=$(calc_stats llite.*.stats hybrid_contended_switch)
+	dd if=$DIR/$tfile of=$TMP/$tfile.out bs=2M count=1 ||
+		error "read $tfile failed"
+	stack_trap "rm -f $TMP/$tfile.out"
+	after=$(calc_stats llite.*.stats hybrid_contended_switch)
+	cmp $TMP/$tfile $TMP/$tfile.out || error "$tfile data differs"
+	(( after > before )) ||
+		error "read of $tfile was not switched to DIO"
+}
+run_test 216b "partially contended buffered I/O is finished as DIO"
+
 test_217() { # bug 22430
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 
@@ -29400,6 +29920,53 @@ test_398s() {
 }
 run_test 398s "i/o error on mirror file read"
 
+test_398t() {
+	(( OSTCOUNT >= 2 )) || skip_env "needs >= 2 OSTs"
+	$LCTL get_param -n llite.*.parallel_io_max_threads > /dev/null ||
+		skip "client does not support parallel buffered I/O"
+
+	local file=$DIR/$tfile
+	local pfl=$DIR/$tfile.pfl
+	local dom=$DIR/$tfile.dom
+	local ref=$TMP/$tfile.ref
+	local threads
+	local bytes
+
+	threads=$($LCTL get_param -n llite.*.parallel_io_max_threads | head -n1)
+	stack_trap "$LCTL set_param llite.*.parallel_io_max_threads=$threads"
+	$LCTL set_param llite.*.parallel_io_max_threads=$OSTCOUNT
+
+	$LFS setstripe -c -1 -S 1M $file || error "setstripe $file failed"
+	$LFS setstripe -E 4M -c 1 -S 1M -E -1 -c -1 -S 1M $pfl ||
+		error "setstripe $pfl failed"
+	$LFS setstripe -E 1M -L mdt -E -1 -c -1 -S 1M $dom ||
+		error "setstripe $dom failed"
+	dd if=/dev/urandom of=$ref bs=1M count=32 || error "dd $ref failed"
+	stack_trap "rm -f $ref"
+
+	$LCTL set_param llite.*.stats=clear
+	dd if=$ref of=$file bs=16M || error "dd write $file failed"
+	dd if=$ref of=$pfl bs=16M || error "dd write $pfl failed"
+	dd if=$ref of=$dom bs=16M || error "dd write $dom failed"
+	bytes=$(calc_stats_sum llite.*.stats parallel_io_bytes)
+	(( bytes == 0 )) || error "writes were split over stripes: $bytes"
+
+	# the first 4MB of $pfl on one stripe and the first 1MB of $dom on
+	# the MDT are read serially, the rest of the same read() is split
+	for f in $file $pfl $dom; do
+		cancel_lru_locks osc
+		cancel_lru_locks mdc
+		$LCTL set_param llite.*.stats=clear
+		dd if=$f of=/dev/null bs=32M count=1 ||
+			error "dd read $f failed"
+		bytes=$(calc_stats_sum llite.*.stats parallel_io_bytes)
+		echo "$f: $bytes bytes read in parallel"
+		(( bytes > 0 )) || error "read of $f was not split over stripes"
+		cmp $ref $f || error "$f differs from $ref"
+	done
+}
+run_test 398t "parallel buffered read over stripes"
+
 test_fake_rw() {
 	local read_write=$1
 	if [ "$read_write" = "write" ]; then
@@ -33135,6 +33702,74 @@ test_807b() {
 }
 run_test 807b "verify lfs somsync utility"
 
+test_807c() {
+	(( $MDS1_VERSION >= $(version_code 2.16.51) )) ||
+		skip "Need MDS version at least 2.16.51"
+
+	local file=$DIR/$tfile
+	local flags
+	local before
+	local after
+
+	$LCTL get_param -n llite.*.strict_som > /dev/null ||
+		skip "client does not support strict_som"
+
+	local old=$($LCTL get_param -n llite.*.strict_som | head -n1)
+
+	$LCTL set_param llite.*.strict_som=1
+	stack_trap "$LCTL set_param -n llite.*.strict_som=$old"
+
+	$LFS setstripe -c -1 $file || error "setstripe $file failed"
+	dd if=/dev/zero of=$file bs=1M count=4 seek=1 conv=fsync ||
+		error "write $file failed"
+
+	flags=$($LFS getsom -f $file)
+	(( flags == 1 )) || error "$file SOM flags $flags, expected strict"
+	check_lsom_data $file "strict"
+
+	cancel_lru_locks $OSC
+	cancel_lru_locks mdc
+	before=$(calc_stats $OSC.*$OSC*.stats ldlm_glimpse_enqueue)
+	stat $file > /dev/null || error "stat $file failed"
+	after=$(calc_stats $OSC.*$OSC*.stats ldlm_glimpse_enqueue)
+	(( before == after )) ||
+		error "stat sent $((after - before)) glimpse RPCs to OST"
+
+	# a writer opening and closing while the close of the last one is
+	# on its way, that one has sampled a size which is stale by then
+	local pid
+
+	#define OBD_FAIL_LLITE_STRICT_SOM_PAUSE	0x1436
+	$LCTL set_param fail_loc=0x80001436 fail_val=5
+	stack_trap "$LCTL set_param fail_loc=0 fail_val=0"
+	$MULTIOP $file Oc &
+	pid=$!
+	sleep 1
+	dd if=/dev/zero of=$file bs=1M count=1 oflag=append \
+		conv=notrunc,fsync || error "append to $file failed"
+	wait $pid || error "multiop $file failed"
+	$LCTL set_param fail_loc=0 fail_val=0
+
+	flags=$($LFS getsom -f $file)
+	(( !(flags & 1) )) ||
+		error "$file SOM strict after racing writers, size" \
+		      "$($LFS getsom -s $file) real $(stat -c %s $file)"
+
+	# the next last writer alone makes it strict again
+	dd if=/dev/zero of=$file bs=1M count=1 conv=notrunc,fsync ||
+		error "rewrite $file failed"
+	flags=$($LFS getsom -f $file)
+	(( flags == 1 )) || error "$file SOM flags $flags, expected strict"
+	check_lsom_data $file "strict"
+
+	# an open for write ends the strict SOM
+	$LCTL set_param llite.*.strict_som=0
+	$MULTIOP $file Ow4096c || error "multiop $file failed"
+	flags=$($LFS getsom -f $file)
+	(( !(flags & 1) )) || error "$file SOM still strict after write"
+}
+run_test 807c "strict SOM from the close of the last writer"
+
 check_som_nologged()
 {
 	local lines=$($LFS changelog $FSNAME-MDT0000 |
@@ -33795,6 +34430,24 @@ test_842() {
 }
 run_test 842 "Measure ldlm_extent performance"
 
+test_843() {
+	(( $MDS1_VERSION >= $(version_code 2.16.51) )) ||
+		skip "Need MDS version at least 2.16.51 for ldlm_inodebits module"
+
+	local mds1=$(facet_host mds1)
+
+	# Try to insert the module.  This will leave results in dmesg
+	now=$(date +%s)
+	log "STAMP $now" > /dev/kmsg
+	do_rpc_nodes $mds1 load_module kunit/ldlm_inodebits ||
+		error "$mds1 load_module ldlm_inodebits failed"
+
+	do_node $mds1 dmesg | sed -n -e "1,/STAMP $now/d" -e '/ldlm_inodebits:/p'
+	do_node $mds1 rmmod -v ldlm_inodebits ||
+		error "rmmod failed (may trigger a failure in a later test)"
+}
+run_test 843 "Measure ldlm_inodebits performance"
+
 test_850() {
 	local dir=$DIR/$tdir
 	local file=$dir/$tfile
@@ -34092,6 +34745,42 @@ test_906() {
 }
 run_test 906 "Simple test for io_uring I/O engine via fio"
 
+test_906b() {
+	grep -q io_uring_setup /proc/kallsyms ||
+		skip "Client OS does not support io_uring I/O engine"
+	io_uring_probe || skip "kernel does not support io_uring fully"
+	which fio || skip_env "no fio installed"
+	fio --enghelp=io_uring | grep -q fixedbufs ||
+		skip_env "fio does not support io_uring fixed buffers"
+
+	local file=$DIR/$tfile
+	local size=64M
+	local bytes
+
+	$LFS setstripe -c -1 $file || error "setstripe $file failed"
+	$LCTL set_param llite.*.stats=clear
+
+	# registered buffers are reused for every request of the job
+	fio --name=fixedwrite --ioengine=io_uring --fixedbufs \
+		--bs=1M --direct=1 --iodepth=16 --size=$size \
+		--filename=$file --rw=write --verify=crc32c \
+		--do_verify=0 || error "fio fixedbufs write $file failed"
+
+	fio --name=fixedread --ioengine=io_uring --fixedbufs \
+		--bs=1M --direct=1 --iodepth=16 --size=$size \
+		--filename=$file --rw=read --verify=crc32c \
+		--verify_only || error "fio fixedbufs verify $file failed"
+
+	$LCTL get_param llite.*.stats | grep dio_bvec_bytes
+	bytes=$($LCTL get_param -n llite.*.stats |
+		awk '/^dio_bvec_bytes/ { sum += $7 } END { print sum }')
+	(( ${bytes:-0} > 0 )) ||
+		error "registered buffers did not use the bvec DIO path"
+
+	rm -f $file || error "rm -f $file failed"
+}
+run_test 906b "io_uring DIO with registered buffers"
+
 test_907() {
 	local max_pages=$($LCTL get_param -n osc.*.max_pages_per_rpc | head -n1)
 
@@ -369,6 +369,7 @@ check_lu_dirent(void)
 	CHECK_VALUE_X(LUDA_FID);
 	CHECK_VALUE_X(LUDA_TYPE);
 	CHECK_VALUE_X(LUDA_64BITHASH);
+	CHECK_VALUE_X(LUDA_ATTRS);
 }
 
 static void
@@ -379,6 +380,25 @@ check_luda_type(void)
 	CHECK_MEMBER(luda_type, lt_type);
 }
 
+static void
+check_luda_attrs(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(luda_attrs);
+	CHECK_MEMBER(luda_attrs, lat_valid);
+	CHECK_MEMBER(luda_attrs, lat_size);
+	CHECK_MEMBER(luda_attrs, lat_blocks);
+	CHECK_MEMBER(luda_attrs, lat_mtime);
+	CHECK_MEMBER(luda_attrs, lat_atime);
+	CHECK_MEMBER(luda_attrs, lat_ctime);
+	CHECK_MEMBER(luda_attrs, lat_mode);
+	CHECK_MEMBER(luda_attrs, lat_uid);
+	CHECK_MEMBER(luda_attrs, lat_gid);
+	CHECK_MEMBER(luda_attrs, lat_nlink);
+	CHECK_MEMBER(luda_attrs, lat_flags);
+	CHECK_MEMBER(luda_attrs, lat_padding);
+}
+
 static void
 check_lu_dirpage(void)
 {
@@ -705,6 +725,7 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT2_CONN_POLICY);
 	CHECK_DEFINE_64X(OBD_CONNECT2_MIRROR_ID_FIX);
 	CHECK_DEFINE_64X(OBD_CONNECT2_UPDATE_LAYOUT);
+	CHECK_DEFINE_64X(OBD_CONNECT2_READDIR_PLUS);
 
 	BLANK_LINE();
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
@@ -3603,6 +3624,7 @@ main(int argc, char **argv)
 	check_ost_id();
 	check_lu_dirent();
 	check_luda_type();
+	check_luda_attrs();
 	check_lu_dirpage();
 	check_lu_ladvise();
 	check_ladvise_hdr();